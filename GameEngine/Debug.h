@@ -4,15 +4,24 @@
 
 #define DEBUG 0
 
+// Runs ModelLoader::benchmarkImport on the animated model when gameplay starts
+#define BENCHMARK_MODEL_IMPORT 0
+
 #if DEBUG
 #include <iostream>
 #define DEBUG_COUT std::cout
 #else
-#include <ostream>
 #include <iostream>
-#include <sstream>
-static std::ostringstream null_stream;
-#define DEBUG_COUT null_stream
+// Swallows everything streamed into it instead of writing to a shared buffer, which keeps
+// disabled logging free and safe to use from worker threads. An object rather than a hidden
+// if, so the macro stays a plain expression inside unbraced if/else.
+struct NullStream {
+    template <typename T>
+    const NullStream& operator<<(const T&) const { return *this; }
+    const NullStream& operator<<(std::ostream& (*)(std::ostream&)) const { return *this; }
+};
+inline const NullStream debugNullStream;
+#define DEBUG_COUT debugNullStream
 #endif
 
 #endif // DEBUG_H
\ No newline at end of file
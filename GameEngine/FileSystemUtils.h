@@ -5,6 +5,9 @@ class FileSystemUtils {
 public:
     static std::string getExecutablePath();
     static std::string getMaterialFilePath(const std::string& materialFileName);
+    // Absolute, lexically normal path with forward slashes, lower-cased where paths are
+    // case-insensitive. Equal for every spelling of the same asset, so caches can key on it.
+    static std::string normalizeAssetPath(const std::string& path);
 
     // New method to get the path for any asset relative to the executable path
     static std::string getAssetFilePath(const std::string& assetRelativePath) {
@@ -70,6 +70,10 @@ void GameEngine::run() {
 }
 
 void GameEngine::shutdown() {
+    if (renderer) {
+        renderer->shutdown();
+    }
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -218,6 +222,9 @@ void GameEngine::mainLoop() {
 
         stateManager.update(deltaTime);
 
+        // Issue queued buffer and texture uploads within this frame's budget
+        GpuUploadQueue::instance().processFrame();
+
         stateManager.render();
         glfwSwapBuffers(window);
     }
@@ -28,6 +28,7 @@
 #include "StaticGeometry.h"
 #include "ModelLoader.h"
 #include "Renderer.h"
+#include "rendering/GpuUploadQueue.h"
 #include "AudioManager.h"
 #include "Debug.h"
 #include "state/GameStateManager.h"
@@ -10,6 +10,8 @@
 #include <assimp/postprocess.h>
 #include "StaticGeometry.h"
 #include "geometry/AnimatedGeometry.h"
+#include "geometry/MeshData.h"
+#include "geometry/MeshCache.h"
 #include "TextureLoader.h"
 #include "Materials.h"
 #include <MaterialParser.h>
@@ -23,22 +25,43 @@
 class ModelLoader {
 public:
     static std::vector<std::unique_ptr<RenderableNode>> loadModel(const std::string& path, const std::string& materialPath);
-    static const std::map<std::string, BoneInfo>& getBoneInfoMap();
+
+    // Also returns the skeleton of the model so animations can be bound to it
+    static std::vector<std::unique_ptr<RenderableNode>> loadModel(const std::string& path, const std::string& materialPath, std::map<std::string, BoneInfo>& boneInfoMap);
+
+    // Imports the model without the cooked cache and reports processing time against vertex count per skinned mesh
+    static void benchmarkImport(const std::string& path, int iterations = 5);
+
+    // CPU stage: produce upload-ready mesh data, from the cooked cache when it is up to date.
+    // Safe to call from worker threads.
+    // Packed vertices are used for every mesh that fits them, the rest stay in float.
+    static ModelData cookModel(const std::string& path, VertexFormat vertexFormat = VertexFormat::Float);
+
+    // GL stage, render thread only
+    static std::vector<std::shared_ptr<Material>> getMaterials(const std::string& materialPath);
+    static std::shared_ptr<Material> selectMaterial(const std::vector<std::shared_ptr<Material>>& materials, uint32_t materialIndex);
+    static std::unique_ptr<RenderableNode> createRenderableNode(const MeshData& meshData, std::shared_ptr<Material> material, const std::map<std::string, BoneInfo>& boneInfoMap,
+        GeometryRetention retention = GeometryRetention::Full);
+
+    // Full paths of every image the materials reference, so they can be decoded ahead of time
+    static std::vector<std::string> getTexturePaths(const std::vector<std::shared_ptr<Material>>& materials);
 
 private:
-    static std::unique_ptr<RenderableNode> processStaticMesh(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Material> material);
-    static std::unique_ptr<RenderableNode> processAnimatedMesh(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Material> material);
+    static ModelData importModel(const std::string& path, VertexFormat vertexFormat);
+    static MeshData processStaticMesh(aiMesh* mesh, const aiScene* scene);
+    static MeshData processAnimatedMesh(aiMesh* mesh, const aiScene* scene, const std::map<std::string, BoneInfo>& boneInfoMap);
+    static void assignBoneIDs(const aiScene* scene, std::map<std::string, BoneInfo>& boneInfoMap);
+
+    static std::vector<Texture> loadMeshTextures(const std::shared_ptr<Material>& material);
     static std::vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, std::vector<Texture>& loadedTextures);
     static std::vector<std::string> readMaterialList(const std::string& materialListFile);
     static std::vector<std::shared_ptr<Material>> loadMaterials(const std::string& materialPath);
 
     // Added declarations
     static void SetVertexBoneDataToDefault(AnimatedVertex& vertex);
-    static void ExtractBoneWeightForVertices(AnimatedVertex& vertex, aiMesh* mesh, int vertexIndex);
+    static void ExtractBoneWeights(std::vector<AnimatedVertex>& vertices, aiMesh* mesh, const std::map<std::string, BoneInfo>& boneInfoMap);
     static void SetVertexBoneData(AnimatedVertex& vertex, int boneID, float weight);
 
     // Added member variables
-    static Assimp::Importer importer;
-    static std::map<std::string, BoneInfo> m_BoneInfoMap;
-    static int m_BoneCounter;
+    static const unsigned int importFlags;
 };
\ No newline at end of file
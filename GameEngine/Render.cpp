@@ -1,9 +1,17 @@
 #include "Renderer.h"
+#include "rendering/GLStateCache.h"
+#include "rendering/BonePalette.h"
+#include "rendering/GpuUploadQueue.h"
+#include "rendering/MeshBufferArena.h"
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 
 Renderer::Renderer(int width, int height, GLFWwindow* window)
-    : screenWidth(width), screenHeight(height), projectionMatrix(glm::mat4(1.0f)), window(window) {
+    : projectionMatrix(glm::mat4(1.0f)), frameUniforms(GL_UNIFORM_BUFFER, 4 * 1024, "frame uniform"),
+    screenWidth(width), screenHeight(height), window(window) {
+    GLStateCache::instance().initialize();
     frameBufferManager = std::make_unique<FrameBufferManager>(window);
 
     // Create the main scene framebuffer
@@ -14,21 +22,30 @@ Renderer::Renderer(int width, int height, GLFWwindow* window)
     frameBufferManager->createFrameBuffer(width /2, height /2);
     frameBufferManager->createFrameBuffer(width, height);
     frameBufferManager->createFrameBuffer(width, height);
+    renderQueue.setOcclusionDepth(frameBufferManager->getDepthTexture(0), width, height);
 
     frameBufferManager->createPostProcessingEffects(); // Setup post-processing effects
     setupUniformBufferObject(); // Continue with UBO setup
 }
 
-Renderer::~Renderer() {
-    glDeleteBuffers(1, &uboMatrices); // Clean up the UBO
+Renderer::~Renderer() {}
+
+void Renderer::shutdown() {
+    // Queued uploads may target arena buffers, drop them first
+    GpuUploadQueue::instance().shutdown();
+    MeshBufferArena::instance().shutdown();
 }
 
 void Renderer::setupUniformBufferObject() {
-    glGenBuffers(1, &uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 352, NULL, GL_STATIC_DRAW); // Allocate 352 bytes for the UBO
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    glBindBufferBase(GL_UNIFORM_BUFFER, 0, uboMatrices);
+    // Uniform blocks are sub-allocated from the frame ring, every range aligned for glBindBufferRange
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    uniformAlignment = static_cast<size_t>(std::max(offsetAlignment, 16));
+}
+
+void Renderer::bindUniformRange(GLuint bindingPoint, const void* data, size_t size) {
+    const size_t offset = frameUniforms.write(data, size, uniformAlignment);
+    glBindBufferRange(GL_UNIFORM_BUFFER, bindingPoint, frameUniforms.getBuffer(), static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
 }
 
 void Renderer::updateUniformBufferObject() {
@@ -44,9 +61,7 @@ void Renderer::updateUniformBufferObject() {
     uniforms.nearPlane = nearPlane;
     uniforms.farPlane = farPlane;
 
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Uniforms), &uniforms);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    bindUniformRange(0, &uniforms, sizeof(Uniforms));
 }
 
 void Renderer::setCameraController(std::shared_ptr<CameraNode> cameraController) {
@@ -61,6 +76,9 @@ void Renderer::setProjectionMatrix(const glm::mat4& projectionMatrix, float near
 
 
 void Renderer::renderFrame(Node* rootNode) {
+    GLStateCache::instance().beginFrame();
+    frameUniforms.beginFrame();
+
     // Update the frustum for culling using the latest view and projection matrices
     updateFrustum(projectionMatrix * cameraController->getViewMatrix());
 
@@ -70,14 +88,22 @@ void Renderer::renderFrame(Node* rootNode) {
     // Clear the frame and set initial OpenGL state for the frame
     prepareFrame();
 
+    // Write the frame uniforms once, everything drawn this frame reads the same range
+    updateUniformBufferObject();
+
     // Render the skybox
     renderSkybox();
 
-    // Update all relevant UBOs with current frame data
-    updateUniformBufferObject();
-
-    // Traverse the scene graph and render each node
-    rootNode->render(glm::mat4(1.0f));
+    // Traverse the scene graph to collect the visible draws, then submit them sorted by state and depth
+    glm::mat4 view = cameraController->getViewMatrix();
+    glm::vec3 viewDirection(-view[0][2], -view[1][2], -view[2][2]);
+    renderQueue.begin(cameraController->getCameraPosition(), viewDirection, farPlane);
+    renderQueue.setViewProjection(projectionMatrix * view);
+    collectVisibleDraws(rootNode);
+    renderQueue.sort();
+    BonePalette::instance().beginFrame();
+    renderQueue.submit();
+    BonePalette::instance().endFrame();
 
     // Unbind the framebuffer and revert to the default framebuffer
     frameBufferManager->unbindFrameBuffer();
@@ -93,13 +119,6 @@ void Renderer::prepareFrame() {
     // Clear the screen
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Update the UBO for view and projection matrices
-    glm::mat4 viewMatrix = cameraController->getViewMatrix();
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(viewMatrix));
-    glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(projectionMatrix));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
 }
 
 void Renderer::renderSkybox() const {
@@ -126,6 +145,9 @@ void Renderer::finalizeFrame() {
 
     // Re-enable depth testing for the next frame's regular rendering
     glEnable(GL_DEPTH_TEST);
+
+    // Post-processing was the last reader of this frame's uniform ranges
+    frameUniforms.endFrame();
 }
 
 void Renderer::setSkybox(std::shared_ptr<SkyboxNode> skybox) {
@@ -136,6 +158,46 @@ void Renderer::updateFrustum(const glm::mat4& viewProjection) {
     frustum.update(viewProjection);
 }
 
+void Renderer::collectVisibleDraws(Node* rootNode) {
+    auto start = std::chrono::steady_clock::now();
+    sceneIndex.synchronize(rootNode);
+
+    // Everything in the frustum is a candidate, occluders are ranked by half area over squared distance
+    const glm::vec3 viewPosition = cameraController->getCameraPosition();
+    frustumVisible.clear();
+    occluderNodes.clear();
+    frustumCuller.begin(frustum);
+    sceneIndex.queryFrustum(frustumCuller, [this, &viewPosition](Node& node) {
+        frustumVisible.push_back(&node);
+        if (node.getOccluder()) {
+            const BoundingBox& bounds = node.getWorldBounds();
+            const float distanceSquared = std::max(bounds.distanceSquared(viewPosition), nearPlane * nearPlane);
+            occluderNodes.emplace_back(bounds.getHalfArea() / distanceSquared, &node);
+        }
+    });
+    frustumCuller.addCulled(0, sceneIndex.size() - frustumVisible.size());
+    frustumCuller.getStats().cullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Rasterize the largest occluders on screen, then test every candidate against them before it is drawn
+    occlusionCuller.begin(projectionMatrix * cameraController->getViewMatrix(), nearPlane);
+    const size_t occluderCount = std::min(occluderNodes.size(), OcclusionCuller::maxOccludersPerFrame);
+    std::partial_sort(occluderNodes.begin(), occluderNodes.begin() + occluderCount, occluderNodes.end(),
+        [](const std::pair<float, Node*>& a, const std::pair<float, Node*>& b) { return a.first > b.first; });
+    for (size_t i = 0; i < occluderCount; ++i) {
+        occlusionCuller.addOccluder(*occluderNodes[i].second->getOccluder(), occluderNodes[i].second->getWorldTransform());
+    }
+    occlusionCuller.rasterize();
+
+    auto testStart = std::chrono::steady_clock::now();
+    for (Node* node : frustumVisible) {
+        if (occlusionCuller.isVisible(node->getWorldBounds())) {
+            node->collectDraws(renderQueue);
+            frustumCuller.addVisible();
+        }
+    }
+    occlusionCuller.getStats().testMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - testStart).count();
+}
+
 const glm::mat4& Renderer::getProjectionMatrix() const {
     return projectionMatrix;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <glm/glm.hpp>
+#include <cstddef>
 #include <vector>
 #include <memory>
 #include <utility>
@@ -8,9 +9,15 @@
 #include "rendering/SkyboxNode.h"
 #include "post-processing/PostProcessing.h"
 #include "rendering/Frustum.h"
+#include "rendering/FrustumCuller.h"
+#include "rendering/OcclusionCuller.h"
+#include "rendering/GpuCuller.h"
 #include "post-processing/FrameBufferManager.h"
 #include "rendering/IRenderable.h"
+#include "rendering/RenderQueue.h"
+#include "rendering/GpuRingBuffer.h"
 #include "node/Node.h"
+#include "node/SceneIndex.h"
 
 struct Camera {
     glm::vec3 cameraPositionWorld;
@@ -28,6 +35,7 @@ struct Lighting {
     float lightIntensity;
 };
 
+// Mirrors the std140 Uniforms block (binding 0) of the shaders, so the buffer range is sizeof(Uniforms)
 struct Uniforms {
     glm::mat4 viewMatrix;
     glm::mat4 projectionMatrix;
@@ -35,8 +43,11 @@ struct Uniforms {
     Lighting lighting;
     float nearPlane;
     float farPlane;
-    float _padding5[8]; // Increase the size of the padding array to 8 elements
+    float _padding5;
+    glm::vec4 _padding6[8]; // float _pad5[8] in the shaders, std140 gives every element 16 bytes
 };
+static_assert(offsetof(Uniforms, farPlane) == 216, "Uniforms must follow the std140 layout of the shader block");
+static_assert(offsetof(Uniforms, _padding6) % 16 == 0 && sizeof(Uniforms) % 16 == 0, "std140 arrays and blocks are 16-byte aligned");
 
 class Renderer {
     Frustum frustum;
@@ -44,12 +55,25 @@ public:
     Renderer(int width, int height, GLFWwindow* window);
     ~Renderer();
 
+    // Deletes the shared GPU resources, called while the GL context is still current
+    void shutdown();
+
     void setCameraController(std::shared_ptr<CameraNode> cameraController);
     void setProjectionMatrix(const glm::mat4& projectionMatrix, float nearPlane, float farPlane);
     void renderFrame(Node* rootNode);
     void setSkybox(std::shared_ptr<SkyboxNode> skybox);
     void finalizeFrame();
     const glm::mat4& getProjectionMatrix() const;
+    const RenderQueueStats& getRenderQueueStats() const { return renderQueue.getStats(); }
+    const CullingStats& getCullingStats() const { return frustumCuller.getStats(); }
+    const OcclusionStats& getOcclusionStats() const { return occlusionCuller.getStats(); }
+    const GpuCullingStats& getGpuCullingStats() const { return renderQueue.getGpuCullingStats(); }
+    // World-space index of the scene last rendered, for gameplay queries as well
+    SceneIndex& getSceneIndex() { return sceneIndex; }
+
+    // Copies data into this frame's region of the uniform ring and binds it to bindingPoint.
+    // For per-frame, per-pass or per-object blocks; the range stays valid until the frame is finalized.
+    void bindUniformRange(GLuint bindingPoint, const void* data, size_t size);
 
 private:
     void setupUniformBufferObject();
@@ -57,12 +81,20 @@ private:
     void prepareFrame();
     void renderSkybox() const;
     void updateFrustum(const glm::mat4& viewProjection);
+    void collectVisibleDraws(Node* rootNode);
 
     std::shared_ptr<CameraNode> cameraController;
     glm::mat4 viewMatrix;
     glm::mat4 projectionMatrix;
-    GLuint uboMatrices;
+    GpuRingBuffer frameUniforms;
+    size_t uniformAlignment = 256;
     std::shared_ptr<SkyboxNode> skybox;
+    RenderQueue renderQueue;
+    FrustumCuller frustumCuller;
+    OcclusionCuller occlusionCuller;
+    SceneIndex sceneIndex;
+    std::vector<Node*> frustumVisible;                 // Candidates of the occlusion tests
+    std::vector<std::pair<float, Node*>> occluderNodes; // Occluders in the frustum by their size on screen
     GLuint fbo;
     GLuint fboTexture;
     std::shared_ptr<PostProcessing> postProcessing;
@@ -10,6 +10,14 @@
 #include "rendering/Frustum.h"
 #include "rendering/IRenderable.h"
 #include "geometry/StaticVertex.h"
+#include "geometry/MeshData.h"
+#include "geometry/VertexLayout.h"
+#include "geometry/GeometryRetention.h"
+#include "rendering/GpuUploadQueue.h"
+#include "rendering/MeshBufferArena.h"
+#include "rendering/RenderQueue.h"
+#include "rendering/OcclusionCuller.h"
+#include "rendering/GLStateCache.h"
 #include "Debug.h"
 
 // StaticGeometry class
@@ -21,8 +29,35 @@ public:
         const std::vector<unsigned int>& indices,
         const std::vector<Texture>& textures);
 
+    // Builds the geometry from an imported or warm-loaded mesh
+    StaticGeometry(const MeshData& meshData, const std::vector<Texture>& textures,
+        GeometryRetention retention = GeometryRetention::Full);
+
     virtual ~StaticGeometry();
     void draw(const glm::mat4& transform);
+
+    // Draws LOD level lod with only the bindings that differ from the previous draw of a render queue.
+    // The normal matrix comes cached with the object instead of being inverted per draw. The render
+    // queue only uses this for shaders without an instanced variant.
+    void submit(const ObjectData& object, int lod, DrawState& state);
+    // Draws instanceCount copies through the shader's INSTANCED variant. The caller binds their
+    // ObjectData to the ObjectBuffer storage block first.
+    void submitInstanced(GLsizei instanceCount, int lod, DrawState& state);
+    bool supportsInstancing();
+    // The instanced variant samples from the bindless texture sets of its batch, see BindlessTextures.
+    // Valid once supportsInstancing() has been called.
+    bool usesBindlessTextures() const { return instancedShader && instancedBindless; }
+    // Draws drawCount commands from the bound GL_DRAW_INDIRECT_BUFFER through the INSTANCED variant.
+    // Every command must come from a geometry that canBatchWith this one.
+    void submitIndirect(GLintptr commandOffset, GLsizei drawCount, DrawState& state);
+    DrawElementsIndirectCommand getDrawCommand(int lod, GLuint instanceCount, GLuint baseInstance) const;
+    // Same program, material, arena page and, unless bound bindless, textures, so only the indirect
+    // command differs
+    bool canBatchWith(const StaticGeometry& other) const;
+    // The buffers and every texture have been uploaded
+    bool isReady() const;
+    GLuint getVAO() const { return meshAllocation.vao; } // Shared with every mesh in the same arena page
+    uint64_t getTextureSetKey() const; // Equal for geometries that bind the same textures
     void addTexture(const Texture& texture);
     btCollisionShape* createBulletCollisionShape() const; // Creates and returns the Bullet collision shape
     void addToPhysicsWorld(btDiscreteDynamicsWorld* dynamicsWorld); // Adds the geometry to the specified Bullet dynamics world
@@ -69,8 +104,20 @@ public:
         return material;
     }
 
+    // Level 0 is the full mesh, higher levels are simplified index ranges over the same vertices
+    size_t getLODCount() const { return lods.size(); }
+    void setLODLevel(int level);
+    int getLODLevel() const { return lodLevel; }
+
+    // Model-space bounds, placed in the world by the transform of the node drawing the geometry
     void calculateAABB();
-    bool isInFrustum(const Frustum& frustum) const;
+    BoundingBox getBounds() const { return BoundingBox(aabbMin, aabbMax); }
+    bool isInFrustum(const Frustum& frustum, const glm::mat4& transform) const;
+
+    // Low-polygon stand-in rasterized by the occlusion culler, null for meshes too small to hide others.
+    // Picked at import: meshes named "occluder" use their full mesh, large ones their most detailed
+    // level with at most OcclusionCuller::maxOccluderTriangles triangles.
+    const OccluderMesh* getOccluder() const { return occluder.get(); }
 
     void setModelMatrix(const glm::mat4& model) { modelMatrix = model; }
     glm::mat4 getModelMatrix() const;
@@ -78,9 +125,15 @@ public:
 
 private:
     std::vector<StaticVertex> vertices;
+    std::vector<glm::vec3> collisionPositions; // Kept instead of vertices under GeometryRetention::CollisionOnly
     std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+    int lodLevel = 0;
+    size_t retainedBytes = 0;
+    size_t releasedBytes = 0;
+    bool countedInMemory = false; // Registered with GeometryMemory once data was built or retained
     std::vector<Texture> textures; // Store textures
-    GLuint VAO, VBO, EBO;
+    MeshAllocation meshAllocation; // Vertex and index ranges in the shared buffers
     std::shared_ptr<Shader> shader;
     std::shared_ptr<Material> material;
     glm::vec3 position = glm::vec3(0.0f);
@@ -89,5 +142,37 @@ private:
     glm::vec3 scale = glm::vec3(1.0f);
     glm::mat4 modelMatrix;
 
+    VertexFormat vertexFormat = VertexFormat::Float;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::shared_ptr<UploadTicket> uploadTicket;
+    mutable bool ready = false; // Stays set once everything has been uploaded
+    std::shared_ptr<const OccluderMesh> occluder;
+
+    // Resolved whenever the shader or the textures change, so drawing never looks up a name
+    struct UniformHandles {
+        Uniform<glm::mat4> model;
+        Uniform<glm::mat3> normalMatrix;
+        Uniform<float> roughness;
+        Uniform<float> tilingFactor1;
+        Uniform<float> tilingFactor2;
+        std::vector<Uniform<int>> textureSamplers; // Parallel to textures
+    };
+    UniformHandles uniforms;
+    std::shared_ptr<Shader> instancedShader; // Resolved on the first instanced draw
+    UniformHandles instancedUniforms;
+    bool instancedBindless = false;
+
+    void resolveUniforms();
+    UniformHandles resolveHandles(const Shader& program) const;
+    void bindProgram(const Shader& program, const UniformHandles& handles, DrawState& state, bool bindTextureSet = true) const;
+    void bindVertexArray(DrawState& state) const;
+    void drawElements(int lod, GLsizei instanceCount, DrawState& state) const;
+    void applyMaterial(const Shader& program, const UniformHandles& handles) const;
+    void bindTextures(const Shader& program, const UniformHandles& handles) const;
+    void retainCpuGeometry(const MeshData& meshData, GeometryRetention retention);
+    void selectOccluder(const MeshData& meshData);
+    glm::vec3 getVertexPosition(size_t index) const { return vertices.empty() ? collisionPositions[index] : vertices[index].Position; }
+    size_t getPositionCount() const { return vertices.empty() ? collisionPositions.size() : vertices.size(); }
     void setupMesh();
+    void setupMesh(const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount, std::shared_ptr<const void> keepAlive);
 };
\ No newline at end of file
@@ -1,13 +1,36 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+class UploadTicket;
+
+// GL texture object shared by every Texture that refers to it. The texture is deleted
+// when the last reference goes away.
+struct TextureResource {
+    unsigned int id = 0;
+    unsigned int target = 0;
+    size_t residentBytes = 0;
+    uint64_t bindlessHandle = 0; // Resident ARB_bindless_texture handle, made on first bindless use
+    std::shared_ptr<UploadTicket> uploadTicket;
+
+    TextureResource() = default;
+    TextureResource(const TextureResource&) = delete;
+    TextureResource& operator=(const TextureResource&) = delete;
+    ~TextureResource();
+
+    // False while uploads queued for the texture are pending, its storage is unfilled until then
+    bool isUploaded() const;
+};
 
 struct Texture {
     unsigned int id = 0; // Initialize id to 0
     std::string type;
     std::string path;
+    std::shared_ptr<TextureResource> resource; // Keeps the GL texture alive while this Texture is in use
 
     // Optionally, you can also provide a default constructor if needed
     Texture() : id(0) {} // This explicit constructor is not necessary given the in-class initializer above
 };
-
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Texture.h"
+#include "TextureManager.h"
 #include <memory>
 #include <GL/glew.h>
 #include <string>
@@ -10,13 +11,38 @@
 #include <iostream>
 #include <memory>
 #include <sstream>
+#include <mutex>
+
+// Image pixels decoded on the CPU, ready to be handed to glTexImage2D
+struct DecodedImage {
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    std::shared_ptr<unsigned char> pixels;
+
+    bool isValid() const { return pixels != nullptr; }
+};
 
 class TextureLoader {
 public:
-    static Texture loadTexture(const std::string& path);
-    static Texture createCubemap(const std::vector<std::string>& paths);
+    // Cached through the TextureManager, repeated loads share one GL texture
+    static Texture loadTexture(const std::string& path, const TextureSampling& sampling = TextureSampling());
+    static Texture createCubemap(const std::vector<std::string>& paths, const TextureSampling& sampling = TextureSampling::cubemap());
     static GLenum getGLCubemapFace(const std::string& faceName);  // Helper function
+
+    // Uncached creation, used by the TextureManager on a miss
+    static std::shared_ptr<TextureResource> createTexture(const std::string& path, const TextureSampling& sampling);
+    static std::shared_ptr<TextureResource> createCubemapTexture(const std::vector<std::string>& paths, const TextureSampling& sampling);
+
+    // Background decoding: decodeImage is safe to call from any thread. Staged images are used
+    // by loadTexture/createCubemap instead of reading the file again on the render thread.
+    static DecodedImage decodeImage(const std::string& path);
+    static void stageImage(const std::string& path, DecodedImage image);
+    static void releaseStagedImages(const std::vector<std::string>& paths);
+
 private:
     static GLenum mapFaceNameToGLenum(const std::string& faceName);
-    static std::map<std::string, GLuint> cubemapCache;
+    static DecodedImage acquireImage(const std::string& path);
+    static std::map<std::string, DecodedImage> stagedImages;
+    static std::mutex stagedImagesMutex;
 };
@@ -1,47 +1,65 @@
 #pragma once
 
-#include <map>
-#include <string>
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include "Texture.h"
-#include "stb_image.h"
-#include <imgui_impl_opengl3_loader.h>
 
+// Sampler state baked into a texture object. Part of the cache key, so the same image
+// sampled two different ways gets two textures.
+struct TextureSampling {
+    GLenum minFilter = GL_NEAREST_MIPMAP_LINEAR;
+    GLenum magFilter = GL_LINEAR;
+    GLenum wrapS = GL_REPEAT;
+    GLenum wrapT = GL_REPEAT;
+    GLenum wrapR = GL_REPEAT;
+
+    static TextureSampling cubemap() {
+        TextureSampling sampling;
+        sampling.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        sampling.wrapS = sampling.wrapT = sampling.wrapR = GL_CLAMP_TO_EDGE;
+        return sampling;
+    }
+};
+
+struct TextureCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    size_t liveTextures = 0;
+    size_t residentBytes = 0;
+};
+
+// Central registry of loaded textures, keyed by normalized file path plus sampling state.
+// Entries are weak, so a texture stays resident only while some Texture still refers to it.
 class TextureManager {
 public:
-    static std::shared_ptr<Texture> loadTexture(const std::string& path) {
-        auto it = textures.find(path);
-        if (it != textures.end()) {
-            // Texture already loaded, return it
-            return it->second;
-        }
-
-        // Load texture using OpenGL and stb_image.h
-        unsigned int textureID;
-        glGenTextures(1, &textureID);
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        // ... (OpenGL texture setup and loading using stb_image.h) ...
-        glBindTexture(GL_TEXTURE_2D, 0);
-
-        // Create and store the Texture object
-        auto texture = std::make_shared<Texture>();
-        texture->id = textureID;
-        texture->path = path; // Store path for identification
-        textures[path] = texture;
-
-        return texture;
-    }
+    static TextureManager& instance();
 
-    static std::shared_ptr<Texture> getTexture(const std::string& path) {
-        auto it = textures.find(path);
-        if (it != textures.end()) {
-            return it->second;
-        }
-        return nullptr; // Texture not found
-    }
+    Texture getTexture(const std::string& path, const TextureSampling& sampling = TextureSampling());
+    Texture getCubemap(const std::vector<std::string>& facePaths, const TextureSampling& sampling = TextureSampling::cubemap());
+
+    TextureCacheStats getStats();
 
-    // ... Additional methods as needed ...
+    // Called by TextureResource when its GL texture is deleted
+    static void onTextureReleased(size_t residentBytes);
 
 private:
-    static std::map<std::string, std::shared_ptr<Texture>> textures;
+    TextureManager() = default;
+    TextureManager(const TextureManager&) = delete;
+    TextureManager& operator=(const TextureManager&) = delete;
+
+    static std::string makeKey(const std::string& normalizedPaths, const TextureSampling& sampling);
+    std::shared_ptr<TextureResource> find(const std::string& key);
+    void pruneExpired();
+
+    std::unordered_map<std::string, std::weak_ptr<TextureResource>> textures;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    // Plain statics so resources released during shutdown never touch a destroyed registry
+    static size_t residentBytes;
 };
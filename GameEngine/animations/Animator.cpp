@@ -1,13 +1,22 @@
 #include "Animator.h"
+#include <algorithm>
 
 Animator::Animator(std::shared_ptr<Animation> animation)
     : m_CurrentTime(0.0), m_CurrentAnimation(animation) 
 {
     assert(m_CurrentAnimation != nullptr && "Animator received a null Animation object.");
-    m_FinalBoneMatrices.reserve(40);
+    ResizePalette();
+}
 
-    for (int i = 0; i < 40; i++)
-        m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
+void Animator::ResizePalette() {
+    // One matrix per bone of the skeleton, however many it has
+    int boneCount = 0;
+    if (m_CurrentAnimation) {
+        for (const auto& entry : m_CurrentAnimation->GetBoneIDMap()) {
+            boneCount = std::max(boneCount, entry.second.id + 1);
+        }
+    }
+    m_FinalBoneMatrices.assign(static_cast<size_t>(std::max(boneCount, 1)), glm::mat4(1.0f));
 }
 
 void Animator::UpdateAnimation(float dt) {
@@ -29,6 +38,7 @@ void Animator::UpdateAnimation(float dt) {
 void Animator::PlayAnimation(std::shared_ptr<Animation> pAnimation) {
     m_CurrentAnimation = pAnimation;
     m_CurrentTime = 0.0f;
+    ResizePalette();
 }
 
 void Animator::CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform) {
@@ -60,11 +70,10 @@ void Animator::CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 pare
 
     glm::mat4 globalTransformation = parentTransform * nodeTransform;
 
-    auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-    if (boneInfoMap.find(nodeName) != boneInfoMap.end()) {
-        int index = boneInfoMap[nodeName].id;
-        glm::mat4 offset = boneInfoMap[nodeName].offset;
-        m_FinalBoneMatrices[index] = globalTransformation * offset;
+    const auto& boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
+    auto boneInfo = boneInfoMap.find(nodeName);
+    if (boneInfo != boneInfoMap.end() && boneInfo->second.id >= 0 && boneInfo->second.id < static_cast<int>(m_FinalBoneMatrices.size())) {
+        m_FinalBoneMatrices[boneInfo->second.id] = globalTransformation * boneInfo->second.offset;
     }
 
     for (int i = 0; i < node->childrenCount; i++) {
@@ -72,6 +81,6 @@ void Animator::CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 pare
     }
 }
 
-std::vector<glm::mat4> Animator::GetFinalBoneMatrices() {
+const std::vector<glm::mat4>& Animator::GetFinalBoneMatrices() const {
     return m_FinalBoneMatrices;
 }
\ No newline at end of file
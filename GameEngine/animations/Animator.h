@@ -13,9 +13,11 @@ public:
     void UpdateAnimation(float dt);
     void PlayAnimation(std::shared_ptr<Animation> pAnimation);
     void CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform);
-    std::vector<glm::mat4> GetFinalBoneMatrices();
+    const std::vector<glm::mat4>& GetFinalBoneMatrices() const;
 
 private:
+    void ResizePalette();
+
     std::vector<glm::mat4> m_FinalBoneMatrices;
     std::shared_ptr<Animation> m_CurrentAnimation;
     float m_CurrentTime;
@@ -10,6 +10,14 @@
 #include "rendering/Frustum.h"
 #include "rendering/IRenderable.h"
 #include "geometry/AnimatedVertex.h"
+#include "geometry/MeshData.h"
+#include "geometry/VertexLayout.h"
+#include "geometry/GeometryRetention.h"
+#include "rendering/GpuUploadQueue.h"
+#include "rendering/MeshBufferArena.h"
+#include "rendering/RenderQueue.h"
+#include "rendering/GLStateCache.h"
+#include "rendering/BonePalette.h"
 #include "Debug.h"
 #include "animations/Animation.h"
 #include "animations/Animator.h"
@@ -24,8 +32,21 @@ public:
         const std::vector<Texture>& textures,
         const std::map<std::string, BoneInfo>& boneInfoMap);
 
+    // Builds the geometry from an imported or warm-loaded mesh
+    AnimatedGeometry(const MeshData& meshData,
+        const std::vector<Texture>& textures,
+        const std::map<std::string, BoneInfo>& boneInfoMap,
+        GeometryRetention retention = GeometryRetention::Full);
+
     virtual ~AnimatedGeometry();
     void draw(const glm::mat4& transform, Animator* animator = nullptr);
+
+    // Draws with only the bindings that differ from the previous draw of a render queue
+    void submit(const glm::mat4& transform, Animator* animator, DrawState& state);
+    // The buffers and every texture have been uploaded
+    bool isReady() const;
+    GLuint getVAO() const { return meshAllocation.vao; } // Shared with every mesh in the same arena page
+    uint64_t getTextureSetKey() const; // Equal for geometries that bind the same textures
     void addTexture(const Texture& texture);
     btCollisionShape* createBulletCollisionShape() const; // Creates and returns the Bullet collision shape
     void addToPhysicsWorld(btDiscreteDynamicsWorld* dynamicsWorld); // Adds the geometry to the specified Bullet dynamics world
@@ -65,6 +86,8 @@ public:
     void setShader(std::shared_ptr<Shader> newShader);
 
     std::shared_ptr<Shader> getShader() const;
+    // The program draws actually use, picked for the vertex format
+    const std::shared_ptr<Shader>& getDrawShader() const { return drawShader; }
 
     void setMaterial(std::shared_ptr<Material> mat);
 
@@ -76,8 +99,14 @@ public:
         return m_BoneInfoMap;
     }
 
+    // Level 0 is the full mesh, higher levels are simplified index ranges over the same vertices
+    size_t getLODCount() const { return lods.size(); }
+    void setLODLevel(int level);
+
+    // Model-space bounds, placed in the world by the transform of the node drawing the geometry
     void calculateAABB();
-    bool isInFrustum(const Frustum& frustum) const;
+    BoundingBox getBounds() const { return BoundingBox(aabbMin, aabbMax); }
+    bool isInFrustum(const Frustum& frustum, const glm::mat4& transform) const;
 
     void setModelMatrix(const glm::mat4& model) { modelMatrix = model; }
     glm::mat4 getModelMatrix() const;
@@ -85,10 +114,17 @@ public:
 
 private:
     std::vector<AnimatedVertex> vertices;
+    std::vector<glm::vec3> collisionPositions; // Kept instead of vertices under GeometryRetention::CollisionOnly
     std::vector<unsigned int> indices;
+    std::vector<MeshLod> lods;
+    int lodLevel = 0;
+    size_t retainedBytes = 0;
+    size_t releasedBytes = 0;
+    bool countedInMemory = false; // Registered with GeometryMemory once data was built or retained
     std::vector<Texture> textures; // Store textures
-    GLuint VAO, VBO, EBO;
+    MeshAllocation meshAllocation; // Vertex and index ranges in the shared buffers
     std::shared_ptr<Shader> shader;
+    std::shared_ptr<Shader> drawShader; // The shader, or its variant for the vertex format
     std::shared_ptr<Material> material;
     glm::vec3 position = glm::vec3(0.0f);
     glm::vec3 rotationAxis = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -98,5 +134,26 @@ private:
     std::unique_ptr<Animation> animation;
     std::map<std::string, BoneInfo> m_BoneInfoMap;
 
+    VertexFormat vertexFormat = VertexFormat::Float;
+    GLenum indexType = GL_UNSIGNED_INT;
+    std::shared_ptr<UploadTicket> uploadTicket;
+    mutable bool ready = false; // Stays set once everything has been uploaded
+
+    // Resolved whenever the shader or the textures change, so drawing never looks up a name
+    struct UniformHandles {
+        Uniform<glm::mat4> model;
+        Uniform<float> tilingFactor1;
+        Uniform<float> tilingFactor2;
+        std::vector<Uniform<int>> textureSamplers; // Parallel to textures
+    };
+    UniformHandles uniforms;
+
+    void resolveUniforms();
+    void applyMaterial() const;
+    void bindTextures() const;
+    void retainCpuGeometry(const MeshData& meshData, GeometryRetention retention);
+    glm::vec3 getVertexPosition(size_t index) const { return vertices.empty() ? collisionPositions[index] : vertices[index].Position; }
+    size_t getPositionCount() const { return vertices.empty() ? collisionPositions.size() : vertices.size(); }
     void setupMesh();
+    void setupMesh(const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount, std::shared_ptr<const void> keepAlive);
 };
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "AsyncModelLoader.h"
+#include "utilities/ThreadPool.h"
+#include <chrono>
+#include <iostream>
+
+AsyncModelLoader& AsyncModelLoader::instance() {
+    static AsyncModelLoader instance;
+    return instance;
+}
+
+std::shared_ptr<ModelHandle> AsyncModelLoader::loadModel(ModelLoadRequest request) {
+    auto job = std::make_unique<Job>();
+    job->handle = std::make_shared<ModelHandle>();
+    job->handle->path = request.modelPath;
+
+    // Shader compilation needs the GL context, so materials are resolved up front
+    job->materials = ModelLoader::getMaterials(request.materialPath);
+    job->imagePaths = ModelLoader::getTexturePaths(job->materials);
+
+    std::string modelPath = request.modelPath;
+    std::string animationPath = request.animationPath;
+    VertexFormat vertexFormat = request.vertexFormat;
+    std::vector<std::string> imagePaths = job->imagePaths;
+
+    job->work = ThreadPool::instance().submit([modelPath, animationPath, vertexFormat, imagePaths]() {
+        LoadedAssets assets;
+        assets.model = ModelLoader::cookModel(modelPath, vertexFormat);
+
+        if (!animationPath.empty()) {
+            if (std::filesystem::exists(animationPath)) {
+                assets.animation = std::make_shared<Animation>(animationPath, assets.model.boneInfoMap);
+            }
+            else {
+                std::cout << "Animation file not found: " << animationPath << std::endl;
+            }
+        }
+
+        // Decode images so the render thread only has to upload them
+        ThreadPool::instance().parallelFor(imagePaths.size(), [&imagePaths](size_t i) {
+            TextureLoader::stageImage(imagePaths[i], TextureLoader::decodeImage(imagePaths[i]));
+        });
+
+        return assets;
+    });
+
+    job->request = std::move(request);
+    std::shared_ptr<ModelHandle> handle = job->handle;
+    jobs.push_back(std::move(job));
+    return handle;
+}
+
+void AsyncModelLoader::update(double budgetMs) {
+    double elapsedMs = 0.0;
+
+    for (auto it = jobs.begin(); it != jobs.end();) {
+        if (advanceJob(**it, budgetMs, elapsedMs)) {
+            it = jobs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+bool AsyncModelLoader::advanceJob(Job& job, double budgetMs, double& elapsedMs) {
+    using Clock = std::chrono::high_resolution_clock;
+    ModelHandle& handle = *job.handle;
+
+    if (!job.workDone) {
+        if (job.work.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+
+        job.workDone = true;
+        try {
+            job.assets = job.work.get();
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[AsyncModelLoader] Failed to load " << handle.path << ": " << e.what() << std::endl;
+            finishJob(job, ModelHandle::State::Failed);
+            return true;
+        }
+
+        handle.boneInfoMap = job.assets.model.boneInfoMap;
+        handle.animation = job.assets.animation;
+        handle.meshCount = job.assets.model.meshes.size();
+        handle.state = ModelHandle::State::Uploading;
+    }
+
+    if (handle.cancelled) {
+        finishJob(job, ModelHandle::State::Cancelled);
+        return true;
+    }
+
+    // Create at least one node per frame so a small budget can never stall the load
+    const std::vector<MeshData>& meshes = job.assets.model.meshes;
+    while (job.nextMesh < meshes.size()) {
+        if (elapsedMs >= budgetMs && job.nextMesh > 0) {
+            return false;
+        }
+
+        auto start = Clock::now();
+        const MeshData& meshData = meshes[job.nextMesh++];
+        std::shared_ptr<Material> material = ModelLoader::selectMaterial(job.materials, meshData.materialIndex);
+        std::unique_ptr<RenderableNode> node = ModelLoader::createRenderableNode(meshData, material, job.assets.model.boneInfoMap, job.request.retention);
+        if (node) {
+            ++handle.nodesCreated;
+            if (job.request.lodManager) {
+                node->setLODManager(job.request.lodManager);
+            }
+            if (job.request.onNodeReady) {
+                job.request.onNodeReady(std::move(node), handle);
+            }
+        }
+        elapsedMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    finishJob(job, ModelHandle::State::Ready);
+    return true;
+}
+
+void AsyncModelLoader::finishJob(Job& job, ModelHandle::State state) {
+    TextureLoader::releaseStagedImages(job.imagePaths);
+    job.assets = LoadedAssets();
+    job.handle->state = state;
+
+    if (state == ModelHandle::State::Ready) {
+        std::cout << "[AsyncModelLoader] Loaded " << job.handle->path << " (" << job.handle->nodesCreated << " nodes)" << std::endl;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ModelLoader.h"
+#include "animations/Animation.h"
+#include "rendering/LODManager.h"
+
+class ModelHandle;
+
+// Called on the render thread for every node as soon as its GPU resources exist
+using NodeReadyCallback = std::function<void(std::unique_ptr<RenderableNode> node, const ModelHandle& handle)>;
+
+struct ModelLoadRequest {
+    std::string modelPath;
+    std::string materialPath;
+    std::string animationPath; // Optional, loaded on the worker once the skeleton is known
+    VertexFormat vertexFormat = VertexFormat::Float;
+    GeometryRetention retention = GeometryRetention::Full; // CPU copies kept once the meshes are on the GPU
+    std::shared_ptr<LODManager> lodManager;                // Optional, shared by every node of the model
+    NodeReadyCallback onNodeReady;
+};
+
+// Progress of one streamed model. Owned jointly by the caller and the loader.
+class ModelHandle {
+public:
+    enum class State { Loading, Uploading, Ready, Failed, Cancelled };
+
+    State getState() const { return state.load(); }
+    bool isDone() const { State current = state.load(); return current == State::Ready || current == State::Failed || current == State::Cancelled; }
+    const std::string& getPath() const { return path; }
+
+    // Valid once the model has left the Loading state
+    const std::map<std::string, BoneInfo>& getBoneInfoMap() const { return boneInfoMap; }
+    std::shared_ptr<Animation> getAnimation() const { return animation; }
+    size_t getMeshCount() const { return meshCount; }
+    size_t getNodesCreated() const { return nodesCreated; }
+
+    // Stops delivering nodes. Work already running on a worker is discarded when it finishes.
+    void cancel() { cancelled = true; }
+
+private:
+    friend class AsyncModelLoader;
+
+    std::string path;
+    std::atomic<State> state{ State::Loading };
+    std::atomic<bool> cancelled{ false };
+    std::map<std::string, BoneInfo> boneInfoMap;
+    std::shared_ptr<Animation> animation;
+    size_t meshCount = 0;
+    size_t nodesCreated = 0;
+};
+
+// Streams models in the background. Mesh import or cache mapping, image decoding and animation
+// loading run on the ThreadPool. Geometry and texture creation is drained on the render thread
+// by update(), within a per-frame time budget, so the main loop keeps presenting frames.
+class AsyncModelLoader {
+public:
+    static AsyncModelLoader& instance();
+
+    // Render thread. Materials and their shaders are created here, everything else is deferred.
+    std::shared_ptr<ModelHandle> loadModel(ModelLoadRequest request);
+
+    // Render thread, once per frame
+    void update(double budgetMs = 4.0);
+
+    size_t getPendingCount() const { return jobs.size(); }
+
+private:
+    AsyncModelLoader() = default;
+    AsyncModelLoader(const AsyncModelLoader&) = delete;
+    AsyncModelLoader& operator=(const AsyncModelLoader&) = delete;
+
+    struct LoadedAssets {
+        ModelData model;
+        std::shared_ptr<Animation> animation;
+    };
+
+    struct Job {
+        ModelLoadRequest request;
+        std::shared_ptr<ModelHandle> handle;
+        std::vector<std::shared_ptr<Material>> materials;
+        std::vector<std::string> imagePaths;
+        std::future<LoadedAssets> work;
+        LoadedAssets assets;
+        bool workDone = false;
+        size_t nextMesh = 0;
+    };
+
+    // Returns true once the job has nothing left to do
+    bool advanceJob(Job& job, double budgetMs, double& elapsedMs);
+    void finishJob(Job& job, ModelHandle::State state);
+
+    std::vector<std::unique_ptr<Job>> jobs;
+};
@@ -0,0 +1,18 @@
+#include "GeometryRetention.h"
+
+GeometryMemory& GeometryMemory::instance() {
+    static GeometryMemory instance;
+    return instance;
+}
+
+void GeometryMemory::add(size_t retainedBytes, size_t releasedBytes) {
+    ++stats.geometries;
+    stats.retainedBytes += retainedBytes;
+    stats.releasedBytes += releasedBytes;
+}
+
+void GeometryMemory::remove(size_t retainedBytes, size_t releasedBytes) {
+    --stats.geometries;
+    stats.retainedBytes -= retainedBytes;
+    stats.releasedBytes -= releasedBytes;
+}
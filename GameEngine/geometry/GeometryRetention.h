@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// What a geometry keeps in system memory once its buffers are on the GPU.
+enum class GeometryRetention {
+    Full,          // Every vertex attribute and the indices
+    CollisionOnly, // Positions and indices, enough for collision shapes and bounds
+    None           // Nothing, the bounds computed at import are kept
+};
+
+struct GeometryMemoryStats {
+    size_t geometries = 0;
+    size_t retainedBytes = 0; // CPU copies still held
+    size_t releasedBytes = 0; // What full retention would have held on top of that
+};
+
+// Running total of CPU-side geometry memory across every live geometry. Render thread only.
+class GeometryMemory {
+public:
+    static GeometryMemory& instance();
+
+    void add(size_t retainedBytes, size_t releasedBytes);
+    void remove(size_t retainedBytes, size_t releasedBytes);
+
+    const GeometryMemoryStats& getStats() const { return stats; }
+
+private:
+    GeometryMemory() = default;
+    GeometryMemory(const GeometryMemory&) = delete;
+    GeometryMemory& operator=(const GeometryMemory&) = delete;
+
+    GeometryMemoryStats stats;
+};
@@ -0,0 +1,317 @@
+#include "MeshCache.h"
+#include "io/MappedFile.h"
+#include "FileSystemUtils.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+namespace {
+    // On-disk layout. All blobs start on a 16-byte boundary so they can be used in place.
+    struct CookedHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t importFlags;
+        uint32_t meshCount;
+        uint32_t boneCount;
+        uint32_t staticVertexStride;
+        uint32_t animatedVertexStride;
+        uint32_t vertexFormat; // Requested layout, meshes that could not be packed stay in float
+    };
+
+    struct CookedBone {
+        int32_t id;
+        uint32_t nameLength;
+        float offset[16];
+    };
+
+    struct CookedMesh {
+        uint32_t animated;
+        uint32_t materialIndex;
+        float aabbMin[3];
+        float aabbMax[3];
+        float acmr[2]; // Before/after import-time optimization
+        float atvr[2];
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint32_t nameLength;
+        uint32_t vertexFormat;
+        uint32_t indexSize;
+        uint32_t lodCount; // CookedLod records follow the name
+    };
+
+    struct CookedLod {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        float error;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(CookedHeader) == 40, "Cooked header layout changed");
+    static_assert(sizeof(CookedBone) == 72, "Cooked bone layout changed");
+    static_assert(sizeof(CookedMesh) == 88, "Cooked mesh layout changed");
+    static_assert(sizeof(CookedLod) == 16, "Cooked LOD layout changed");
+
+    constexpr size_t blobAlignment = 16;
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    void appendBytes(std::vector<unsigned char>& buffer, const void* src, size_t bytes) {
+        const unsigned char* begin = static_cast<const unsigned char*>(src);
+        buffer.insert(buffer.end(), begin, begin + bytes);
+    }
+
+    void padTo(std::vector<unsigned char>& buffer, size_t alignment) {
+        buffer.resize(alignUp(buffer.size(), alignment), 0);
+    }
+
+    // 64-bit FNV-1a
+    uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= data[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Bounds-checked view into the mapped file
+    const unsigned char* readAt(const MappedFile& file, uint64_t offset, uint64_t bytes) {
+        if (offset > file.getSize() || bytes > file.getSize() - offset) {
+            return nullptr;
+        }
+        return file.getData() + offset;
+    }
+}
+
+std::string MeshCache::getCachePath(const std::string& sourcePath, unsigned int importFlags, VertexFormat vertexFormat) {
+    // Assets of the same name in different directories must not share a file, so the full path
+    // is part of the name. The source hash is checked against the header on load.
+    const std::string normalized = FileSystemUtils::normalizeAssetPath(sourcePath);
+    const uint64_t pathHash = hashBytes(reinterpret_cast<const unsigned char*>(normalized.data()), normalized.size());
+
+    std::ostringstream fileName;
+    fileName << std::filesystem::path(sourcePath).filename().string() << '-' << std::hex << std::setfill('0')
+        << std::setw(16) << pathHash << '-' << std::setw(8) << importFlags << '-' << static_cast<uint32_t>(vertexFormat) << ".meshcache";
+    return FileSystemUtils::getAssetFilePath("cache/" + fileName.str());
+}
+
+uint64_t MeshCache::hashFile(const std::string& path) {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return 0;
+    }
+
+    return hashBytes(file.getData(), file.getSize());
+}
+
+bool MeshCache::load(const std::string& cachePath, uint64_t sourceHash, unsigned int importFlags, VertexFormat vertexFormat, ModelData& model) {
+    if (sourceHash == 0 || !std::filesystem::exists(cachePath)) {
+        return false;
+    }
+
+    auto file = std::make_shared<MappedFile>(cachePath);
+    if (!file->isOpen()) {
+        return false;
+    }
+
+    const auto* header = reinterpret_cast<const CookedHeader*>(readAt(*file, 0, sizeof(CookedHeader)));
+    if (!header || std::memcmp(header->magic, magic, sizeof(magic)) != 0 || header->version != version) {
+        return false;
+    }
+
+    // Stale cache: the source asset or the import pipeline changed since it was cooked
+    if (header->sourceHash != sourceHash || header->importFlags != importFlags || header->vertexFormat != static_cast<uint32_t>(vertexFormat) ||
+        header->staticVertexStride != sizeof(StaticVertex) || header->animatedVertexStride != sizeof(AnimatedVertex)) {
+        return false;
+    }
+
+    uint64_t cursor = sizeof(CookedHeader);
+    ModelData result;
+
+    for (uint32_t i = 0; i < header->boneCount; ++i) {
+        const auto* bone = reinterpret_cast<const CookedBone*>(readAt(*file, cursor, sizeof(CookedBone)));
+        if (!bone) {
+            return false;
+        }
+        cursor += sizeof(CookedBone);
+
+        const char* name = reinterpret_cast<const char*>(readAt(*file, cursor, bone->nameLength));
+        if (!name) {
+            return false;
+        }
+        cursor = alignUp(cursor + bone->nameLength, 8);
+
+        BoneInfo info;
+        info.id = bone->id;
+        std::memcpy(&info.offset[0][0], bone->offset, sizeof(bone->offset));
+        result.boneInfoMap[std::string(name, bone->nameLength)] = info;
+    }
+
+    result.meshes.reserve(header->meshCount);
+    for (uint32_t i = 0; i < header->meshCount; ++i) {
+        const auto* cooked = reinterpret_cast<const CookedMesh*>(readAt(*file, cursor, sizeof(CookedMesh)));
+        if (!cooked) {
+            return false;
+        }
+        cursor += sizeof(CookedMesh);
+
+        const char* name = reinterpret_cast<const char*>(readAt(*file, cursor, cooked->nameLength));
+        if (!name) {
+            return false;
+        }
+        cursor = alignUp(cursor + cooked->nameLength, 8);
+
+        const auto* lods = reinterpret_cast<const CookedLod*>(readAt(*file, cursor, static_cast<uint64_t>(cooked->lodCount) * sizeof(CookedLod)));
+        if (!lods) {
+            return false;
+        }
+        cursor += static_cast<uint64_t>(cooked->lodCount) * sizeof(CookedLod);
+
+        MeshData meshData;
+        meshData.name.assign(name, cooked->nameLength);
+        for (uint32_t lod = 0; lod < cooked->lodCount; ++lod) {
+            if (static_cast<uint64_t>(lods[lod].indexOffset) + lods[lod].indexCount > cooked->indexCount) {
+                return false;
+            }
+            meshData.lods.push_back(MeshLod{ lods[lod].indexOffset, lods[lod].indexCount, lods[lod].error });
+        }
+        meshData.animated = cooked->animated != 0;
+        meshData.vertexFormat = cooked->vertexFormat == static_cast<uint32_t>(VertexFormat::Packed) ? VertexFormat::Packed : VertexFormat::Float;
+        meshData.materialIndex = cooked->materialIndex;
+        meshData.aabbMin = glm::vec3(cooked->aabbMin[0], cooked->aabbMin[1], cooked->aabbMin[2]);
+        meshData.aabbMax = glm::vec3(cooked->aabbMax[0], cooked->aabbMax[1], cooked->aabbMax[2]);
+        meshData.optimization.before = { cooked->acmr[0], cooked->atvr[0] };
+        meshData.optimization.after = { cooked->acmr[1], cooked->atvr[1] };
+
+        uint64_t vertexBytes = static_cast<uint64_t>(cooked->vertexCount) * meshData.getVertexStride();
+        if (cooked->indexSize != sizeof(uint16_t) && cooked->indexSize != sizeof(unsigned int)) {
+            return false;
+        }
+        uint64_t indexBytes = static_cast<uint64_t>(cooked->indexCount) * cooked->indexSize;
+        const unsigned char* vertexBlob = readAt(*file, cooked->vertexOffset, vertexBytes);
+        const unsigned char* indexBlob = readAt(*file, cooked->indexOffset, indexBytes);
+        if (!vertexBlob || !indexBlob || cooked->vertexOffset % blobAlignment != 0 || cooked->indexOffset % blobAlignment != 0) {
+            return false;
+        }
+
+        meshData.vertexData = vertexBlob;
+        meshData.vertexCount = cooked->vertexCount;
+        meshData.indexData = indexBlob;
+        meshData.indexCount = cooked->indexCount;
+        meshData.indexSize = cooked->indexSize;
+
+        result.meshes.push_back(std::move(meshData));
+    }
+
+    result.mappedFile = std::move(file);
+    model = std::move(result);
+    return true;
+}
+
+bool MeshCache::save(const std::string& cachePath, uint64_t sourceHash, unsigned int importFlags, VertexFormat vertexFormat, const ModelData& model) {
+    if (sourceHash == 0) {
+        return false;
+    }
+
+    std::vector<unsigned char> buffer;
+
+    CookedHeader header{};
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.sourceHash = sourceHash;
+    header.importFlags = importFlags;
+    header.meshCount = static_cast<uint32_t>(model.meshes.size());
+    header.boneCount = static_cast<uint32_t>(model.boneInfoMap.size());
+    header.staticVertexStride = sizeof(StaticVertex);
+    header.animatedVertexStride = sizeof(AnimatedVertex);
+    header.vertexFormat = static_cast<uint32_t>(vertexFormat);
+    appendBytes(buffer, &header, sizeof(header));
+
+    for (const auto& [name, info] : model.boneInfoMap) {
+        CookedBone bone{};
+        bone.id = info.id;
+        bone.nameLength = static_cast<uint32_t>(name.size());
+        std::memcpy(bone.offset, &info.offset[0][0], sizeof(bone.offset));
+        appendBytes(buffer, &bone, sizeof(bone));
+        appendBytes(buffer, name.data(), name.size());
+        padTo(buffer, 8);
+    }
+
+    // Mesh records first; their blob offsets are patched once the blobs are laid out
+    std::vector<size_t> recordOffsets;
+    recordOffsets.reserve(model.meshes.size());
+    for (const auto& meshData : model.meshes) {
+        CookedMesh cooked{};
+        cooked.animated = meshData.animated ? 1 : 0;
+        cooked.materialIndex = meshData.materialIndex;
+        for (int axis = 0; axis < 3; ++axis) {
+            cooked.aabbMin[axis] = meshData.aabbMin[axis];
+            cooked.aabbMax[axis] = meshData.aabbMax[axis];
+        }
+        cooked.acmr[0] = meshData.optimization.before.acmr;
+        cooked.acmr[1] = meshData.optimization.after.acmr;
+        cooked.atvr[0] = meshData.optimization.before.atvr;
+        cooked.atvr[1] = meshData.optimization.after.atvr;
+        cooked.vertexCount = meshData.vertexCount;
+        cooked.indexCount = meshData.indexCount;
+        cooked.indexSize = meshData.indexSize;
+        cooked.lodCount = static_cast<uint32_t>(meshData.lods.size());
+        cooked.nameLength = static_cast<uint32_t>(meshData.name.size());
+        cooked.vertexFormat = static_cast<uint32_t>(meshData.vertexFormat);
+
+        recordOffsets.push_back(buffer.size());
+        appendBytes(buffer, &cooked, sizeof(cooked));
+        appendBytes(buffer, meshData.name.data(), meshData.name.size());
+        padTo(buffer, 8);
+
+        for (const MeshLod& lod : meshData.lods) {
+            CookedLod cookedLod{};
+            cookedLod.indexOffset = lod.indexOffset;
+            cookedLod.indexCount = lod.indexCount;
+            cookedLod.error = lod.error;
+            appendBytes(buffer, &cookedLod, sizeof(cookedLod));
+        }
+    }
+
+    for (size_t i = 0; i < model.meshes.size(); ++i) {
+        const MeshData& meshData = model.meshes[i];
+
+        padTo(buffer, blobAlignment);
+        uint64_t vertexOffset = buffer.size();
+        appendBytes(buffer, meshData.vertexData, static_cast<size_t>(meshData.vertexCount) * meshData.getVertexStride());
+
+        padTo(buffer, blobAlignment);
+        uint64_t indexOffset = buffer.size();
+        appendBytes(buffer, meshData.indexData, static_cast<size_t>(meshData.indexCount) * meshData.indexSize);
+
+        auto* cooked = reinterpret_cast<CookedMesh*>(buffer.data() + recordOffsets[i]);
+        cooked->vertexOffset = vertexOffset;
+        cooked->indexOffset = indexOffset;
+    }
+
+    // Write to a temporary file and swap it in so a crash never leaves a truncated cache behind
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cachePath).parent_path(), error);
+
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, cachePath, error);
+    return !error;
+}
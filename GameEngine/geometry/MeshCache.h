@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include "geometry/MeshData.h"
+
+// Cooked on-disk mesh format. A cooked file stores ready-to-upload vertex/index blobs,
+// per-mesh AABBs, LOD ranges, material slots and the bone table of a model, keyed by the
+// hash of the source file, the Assimp import flags and the requested vertex format. Warm
+// loads map the file into memory and hand the blobs straight to glBufferData, skipping Assimp.
+class MeshCache {
+public:
+    // One file per source path, import flags and vertex format
+    static std::string getCachePath(const std::string& sourcePath, unsigned int importFlags, VertexFormat vertexFormat);
+    static uint64_t hashFile(const std::string& path);
+
+    static bool load(const std::string& cachePath, uint64_t sourceHash, unsigned int importFlags, VertexFormat vertexFormat, ModelData& model);
+    static bool save(const std::string& cachePath, uint64_t sourceHash, unsigned int importFlags, VertexFormat vertexFormat, const ModelData& model);
+
+private:
+    static constexpr char magic[4] = { 'G', 'E', 'M', 'C' };
+    static constexpr uint32_t version = 6;
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "geometry/StaticVertex.h"
+#include "geometry/AnimatedVertex.h"
+#include "geometry/PackedVertex.h"
+#include "animations/Bone.h"
+#include "geometry/MeshOptimizer.h"
+
+class MappedFile;
+
+// One level of detail: a range of the shared index buffer, all levels use the same vertices.
+struct MeshLod {
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f; // Simplification error relative to the mesh extent
+};
+
+// CPU-side result of importing one mesh, laid out exactly as it is uploaded to the GPU.
+struct MeshData {
+    std::string name;
+    bool animated = false;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    uint32_t materialIndex = 0;
+    glm::vec3 aabbMin = glm::vec3(0.0f);
+    glm::vec3 aabbMax = glm::vec3(0.0f);
+    MeshOptimizationReport optimization; // Vertex cache efficiency before/after the import-time reordering
+
+    // Upload blobs. These point either at the vectors below (fresh import)
+    // or straight into a memory-mapped cooked mesh file (warm load).
+    const void* vertexData = nullptr;
+    uint32_t vertexCount = 0;
+    const void* indexData = nullptr;
+    uint32_t indexCount = 0;
+    uint32_t indexSize = sizeof(unsigned int); // Bytes per index, 2 when every vertex is addressable with 16 bits
+    std::vector<MeshLod> lods; // Level 0 is the full mesh. Empty means a single level covering every index.
+
+    std::vector<StaticVertex> staticVertices;
+    std::vector<AnimatedVertex> animatedVertices;
+    std::vector<PackedStaticVertex> packedStaticVertices;
+    std::vector<PackedAnimatedVertex> packedAnimatedVertices;
+    std::vector<unsigned int> indices;
+    std::vector<uint16_t> shortIndices;
+
+    static constexpr uint32_t maxShortIndexVertices = 65536;
+
+    MeshData() = default;
+    MeshData(MeshData&&) = default;
+    MeshData& operator=(MeshData&&) = default;
+
+    // The blob pointers may alias the vectors, so copies would dangle
+    MeshData(const MeshData&) = delete;
+    MeshData& operator=(const MeshData&) = delete;
+
+    size_t getVertexStride() const {
+        if (vertexFormat == VertexFormat::Packed) {
+            return animated ? sizeof(PackedAnimatedVertex) : sizeof(PackedStaticVertex);
+        }
+        return animated ? sizeof(AnimatedVertex) : sizeof(StaticVertex);
+    }
+
+    // Points the upload blobs at the owned vertex/index vectors
+    void bindOwnedBuffers() {
+        if (vertexFormat == VertexFormat::Packed && animated) {
+            vertexData = packedAnimatedVertices.data();
+            vertexCount = static_cast<uint32_t>(packedAnimatedVertices.size());
+        }
+        else if (vertexFormat == VertexFormat::Packed) {
+            vertexData = packedStaticVertices.data();
+            vertexCount = static_cast<uint32_t>(packedStaticVertices.size());
+        }
+        else if (animated) {
+            vertexData = animatedVertices.data();
+            vertexCount = static_cast<uint32_t>(animatedVertices.size());
+        }
+        else {
+            vertexData = staticVertices.data();
+            vertexCount = static_cast<uint32_t>(staticVertices.size());
+        }
+        if (indexSize == sizeof(uint16_t)) {
+            indexData = shortIndices.data();
+            indexCount = static_cast<uint32_t>(shortIndices.size());
+        }
+        else {
+            indexData = indices.data();
+            indexCount = static_cast<uint32_t>(indices.size());
+        }
+    }
+
+    // Moves the owned indices to 16 bits when the mesh is small enough, halving index memory
+    bool narrowIndices() {
+        if (indexSize == sizeof(uint16_t) || vertexCount > maxShortIndexVertices) {
+            return indexSize == sizeof(uint16_t);
+        }
+
+        shortIndices.assign(indices.begin(), indices.end());
+        std::vector<unsigned int>().swap(indices);
+        indexSize = sizeof(uint16_t);
+        bindOwnedBuffers();
+        return true;
+    }
+
+    uint32_t getBaseIndexCount() const {
+        return lods.empty() ? indexCount : lods[0].indexCount;
+    }
+
+    // Widens the full-detail indices of the upload blob, whatever their width, for CPU-side users
+    void copyIndices(std::vector<unsigned int>& out) const {
+        copyIndices(out, 0, getBaseIndexCount());
+    }
+
+    // Same for count indices from offset, the range of one level of detail
+    void copyIndices(std::vector<unsigned int>& out, uint32_t offset, uint32_t count) const {
+        if (indexSize == sizeof(uint16_t)) {
+            const uint16_t* source = static_cast<const uint16_t*>(indexData) + offset;
+            out.assign(source, source + count);
+        }
+        else {
+            const unsigned int* source = static_cast<const unsigned int*>(indexData) + offset;
+            out.assign(source, source + count);
+        }
+    }
+};
+
+// All meshes of one model file plus the skeleton they reference.
+struct ModelData {
+    std::vector<MeshData> meshes;
+    std::map<std::string, BoneInfo> boneInfoMap;
+    std::shared_ptr<MappedFile> mappedFile; // Keeps warm-loaded blobs alive
+};
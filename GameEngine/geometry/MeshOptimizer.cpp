@@ -0,0 +1,270 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+    // Triangles using each vertex, stored as one flat array with per-vertex offsets
+    struct TriangleAdjacency {
+        std::vector<unsigned int> offsets;
+        std::vector<unsigned int> triangles;
+
+        TriangleAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount) {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices) {
+                ++offsets[index + 1];
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            triangles.resize(indices.size());
+            std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                triangles[cursor[indices[i]]++] = static_cast<unsigned int>(i / 3);
+            }
+        }
+    };
+
+    // FIFO cache misses for a range of triangles, starting from an empty cache
+    unsigned int countCacheMisses(const unsigned int* indices, size_t indexCount, std::vector<unsigned int>& timestamps,
+        unsigned int& time, unsigned int cacheSize) {
+        unsigned int misses = 0;
+        for (size_t i = 0; i < indexCount; ++i) {
+            unsigned int index = indices[i];
+            if (time - timestamps[index] > cacheSize) {
+                timestamps[index] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    }
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats;
+    if (indices.empty() || vertexCount == 0) {
+        return stats;
+    }
+
+    // A vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+    std::vector<unsigned int> timestamps(vertexCount, 0);
+    unsigned int time = cacheSize + 1;
+    unsigned int misses = countCacheMisses(indices.data(), indices.size(), timestamps, time, cacheSize);
+
+    std::vector<bool> referenced(vertexCount, false);
+    size_t uniqueVertices = 0;
+    for (unsigned int index : indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            ++uniqueVertices;
+        }
+    }
+
+    stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+    stats.atvr = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+    return stats;
+}
+
+std::vector<unsigned int> MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    const size_t triangleCount = indices.size() / 3;
+    std::vector<unsigned int> clusters;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    TriangleAdjacency adjacency(indices, vertexCount);
+
+    std::vector<unsigned int> liveTriangles(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        liveTriangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<unsigned int> cacheTime(vertexCount, 0);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0;
+    int fanVertex = static_cast<int>(indices[0]);
+    bool startCluster = true;
+
+    while (fanVertex >= 0) {
+        candidates.clear();
+
+        for (unsigned int a = adjacency.offsets[fanVertex]; a < adjacency.offsets[fanVertex + 1]; ++a) {
+            unsigned int triangle = adjacency.triangles[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            if (startCluster) {
+                clusters.push_back(static_cast<unsigned int>(output.size() / 3));
+                startCluster = false;
+            }
+
+            for (int corner = 0; corner < 3; ++corner) {
+                unsigned int v = indices[triangle * 3 + corner];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --liveTriangles[v];
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+            emitted[triangle] = true;
+        }
+
+        // Prefer a candidate that will still be in the cache once its remaining triangles are emitted
+        int best = -1;
+        unsigned int bestPriority = 0;
+        for (unsigned int v : candidates) {
+            if (liveTriangles[v] == 0) {
+                continue;
+            }
+            unsigned int priority = 0;
+            if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                best = static_cast<int>(v);
+                bestPriority = priority;
+            }
+        }
+
+        if (best >= 0) {
+            fanVertex = best;
+            continue;
+        }
+
+        // Dead end: back up through recently used vertices, then fall back to scanning the input.
+        // A new cluster starts whenever the next fan vertex has already left the cache.
+        fanVertex = -1;
+        while (!deadEnd.empty()) {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[v] > 0) {
+                fanVertex = static_cast<int>(v);
+                startCluster = time - cacheTime[v] > cacheSize;
+                break;
+            }
+        }
+
+        while (fanVertex < 0 && cursor < indices.size()) {
+            unsigned int v = indices[cursor++];
+            if (liveTriangles[v] > 0) {
+                fanVertex = static_cast<int>(v);
+                startCluster = true;
+            }
+        }
+    }
+
+    indices.swap(output);
+    return clusters;
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+    std::vector<unsigned int> clusters, unsigned int cacheSize, float threshold) {
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    // Soft boundaries: wherever the running ACMR of a cluster is already below the threshold,
+    // starting a new cluster costs little cache efficiency
+    std::vector<unsigned int> splitClusters;
+    std::vector<unsigned int> timestamps(positions.size(), 0);
+    unsigned int time = cacheSize + 1;
+    for (size_t c = 0; c < clusters.size(); ++c) {
+        unsigned int begin = clusters[c];
+        unsigned int end = (c + 1 < clusters.size()) ? clusters[c + 1] : static_cast<unsigned int>(triangleCount);
+
+        splitClusters.push_back(begin);
+        time += cacheSize + 1; // Flush the cache at every hard boundary
+        unsigned int misses = 0;
+        unsigned int clusterStart = begin;
+        for (unsigned int t = begin; t < end; ++t) {
+            misses += countCacheMisses(&indices[t * 3], 3, timestamps, time, cacheSize);
+            unsigned int trianglesInCluster = t + 1 - clusterStart;
+            if (t + 1 < end && static_cast<float>(misses) / trianglesInCluster < threshold) {
+                splitClusters.push_back(t + 1);
+                clusterStart = t + 1;
+                misses = 0;
+                time += cacheSize + 1;
+            }
+        }
+    }
+
+    // Mesh centroid, area weighted
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const glm::vec3& p0 = positions[indices[t * 3]];
+        const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+        const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : positions[indices[0]];
+
+    // Clusters that face away from the centre are most likely to occlude others, so they go first
+    struct ClusterKey {
+        unsigned int begin;
+        unsigned int end;
+        float sortKey;
+    };
+    std::vector<ClusterKey> keys;
+    keys.reserve(splitClusters.size());
+    for (size_t c = 0; c < splitClusters.size(); ++c) {
+        ClusterKey key;
+        key.begin = splitClusters[c];
+        key.end = (c + 1 < splitClusters.size()) ? splitClusters[c + 1] : static_cast<unsigned int>(triangleCount);
+
+        glm::vec3 centroid(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (unsigned int t = key.begin; t < key.end; ++t) {
+            const glm::vec3& p0 = positions[indices[t * 3]];
+            const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+            const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+            glm::vec3 weightedNormal = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(weightedNormal);
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+            normal += weightedNormal;
+            area += triangleArea;
+        }
+
+        if (area > 0.0f) {
+            centroid /= area;
+        }
+        float normalLength = glm::length(normal);
+        key.sortKey = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+        keys.push_back(key);
+    }
+
+    std::stable_sort(keys.begin(), keys.end(), [](const ClusterKey& a, const ClusterKey& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (const ClusterKey& key : keys) {
+        output.insert(output.end(), indices.begin() + key.begin * 3, indices.begin() + key.end * 3);
+    }
+    indices.swap(output);
+}
+
+std::vector<unsigned int> MeshOptimizer::buildFetchRemap(std::vector<unsigned int>& indices, size_t vertexCount, size_t& uniqueVertexCount) {
+    std::vector<unsigned int> remap(vertexCount, ~0u);
+    unsigned int next = 0;
+    for (unsigned int& index : indices) {
+        if (remap[index] == ~0u) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+    uniqueVertexCount = next;
+    return remap;
+}
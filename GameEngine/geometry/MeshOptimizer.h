@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Post-transform vertex cache efficiency of an index buffer, measured with a FIFO cache model.
+// ACMR is cache misses per triangle (0.5 is ideal for large regular grids, 3.0 is worst case).
+// ATVR is cache misses per referenced vertex (1.0 is ideal).
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// Import-time triangle and vertex reordering.
+// 1. Vertex cache: Tipsify (Sander, Nehab, Barczak 2007) reorders triangles for the post-transform cache.
+// 2. Overdraw: the Tipsify output is split into clusters, which are sorted outside-in by how far they
+//    face away from the mesh centre, so front-most surfaces tend to be drawn first.
+// 3. Vertex fetch: vertices are renumbered in first-use order so the vertex buffer is read linearly.
+class MeshOptimizer {
+public:
+    static constexpr unsigned int defaultCacheSize = 16;
+
+    static VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = defaultCacheSize);
+
+    // Returns the triangle index at which each cluster starts
+    static std::vector<unsigned int> optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = defaultCacheSize);
+
+    // Clusters whose local ACMR stays below threshold are split further before sorting,
+    // trading a little cache efficiency for finer overdraw ordering
+    static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+        std::vector<unsigned int> clusters, unsigned int cacheSize = defaultCacheSize, float threshold = 1.05f);
+
+    // Returns the new index of every old vertex; unreferenced vertices map to ~0u
+    static std::vector<unsigned int> buildFetchRemap(std::vector<unsigned int>& indices, size_t vertexCount, size_t& uniqueVertexCount);
+
+    // Runs all three passes on a triangle list, reordering the vertices and indices in place
+    template <typename Vertex>
+    static MeshOptimizationReport optimize(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+        MeshOptimizationReport report;
+        if (vertices.empty() || indices.size() < 3 || indices.size() % 3 != 0) {
+            return report;
+        }
+
+        report.before = analyzeVertexCache(indices, vertices.size());
+
+        std::vector<glm::vec3> positions(vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            positions[i] = vertices[i].Position;
+        }
+
+        std::vector<unsigned int> clusters = optimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, positions, std::move(clusters));
+
+        size_t uniqueVertexCount = 0;
+        std::vector<unsigned int> remap = buildFetchRemap(indices, vertices.size(), uniqueVertexCount);
+        std::vector<Vertex> reordered(uniqueVertexCount);
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            if (remap[i] != ~0u) {
+                reordered[remap[i]] = vertices[i];
+            }
+        }
+        vertices.swap(reordered);
+
+        report.after = analyzeVertexCache(indices, vertices.size());
+        return report;
+    }
+};
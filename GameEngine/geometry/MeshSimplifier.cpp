@@ -0,0 +1,369 @@
+#include "MeshSimplifier.h"
+#include "geometry/MeshData.h"
+#include "geometry/MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+    // Symmetric 4x4 error quadric plus the total area it was built from
+    struct Quadric {
+        double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+        double a11 = 0, a12 = 0, a13 = 0;
+        double a22 = 0, a23 = 0;
+        double a33 = 0;
+        double weight = 0;
+
+        void addPlane(const glm::dvec3& normal, double distance, double area) {
+            a00 += area * normal.x * normal.x; a01 += area * normal.x * normal.y; a02 += area * normal.x * normal.z; a03 += area * normal.x * distance;
+            a11 += area * normal.y * normal.y; a12 += area * normal.y * normal.z; a13 += area * normal.y * distance;
+            a22 += area * normal.z * normal.z; a23 += area * normal.z * distance;
+            a33 += area * distance * distance;
+            weight += area;
+        }
+
+        Quadric& operator+=(const Quadric& other) {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02; a03 += other.a03;
+            a11 += other.a11; a12 += other.a12; a13 += other.a13;
+            a22 += other.a22; a23 += other.a23;
+            a33 += other.a33;
+            weight += other.weight;
+            return *this;
+        }
+
+        // Area-weighted mean squared distance of p to the accumulated planes
+        double evaluate(const glm::vec3& position) const {
+            double x = position.x, y = position.y, z = position.z;
+            double error = a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+                + a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+                + a22 * z * z + 2 * a23 * z
+                + a33;
+            return weight > 0 ? std::abs(error) / weight : 0.0;
+        }
+    };
+
+    struct Collapse {
+        unsigned int from;
+        unsigned int to;
+        double error;
+    };
+
+    uint64_t edgeKey(unsigned int a, unsigned int b) {
+        return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+    }
+
+    // Maps every vertex to the first vertex with a bit-identical position
+    std::vector<unsigned int> buildPositionRemap(const std::vector<glm::vec3>& positions) {
+        struct PositionHash {
+            size_t operator()(const glm::vec3& p) const {
+                uint32_t bits[3];
+                std::memcpy(bits, &p, sizeof(bits));
+                return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+            }
+        };
+        struct PositionEqual {
+            bool operator()(const glm::vec3& a, const glm::vec3& b) const {
+                return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+            }
+        };
+
+        std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> firstVertex;
+        firstVertex.reserve(positions.size());
+
+        std::vector<unsigned int> remap(positions.size());
+        for (size_t i = 0; i < positions.size(); ++i) {
+            remap[i] = firstVertex.emplace(positions[i], static_cast<unsigned int>(i)).first->second;
+        }
+        return remap;
+    }
+
+    float skinDistance(const glm::ivec4& idsA, const glm::vec4& weightsA, const glm::ivec4& idsB, const glm::vec4& weightsB) {
+        float distance = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+            if (idsA[i] < 0) {
+                continue;
+            }
+            float other = 0.0f;
+            for (int j = 0; j < 4; ++j) {
+                if (idsB[j] == idsA[i]) {
+                    other = weightsB[j];
+                }
+            }
+            distance += std::abs(weightsA[i] - other);
+        }
+        for (int j = 0; j < 4; ++j) {
+            if (idsB[j] < 0) {
+                continue;
+            }
+            bool shared = false;
+            for (int i = 0; i < 4; ++i) {
+                shared = shared || idsA[i] == idsB[j];
+            }
+            if (!shared) {
+                distance += weightsB[j];
+            }
+        }
+        return distance;
+    }
+
+    glm::vec3 triangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+        return glm::cross(b - a, c - a);
+    }
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+    size_t targetIndexCount, float maxError, float* resultError,
+    const std::vector<glm::ivec4>* boneIDs, const std::vector<glm::vec4>* boneWeights) {
+    std::vector<unsigned int> result = indices;
+    if (resultError) {
+        *resultError = 0.0f;
+    }
+
+    const size_t vertexCount = positions.size();
+    if (vertexCount == 0 || indices.size() % 3 != 0 || result.size() <= targetIndexCount) {
+        return result;
+    }
+
+    const bool skinned = boneIDs && boneWeights && boneIDs->size() == vertexCount && boneWeights->size() == vertexCount;
+
+    glm::vec3 boundsMin = positions[0];
+    glm::vec3 boundsMax = positions[0];
+    for (const glm::vec3& position : positions) {
+        boundsMin = glm::min(boundsMin, position);
+        boundsMax = glm::max(boundsMax, position);
+    }
+    glm::vec3 size = boundsMax - boundsMin;
+    const double extent = std::max(std::max(size.x, size.y), size.z);
+    if (extent <= 0.0) {
+        return result;
+    }
+    const double errorLimit = static_cast<double>(maxError) * extent;
+    const double errorLimitSquared = errorLimit * errorLimit;
+
+    // Seams: a position shared by several vertices is locked on all of them
+    std::vector<unsigned int> positionRemap = buildPositionRemap(positions);
+    std::vector<unsigned int> verticesAtPosition(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        ++verticesAtPosition[positionRemap[i]];
+    }
+    std::vector<uint8_t> locked(vertexCount, 0);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        locked[i] = verticesAtPosition[positionRemap[i]] > 1 ? 1 : 0;
+    }
+
+    // Borders: edges used by a single triangle, matched by position so seams do not count as borders
+    std::unordered_map<uint64_t, unsigned int> edgeUse;
+    edgeUse.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            ++edgeUse[edgeKey(positionRemap[indices[i + e]], positionRemap[indices[i + (e + 1) % 3]])];
+        }
+    }
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            unsigned int a = indices[i + e];
+            unsigned int b = indices[i + (e + 1) % 3];
+            if (edgeUse[edgeKey(positionRemap[a], positionRemap[b])] == 1) {
+                locked[a] = locked[b] = 1;
+            }
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const glm::vec3& p0 = positions[indices[i]];
+        glm::dvec3 normal(triangleNormal(p0, positions[indices[i + 1]], positions[indices[i + 2]]));
+        double length = std::sqrt(glm::dot(normal, normal));
+        if (length <= 0.0) {
+            continue;
+        }
+        normal /= length;
+        double distance = -glm::dot(normal, glm::dvec3(p0));
+        double area = length * 0.5;
+        for (int corner = 0; corner < 3; ++corner) {
+            quadrics[indices[i + corner]].addPlane(normal, distance, area);
+        }
+    }
+
+    std::vector<unsigned int> collapseTo(vertexCount);
+    std::vector<uint8_t> touched(vertexCount);
+    std::vector<Collapse> candidates;
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> adjacency;
+    double maxAppliedError = 0.0;
+
+    while (result.size() > targetIndexCount) {
+        const size_t triangleCount = result.size() / 3;
+
+        // Triangles around each vertex for the flip test
+        offsets.assign(vertexCount + 1, 0);
+        for (unsigned int index : result) {
+            ++offsets[index + 1];
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        adjacency.resize(result.size());
+        std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            adjacency[cursor[result[i]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        candidates.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                unsigned int a = result[i + e];
+                unsigned int b = result[i + (e + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    unsigned int from = direction == 0 ? a : b;
+                    unsigned int to = direction == 0 ? b : a;
+                    if (locked[from]) {
+                        continue;
+                    }
+                    if (skinned && skinDistance((*boneIDs)[from], (*boneWeights)[from], (*boneIDs)[to], (*boneWeights)[to]) > maxSkinDistance) {
+                        continue;
+                    }
+                    Quadric combined = quadrics[from];
+                    combined += quadrics[to];
+                    double error = combined.evaluate(positions[to]);
+                    if (error <= errorLimitSquared) {
+                        candidates.push_back({ from, to, error });
+                    }
+                }
+            }
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+        std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t remainingTriangles = triangleCount;
+        size_t collapses = 0;
+
+        for (const Collapse& collapse : candidates) {
+            if (remainingTriangles * 3 <= targetIndexCount) {
+                break;
+            }
+            if (touched[collapse.from] || touched[collapse.to]) {
+                continue;
+            }
+
+            // Reject collapses that fold a surviving triangle over
+            bool flips = false;
+            size_t removed = 0;
+            for (unsigned int t = offsets[collapse.from]; t < offsets[collapse.from + 1] && !flips; ++t) {
+                const unsigned int* triangle = &result[static_cast<size_t>(adjacency[t]) * 3];
+                if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+                    ++removed;
+                    continue;
+                }
+
+                glm::vec3 corners[3];
+                glm::vec3 moved[3];
+                for (int corner = 0; corner < 3; ++corner) {
+                    corners[corner] = positions[triangle[corner]];
+                    moved[corner] = triangle[corner] == collapse.from ? positions[collapse.to] : corners[corner];
+                }
+                glm::vec3 before = triangleNormal(corners[0], corners[1], corners[2]);
+                glm::vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+                double dot = glm::dot(before, after);
+                double lengths = std::sqrt(static_cast<double>(glm::dot(before, before)) * glm::dot(after, after));
+                flips = dot < 0.25 * lengths;
+            }
+            if (flips) {
+                continue;
+            }
+
+            collapseTo[collapse.from] = collapse.to;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            maxAppliedError = std::max(maxAppliedError, collapse.error);
+            remainingTriangles -= removed;
+            ++collapses;
+
+            // Neighbouring triangles changed shape, leave them for the next pass
+            for (unsigned int t = offsets[collapse.from]; t < offsets[collapse.from + 1]; ++t) {
+                const unsigned int* triangle = &result[static_cast<size_t>(adjacency[t]) * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = 1;
+            }
+        }
+
+        if (collapses == 0) {
+            break;
+        }
+
+        // Apply the collapses and drop triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            unsigned int a = collapseTo[result[i]];
+            unsigned int b = collapseTo[result[i + 1]];
+            unsigned int c = collapseTo[result[i + 2]];
+            if (a != b && b != c && a != c) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    if (resultError) {
+        *resultError = static_cast<float>(std::sqrt(maxAppliedError) / extent);
+    }
+    return result;
+}
+
+void MeshSimplifier::generateLods(MeshData& meshData) {
+    const std::vector<unsigned int> baseIndices = meshData.indices;
+    meshData.lods.assign(1, MeshLod{ 0, static_cast<uint32_t>(baseIndices.size()), 0.0f });
+
+    if (baseIndices.size() / 3 < minLodTriangles) {
+        return;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::ivec4> boneIDs;
+    std::vector<glm::vec4> boneWeights;
+    if (meshData.animated) {
+        positions.reserve(meshData.animatedVertices.size());
+        boneIDs.reserve(meshData.animatedVertices.size());
+        boneWeights.reserve(meshData.animatedVertices.size());
+        for (const AnimatedVertex& vertex : meshData.animatedVertices) {
+            positions.push_back(vertex.Position);
+            boneIDs.push_back(vertex.BoneIDs);
+            boneWeights.push_back(vertex.Weights);
+        }
+    }
+    else {
+        positions.reserve(meshData.staticVertices.size());
+        for (const StaticVertex& vertex : meshData.staticVertices) {
+            positions.push_back(vertex.Position);
+        }
+    }
+
+    // Every level is simplified from the full mesh, so its error is measured against the original
+    size_t previousCount = baseIndices.size();
+    for (int level = 1; level <= maxLodLevels; ++level) {
+        size_t target = static_cast<size_t>(baseIndices.size() / 3 * std::pow(lodReduction, level)) * 3;
+        float maxError = lodErrorBound * static_cast<float>(1 << (level - 1));
+
+        float error = 0.0f;
+        std::vector<unsigned int> lod = simplify(baseIndices, positions, target, maxError, &error,
+            meshData.animated ? &boneIDs : nullptr, meshData.animated ? &boneWeights : nullptr);
+
+        // Not worth a level when the error bound or the locked seams stopped the reduction early
+        if (lod.empty() || lod.size() > previousCount * 4 / 5) {
+            break;
+        }
+
+        MeshOptimizer::optimizeVertexCache(lod, positions.size());
+
+        meshData.lods.push_back(MeshLod{ static_cast<uint32_t>(meshData.indices.size()), static_cast<uint32_t>(lod.size()), error });
+        meshData.indices.insert(meshData.indices.end(), lod.begin(), lod.end());
+        previousCount = lod.size();
+    }
+
+    meshData.bindOwnedBuffers();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+struct MeshData;
+
+// Quadric error metric simplification (Garland, Heckbert 1997) by edge collapse onto existing
+// vertices, so every level of detail is just another index list over the same vertex buffer.
+// Vertices on open borders and on attribute seams (several vertices sharing one position) are
+// locked, which keeps UV and normal seams from tearing. On skinned meshes a vertex only collapses
+// onto one with similar bone weights, so joints keep deforming the way they were authored.
+class MeshSimplifier {
+public:
+    static constexpr int maxLodLevels = 3;
+    static constexpr float lodReduction = 0.5f;      // Triangle budget of each level relative to the previous one
+    static constexpr float lodErrorBound = 0.01f;     // Allowed error of LOD 1 relative to the mesh extent, doubled per level
+    static constexpr float maxSkinDistance = 0.5f;   // L1 distance between the bone weights of two collapsing vertices
+    static constexpr size_t minLodTriangles = 64;
+
+    // Reduces the triangle list towards targetIndexCount without exceeding maxError (relative to the
+    // mesh extent). resultError receives the error actually reached. boneIDs/boneWeights are optional.
+    static std::vector<unsigned int> simplify(const std::vector<unsigned int>& indices, const std::vector<glm::vec3>& positions,
+        size_t targetIndexCount, float maxError, float* resultError = nullptr,
+        const std::vector<glm::ivec4>* boneIDs = nullptr, const std::vector<glm::vec4>* boneWeights = nullptr);
+
+    // Appends up to maxLodLevels simplified index lists to an imported mesh and records them in meshData.lods.
+    // Must run on the float vertices, before packing and index narrowing.
+    static void generateLods(MeshData& meshData);
+};
@@ -1,9 +1,15 @@
 #include "ModelLoader.h"
+#include "utilities/ThreadPool.h"
+#include "geometry/MeshOptimizer.h"
+#include "geometry/VertexLayout.h"
+#include "geometry/MeshSimplifier.h"
+#include <chrono>
+#include <limits>
 
 std::unordered_map<std::string, std::vector<std::shared_ptr<Material>>> materialCache; // Global material cache
-std::map<std::string, BoneInfo> ModelLoader::m_BoneInfoMap;
-int ModelLoader::m_BoneCounter = 0;
-Assimp::Importer ModelLoader::importer;
+
+// Changing these invalidates every cooked mesh file, the flags are part of the cache key
+const unsigned int ModelLoader::importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality;
 
 // Helper function to determine file extension
 std::string getFileExtension(const std::string& filename) {
@@ -22,162 +28,218 @@ void NormalizeVertexWeights(AnimatedVertex& vertex) {
     }
 }
 
+// Per-mesh vertex cache efficiency of the cooked index buffers (ACMR: misses per triangle, ATVR: misses per vertex)
+// and the triangle count of every level of detail
+void logOptimizationReport(const ModelData& model) {
+    for (const MeshData& meshData : model.meshes) {
+        const MeshOptimizationReport& report = meshData.optimization;
+        std::cout << "[MeshOptimizer] " << meshData.name
+                  << ": ACMR " << report.before.acmr << " -> " << report.after.acmr
+                  << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << std::endl;
+
+        if (meshData.lods.size() > 1) {
+            std::cout << "[MeshSimplifier] " << meshData.name << ":";
+            for (const MeshLod& lod : meshData.lods) {
+                std::cout << " " << lod.indexCount / 3 << " (" << lod.error * 100.0f << "%)";
+            }
+            std::cout << " triangles" << std::endl;
+        }
+    }
+}
+
 std::vector<std::unique_ptr<RenderableNode>> ModelLoader::loadModel(const std::string& path, const std::string& materialPath) {
+    std::map<std::string, BoneInfo> boneInfoMap;
+    return loadModel(path, materialPath, boneInfoMap);
+}
 
-    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_JoinIdenticalVertices | aiProcess_ImproveCacheLocality);
+std::vector<std::unique_ptr<RenderableNode>> ModelLoader::loadModel(const std::string& path, const std::string& materialPath, std::map<std::string, BoneInfo>& boneInfoMap) {
+    ModelData model = cookModel(path);
+    std::vector<std::shared_ptr<Material>> materials = getMaterials(materialPath);
 
-    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
-        throw std::runtime_error("Failed to load model");
+    std::vector<std::unique_ptr<RenderableNode>> renderableNodes;
+
+    for (const MeshData& meshData : model.meshes) {
+        std::shared_ptr<Material> material = selectMaterial(materials, meshData.materialIndex);
+        std::unique_ptr<RenderableNode> renderableNode = createRenderableNode(meshData, material, model.boneInfoMap);
+        if (renderableNode) {
+            renderableNodes.push_back(std::move(renderableNode));
+        }
     }
 
-    std::vector<std::unique_ptr<IRenderable>> renderables;
-    std::vector<std::shared_ptr<Material>> materials;
+    boneInfoMap = std::move(model.boneInfoMap);
+    return renderableNodes;
+}
 
+std::vector<std::shared_ptr<Material>> ModelLoader::getMaterials(const std::string& materialPath) {
     // Check if the materials for the given materialPath are already in the cache
     auto cacheIt = materialCache.find(materialPath);
     if (cacheIt != materialCache.end()) {
         // Materials found in cache, retrieve them
-        materials = cacheIt->second;
-    }
-    else {
-        // Materials not in cache, load them and add them to the cache
-        materials = loadMaterials(materialPath);
-        materialCache[materialPath] = materials;
+        return cacheIt->second;
     }
 
-    std::vector<std::unique_ptr<RenderableNode>> renderableNodes;
+    // Materials not in cache, load them and add them to the cache
+    std::vector<std::shared_ptr<Material>> materials = loadMaterials(materialPath);
+    materialCache[materialPath] = materials;
+    return materials;
+}
 
-    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[i];
+std::shared_ptr<Material> ModelLoader::selectMaterial(const std::vector<std::shared_ptr<Material>>& materials, uint32_t materialIndex) {
+    if (materials.empty()) {
+        return nullptr;
+    }
+    return (materialIndex < materials.size()) ? materials[materialIndex] : materials.front();
+}
 
-        std::shared_ptr<Material> material = nullptr;
-        if (!materials.empty()) {
-            material = (i < materials.size()) ? materials[i] : materials.front();
+std::vector<std::string> ModelLoader::getTexturePaths(const std::vector<std::shared_ptr<Material>>& materials) {
+    std::vector<std::string> paths;
+    for (const auto& material : materials) {
+        if (!material) {
+            continue;
         }
 
-        std::unique_ptr<RenderableNode> renderableNode;
-        if (mesh->HasBones()) {
-            renderableNode = processAnimatedMesh(mesh, scene, material);
-        }
-        else {
-            renderableNode = processStaticMesh(mesh, scene, material);
-        }
-
-        if (renderableNode) {
-            renderableNodes.push_back(std::move(renderableNode));
+        for (const auto& [unit, textureName] : material->getTextures()) {
+            if (unit == "environment") {
+                for (const auto& [faceName, path] : material->getCubemapFaces()) {
+                    paths.push_back(FileSystemUtils::getAssetFilePath("textures/" + path));
+                }
+            }
+            else {
+                paths.push_back(FileSystemUtils::getAssetFilePath("textures/" + textureName));
+            }
         }
     }
 
-    return renderableNodes;
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    return paths;
 }
 
-std::vector<std::shared_ptr<Material>> ModelLoader::loadMaterials(const std::string& materialPath) {
-    std::vector<std::shared_ptr<Material>> materials;
+ModelData ModelLoader::cookModel(const std::string& path, VertexFormat vertexFormat) {
+    std::string cachePath = MeshCache::getCachePath(path, importFlags, vertexFormat);
+    uint64_t sourceHash = MeshCache::hashFile(path);
 
-    // Check file extension
-    std::string extension = getFileExtension(materialPath);
-    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower); // Ensure extension is lowercase
-
-    //std::cout << "Loading materials from file: " << materialPath << " (extension: " << extension << ")" << std::endl;
+    ModelData model;
+    if (MeshCache::load(cachePath, sourceHash, importFlags, vertexFormat, model)) {
+        std::cout << "[ModelLoader] Warm load of " << path << " from " << cachePath << std::endl;
+        logOptimizationReport(model);
+        return model;
+    }
 
-    if (extension == ".txt") {
-        // It's a material list file
-        auto materialFiles = readMaterialList(materialPath);
-        //std::cout << "Read " << materialFiles.size() << " material files from list" << std::endl;
+    model = importModel(path, vertexFormat);
+    logOptimizationReport(model);
 
-        for (const auto& materialFile : materialFiles) {
-            //std::cout << "Parsing material file: " << materialFile << std::endl;
-            materials.push_back(std::make_shared<Material>(MaterialParser::parseMaterialXML(materialFile)));
-        }
-    }
-    else if (extension == ".xml") {
-        // It's a single material file
-        //std::cout << "Parsing single material file: " << materialPath << std::endl;
-        materials.push_back(std::make_shared<Material>(MaterialParser::parseMaterialXML(materialPath)));
+    if (!MeshCache::save(cachePath, sourceHash, importFlags, vertexFormat, model)) {
+        std::cerr << "[ModelLoader] Failed to write cooked mesh cache: " << cachePath << std::endl;
     }
 
-    //std::cout << "Loaded " << materials.size() << " materials" << std::endl;
-
-    return materials;
+    return model;
 }
 
-std::unique_ptr<RenderableNode> ModelLoader::processStaticMesh(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Material> material) {
-    // Log number of meshes and current mesh pointer
-    DEBUG_COUT << "[Info] Processing mesh " << scene->mNumMeshes << ", pointer: " << mesh << std::endl;
+ModelData ModelLoader::importModel(const std::string& path, VertexFormat vertexFormat) {
+    // One importer per load, so several models can be imported at the same time
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, importFlags);
 
-    // Validate mesh pointer
-    if (!mesh) {
-        std::cerr << "[Error] Skipping mesh due to null pointer." << std::endl;
-        return nullptr;
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        throw std::runtime_error("Failed to load model");
     }
 
-    // Log mesh vertex count
-    DEBUG_COUT << "[Info] Mesh vertex count: " << mesh->mNumVertices << std::endl;
+    ModelData model;
 
-    // Initialize data structures
-    std::vector<StaticVertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    // Bone IDs are handed out up front so they do not depend on which worker finishes first.
+    // After this the skeleton is only read, which is safe from every worker.
+    assignBoneIDs(scene, model.boneInfoMap);
 
-    // Process vertices
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        StaticVertex vertex;
+    // Vertex, index and weight extraction is pure CPU work on the read-only scene, one mesh per task
+    std::vector<MeshData> processed(scene->mNumMeshes);
+    ThreadPool::instance().parallelFor(scene->mNumMeshes, [&](size_t i) {
+        aiMesh* mesh = scene->mMeshes[i];
+        if (!mesh) {
+            return;
+        }
 
-        // Extract and log position
-        vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
-        DEBUG_COUT << "[Info] Vertex " << i << " position: (" << vertex.Position.x << ", " << vertex.Position.y << ", " << vertex.Position.z << ")" << std::endl;
+        processed[i] = mesh->HasBones() ? processAnimatedMesh(mesh, scene, model.boneInfoMap) : processStaticMesh(mesh, scene);
+        processed[i].materialIndex = static_cast<uint32_t>(i);
 
-        // Check and handle normals
-        if (mesh->HasNormals()) {
-            vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-            DEBUG_COUT << "[Info] Vertex " << i << " normal: (" << vertex.Normal.x << ", " << vertex.Normal.y << ", " << vertex.Normal.z << ")" << std::endl;
-        }
-        else {
-            vertex.Normal = glm::vec3(0.0f);
-            DEBUG_COUT << "[Info] Vertex " << i << " has no normal, assigning default (0, 0, 0)" << std::endl;
+        // Levels of detail are simplified from the float vertices, so they come before packing
+        MeshSimplifier::generateLods(processed[i]);
+        if (vertexFormat == VertexFormat::Packed) {
+            VertexLayout::pack(processed[i]);
         }
+        processed[i].narrowIndices();
+    });
 
-        // Check and handle texture coordinates
-        if (mesh->mTextureCoords[0]) {
-            vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-            DEBUG_COUT << "[Info] Vertex " << i << " texture coordinates: (" << vertex.TexCoords.x << ", " << vertex.TexCoords.y << ")" << std::endl;
+    model.meshes.reserve(scene->mNumMeshes);
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        // Validate mesh pointer
+        if (!scene->mMeshes[i]) {
+            std::cerr << "[Error] Skipping mesh due to null pointer." << std::endl;
+            continue;
         }
-        else {
-            vertex.TexCoords = glm::vec2(0.0f);
-            DEBUG_COUT << "[Info] Vertex " << i << " has no texture coordinates, assigning default (0, 0)" << std::endl;
+        if (processed[i].vertexFormat != vertexFormat) {
+            std::cout << "[ModelLoader] " << processed[i].name << " keeps the float vertex layout, its UVs or bone IDs do not fit the packed one" << std::endl;
         }
+        model.meshes.push_back(std::move(processed[i]));
+    }
 
-        if (mesh->HasTextureCoords(1)) { // Check for the existence of the second UV set
-            vertex.LightMapTexCoords = glm::vec2(mesh->mTextureCoords[1][i].x, mesh->mTextureCoords[1][i].y);
+    return model;
+}
+
+void ModelLoader::assignBoneIDs(const aiScene* scene, std::map<std::string, BoneInfo>& boneInfoMap) {
+    int boneCounter = 0;
+    for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; ++meshIndex) {
+        const aiMesh* mesh = scene->mMeshes[meshIndex];
+        if (!mesh) {
+            continue;
         }
-        else {
-            vertex.LightMapTexCoords = glm::vec2(0.0f); // or some default value
+
+        for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex) {
+            std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
+            if (boneInfoMap.find(boneName) == boneInfoMap.end()) {
+                BoneInfo newBoneInfo;
+                newBoneInfo.id = boneCounter++;
+                newBoneInfo.offset = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
+                boneInfoMap[boneName] = newBoneInfo;
+            }
         }
+    }
+}
 
-        vertices.push_back(vertex);
+std::unique_ptr<RenderableNode> ModelLoader::createRenderableNode(const MeshData& meshData, std::shared_ptr<Material> material, const std::map<std::string, BoneInfo>& boneInfoMap,
+    GeometryRetention retention) {
+    if (meshData.vertexCount == 0 || meshData.indexCount == 0) {
+        std::cerr << "[Error] Skipping empty mesh: " << meshData.name << std::endl;
+        return nullptr;
     }
 
-    // Process indices
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        // Log face index and number of indices
-        DEBUG_COUT << "[Info] Face " << i << ", number of indices: " << face.mNumIndices << std::endl;
+    std::vector<Texture> textures = loadMeshTextures(material);
 
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
-            DEBUG_COUT << "[Info] Face " << i << ", index " << j << ": " << face.mIndices[j] << std::endl;
-        }
+    if (meshData.animated) {
+        auto geometry = std::make_unique<AnimatedGeometry>(meshData, textures, boneInfoMap, retention);
+        geometry->setMaterial(material);
+        return std::make_unique<RenderableNode>(meshData.name, std::move(geometry));
+    }
+
+    auto geometry = std::make_unique<StaticGeometry>(meshData, textures, retention);
+    geometry->setMaterial(material);
+    return std::make_unique<RenderableNode>(meshData.name, std::move(geometry));
+}
+
+std::vector<Texture> ModelLoader::loadMeshTextures(const std::shared_ptr<Material>& material) {
+    std::vector<Texture> textures;
+    if (!material) {
+        return textures;
     }
 
-    // Process textures
     for (const auto& [unit, textureName] : material->getTextures()) {
         if (unit == "environment") {
             // Retrieve cubemap faces from the material
             auto cubemapFaces = material->getCubemapFaces(); // Function to retrieve map of faces
             std::vector<std::string> paths;
 
-            DEBUG_COUT << "Cubemap faces order from processStaticMesh:" << std::endl;
+            DEBUG_COUT << "Cubemap faces order from loadMeshTextures:" << std::endl;
             for (const auto& [faceName, path] : cubemapFaces) {
                 std::string fullPath = FileSystemUtils::getAssetFilePath("textures/" + path);
                 paths.push_back(fullPath); // Collect all paths for the cubemap
@@ -208,135 +270,168 @@ std::unique_ptr<RenderableNode> ModelLoader::processStaticMesh(aiMesh* mesh, con
         }
     }
 
-    auto geometry = std::make_unique<StaticGeometry>(vertices, indices, textures);
-    geometry->setMaterial(material);
+    return textures;
+}
+
+std::vector<std::shared_ptr<Material>> ModelLoader::loadMaterials(const std::string& materialPath) {
+    std::vector<std::shared_ptr<Material>> materials;
+
+    // Check file extension
+    std::string extension = getFileExtension(materialPath);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower); // Ensure extension is lowercase
+
+    //std::cout << "Loading materials from file: " << materialPath << " (extension: " << extension << ")" << std::endl;
+
+    if (extension == ".txt") {
+        // It's a material list file
+        auto materialFiles = readMaterialList(materialPath);
+        //std::cout << "Read " << materialFiles.size() << " material files from list" << std::endl;
 
-    return std::make_unique<RenderableNode>(mesh->mName.C_Str(), std::move(geometry));
+        for (const auto& materialFile : materialFiles) {
+            //std::cout << "Parsing material file: " << materialFile << std::endl;
+            materials.push_back(std::make_shared<Material>(MaterialParser::parseMaterialXML(materialFile)));
+        }
+    }
+    else if (extension == ".xml") {
+        // It's a single material file
+        //std::cout << "Parsing single material file: " << materialPath << std::endl;
+        materials.push_back(std::make_shared<Material>(MaterialParser::parseMaterialXML(materialPath)));
+    }
+
+    //std::cout << "Loaded " << materials.size() << " materials" << std::endl;
+
+    return materials;
 }
 
-std::unique_ptr<RenderableNode> ModelLoader::processAnimatedMesh(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Material> material) {
+MeshData ModelLoader::processStaticMesh(aiMesh* mesh, const aiScene* scene) {
     // Log number of meshes and current mesh pointer
     DEBUG_COUT << "[Info] Processing mesh " << scene->mNumMeshes << ", pointer: " << mesh << std::endl;
 
-    // Validate mesh pointer
-    if (!mesh) {
-        std::cerr << "[Error] Skipping mesh due to null pointer." << std::endl;
-        return nullptr;
+    // Log mesh vertex count
+    DEBUG_COUT << "[Info] Mesh vertex count: " << mesh->mNumVertices << std::endl;
+
+    MeshData meshData;
+    meshData.name = mesh->mName.C_Str();
+    meshData.animated = false;
+
+    std::vector<StaticVertex>& vertices = meshData.staticVertices;
+    vertices.resize(mesh->mNumVertices);
+
+    const bool hasNormals = mesh->HasNormals();
+    const bool hasTexCoords = mesh->mTextureCoords[0] != nullptr;
+    const bool hasLightMapTexCoords = mesh->HasTextureCoords(1); // Check for the existence of the second UV set
+
+    // Process vertices
+    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+        StaticVertex& vertex = vertices[i];
+
+        // Extract and log position
+        vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        DEBUG_COUT << "[Info] Vertex " << i << " position: (" << vertex.Position.x << ", " << vertex.Position.y << ", " << vertex.Position.z << ")" << std::endl;
+
+        // Check and handle normals
+        vertex.Normal = hasNormals ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f);
+
+        // Check and handle texture coordinates
+        vertex.TexCoords = hasTexCoords ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) : glm::vec2(0.0f);
+        vertex.LightMapTexCoords = hasLightMapTexCoords ? glm::vec2(mesh->mTextureCoords[1][i].x, mesh->mTextureCoords[1][i].y) : glm::vec2(0.0f);
+    }
+
+    // Compute the model-space bounds once at import
+    if (!vertices.empty()) {
+        meshData.aabbMin = meshData.aabbMax = vertices[0].Position;
+        for (const auto& vertex : vertices) {
+            meshData.aabbMin = glm::min(meshData.aabbMin, vertex.Position);
+            meshData.aabbMax = glm::max(meshData.aabbMax, vertex.Position);
+        }
     }
 
+    // Process indices (the importer triangulates, so every face has three indices)
+    meshData.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        meshData.indices.insert(meshData.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+    }
+
+    // Reorder for the post-transform cache, overdraw and vertex fetch before the data is cooked
+    meshData.optimization = MeshOptimizer::optimize(vertices, meshData.indices);
+
+    meshData.bindOwnedBuffers();
+    return meshData;
+}
+
+MeshData ModelLoader::processAnimatedMesh(aiMesh* mesh, const aiScene* scene, const std::map<std::string, BoneInfo>& boneInfoMap) {
+    // Log number of meshes and current mesh pointer
+    DEBUG_COUT << "[Info] Processing mesh " << scene->mNumMeshes << ", pointer: " << mesh << std::endl;
+
     // Log mesh vertex count
     DEBUG_COUT << "[Info] Mesh vertex count: " << mesh->mNumVertices << std::endl;
 
-    // Initialize data structures
-    std::vector<AnimatedVertex> vertices;
-    std::vector<unsigned int> indices;
-    std::vector<Texture> textures;
+    MeshData meshData;
+    meshData.name = mesh->mName.C_Str();
+    meshData.animated = true;
+
+    std::vector<AnimatedVertex>& vertices = meshData.animatedVertices;
+    vertices.resize(mesh->mNumVertices);
+
+    const bool hasNormals = mesh->HasNormals();
+    const bool hasTexCoords = mesh->mTextureCoords[0] != nullptr;
+    const bool hasTangents = mesh->HasTangentsAndBitangents();
 
     // Process vertices
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        AnimatedVertex vertex;
+        AnimatedVertex& vertex = vertices[i];
 
         // Extract and log position
         vertex.Position = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
         DEBUG_COUT << "[Info] Vertex " << i << " position: (" << vertex.Position.x << ", " << vertex.Position.y << ", " << vertex.Position.z << ")" << std::endl;
 
         // Check and handle normals
-        if (mesh->HasNormals()) {
-            vertex.Normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-            DEBUG_COUT << "[Info] Vertex " << i << " normal: (" << vertex.Normal.x << ", " << vertex.Normal.y << ", " << vertex.Normal.z << ")" << std::endl;
-        }
-        else {
-            vertex.Normal = glm::vec3(0.0f);
-            DEBUG_COUT << "[Info] Vertex " << i << " has no normal, assigning default (0, 0, 0)" << std::endl;
-        }
+        vertex.Normal = hasNormals ? glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z) : glm::vec3(0.0f);
 
         // Check and handle texture coordinates
-        if (mesh->mTextureCoords[0]) {
-            vertex.TexCoords = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-            DEBUG_COUT << "[Info] Vertex " << i << " texture coordinates: (" << vertex.TexCoords.x << ", " << vertex.TexCoords.y << ")" << std::endl;
-        }
-        else {
-            vertex.TexCoords = glm::vec2(0.0f);
-            DEBUG_COUT << "[Info] Vertex " << i << " has no texture coordinates, assigning default (0, 0)" << std::endl;
-        }
+        vertex.TexCoords = hasTexCoords ? glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y) : glm::vec2(0.0f);
 
         // Check and handle tangents and bitangents
-        if (mesh->HasTangentsAndBitangents()) {
+        if (hasTangents) {
             vertex.Tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
             vertex.Bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
-            DEBUG_COUT << "[Info] Vertex " << i << " tangent: (" << vertex.Tangent.x << ", " << vertex.Tangent.y << ", " << vertex.Tangent.z << ")" << std::endl;
-            DEBUG_COUT << "[Info] Vertex " << i << " bitangent: (" << vertex.Bitangent.x << ", " << vertex.Bitangent.y << ", " << vertex.Bitangent.z << ")" << std::endl;
         }
         else {
             vertex.Tangent = glm::vec3(0.0f);
             vertex.Bitangent = glm::vec3(0.0f);
-            DEBUG_COUT << "[Info] Vertex " << i << " has no tangent/bitangent, assigning default (0, 0, 0)" << std::endl;
         }
 
-        // Extract bone IDs and weights
         SetVertexBoneDataToDefault(vertex);
-        ExtractBoneWeightForVertices(vertex, mesh, i);
-        NormalizeVertexWeights(vertex);
-
-        vertices.push_back(vertex);
     }
 
-    // Process indices
-    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
-        // Log face index and number of indices
-        DEBUG_COUT << "[Info] Face " << i << ", number of indices: " << face.mNumIndices << std::endl;
-
-        for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
-            DEBUG_COUT << "[Info] Face " << i << ", index " << j << ": " << face.mIndices[j] << std::endl;
-        }
+    // Extract bone IDs and weights
+    ExtractBoneWeights(vertices, mesh, boneInfoMap);
+    for (AnimatedVertex& vertex : vertices) {
+        NormalizeVertexWeights(vertex);
     }
 
-    // Process textures
-    for (const auto& [unit, textureName] : material->getTextures()) {
-        if (unit == "environment") {
-            // Retrieve cubemap faces from the material
-            auto cubemapFaces = material->getCubemapFaces(); // Function to retrieve map of faces
-            std::vector<std::string> paths;
-
-            DEBUG_COUT << "Cubemap faces order from processAnimatedMesh:" << std::endl;
-            for (const auto& [faceName, path] : cubemapFaces) {
-                std::string fullPath = FileSystemUtils::getAssetFilePath("textures/" + path);
-                paths.push_back(fullPath); // Collect all paths for the cubemap
-
-                DEBUG_COUT << "Face: " << faceName << ", Path: " << fullPath << std::endl;
-            }
-
-            // Use the new method to get or create a cubemap from the paths
-            Texture cubemapTexture = TextureLoader::createCubemap(paths);
-            if (cubemapTexture.id != 0) { // Check if texture was successfully created or retrieved from cache
-                cubemapTexture.type = "environment";
-                textures.push_back(cubemapTexture); // Push back the created or cached cubemap texture to the geometry's textures list
-                DEBUG_COUT << "Cubemap texture added to textures vector. Type: " << cubemapTexture.type << ", ID: " << cubemapTexture.id << std::endl;
-            }
-            else {
-                std::cerr << "Failed to load or retrieve cubemap texture." << std::endl;
-            }
-        }
-        else {
-            // Load other textures normally
-            std::string fullPath = FileSystemUtils::getAssetFilePath("textures/" + textureName);
-            Texture texture = TextureLoader::loadTexture(fullPath);
-            if (texture.id != 0) { // Assuming 0 is used to denote failure to load
-                texture.type = unit;
-                texture.path = fullPath;
-                textures.push_back(texture);
-            }
+    // Compute the model-space bounds once at import
+    if (!vertices.empty()) {
+        meshData.aabbMin = meshData.aabbMax = vertices[0].Position;
+        for (const auto& vertex : vertices) {
+            meshData.aabbMin = glm::min(meshData.aabbMin, vertex.Position);
+            meshData.aabbMax = glm::max(meshData.aabbMax, vertex.Position);
         }
     }
 
-    auto geometry = std::make_unique<AnimatedGeometry>(vertices, indices, textures, m_BoneInfoMap);
-    geometry->setMaterial(material);
+    // Process indices (the importer triangulates, so every face has three indices)
+    meshData.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        meshData.indices.insert(meshData.indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+    }
 
-    auto renderableNode = std::make_unique<RenderableNode>(mesh->mName.C_Str(), std::move(geometry));
+    // Reorder for the post-transform cache, overdraw and vertex fetch before the data is cooked
+    meshData.optimization = MeshOptimizer::optimize(vertices, meshData.indices);
 
-    return renderableNode;
+    meshData.bindOwnedBuffers();
+    return meshData;
 }
 
 std::vector<std::string> ModelLoader::readMaterialList(const std::string& materialListFile) {
@@ -357,44 +452,95 @@ void ModelLoader::SetVertexBoneDataToDefault(AnimatedVertex& vertex) {
     vertex.Weights = glm::vec4(0.0f);
 }
 
-void ModelLoader::ExtractBoneWeightForVertices(AnimatedVertex& vertex, aiMesh* mesh, int vertexIndex) {
-    for (int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex) {
-        std::string boneName = mesh->mBones[boneIndex]->mName.C_Str();
-        int boneID;
-        if (m_BoneInfoMap.find(boneName) == m_BoneInfoMap.end()) {
-            BoneInfo newBoneInfo;
-            newBoneInfo.id = m_BoneCounter;
-            newBoneInfo.offset = AssimpGLMHelpers::ConvertMatrixToGLMFormat(mesh->mBones[boneIndex]->mOffsetMatrix);
-            m_BoneInfoMap[boneName] = newBoneInfo;
-            boneID = m_BoneCounter++;
-        }
-        else {
-            boneID = m_BoneInfoMap[boneName].id;
+void ModelLoader::ExtractBoneWeights(std::vector<AnimatedVertex>& vertices, aiMesh* mesh, const std::map<std::string, BoneInfo>& boneInfoMap) {
+    // Walk each bone's weight list once and scatter the weights into the vertices they affect,
+    // so the cost is linear in the number of weights instead of vertices x bones x weights
+    for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex) {
+        const aiBone* bone = mesh->mBones[boneIndex];
+        auto boneIt = boneInfoMap.find(bone->mName.C_Str());
+        if (boneIt == boneInfoMap.end()) {
+            continue;
         }
+        int boneID = boneIt->second.id;
 
-        auto weights = mesh->mBones[boneIndex]->mWeights;
-        for (int weightIndex = 0; weightIndex < mesh->mBones[boneIndex]->mNumWeights; ++weightIndex) {
-            if (weights[weightIndex].mVertexId == vertexIndex) {
-                float weight = weights[weightIndex].mWeight;
-                SetVertexBoneData(vertex, boneID, weight);
-                break;
+        for (unsigned int weightIndex = 0; weightIndex < bone->mNumWeights; ++weightIndex) {
+            const aiVertexWeight& vertexWeight = bone->mWeights[weightIndex];
+            if (vertexWeight.mVertexId >= vertices.size() || vertexWeight.mWeight <= 0.0f) {
+                continue;
             }
+            SetVertexBoneData(vertices[vertexWeight.mVertexId], boneID, vertexWeight.mWeight);
         }
     }
 }
 
 void ModelLoader::SetVertexBoneData(AnimatedVertex& vertex, int boneID, float weight) {
-    for (int i = 0; i < 4; ++i) {
+    // Take a free slot if there is one, otherwise replace the weakest influence when this one is
+    // stronger. The vertex ends up with its MAX_BONE_INFLUENCE largest weights, renormalized later.
+    int weakest = 0;
+    for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
         if (vertex.BoneIDs[i] < 0) {
             vertex.Weights[i] = weight;
             vertex.BoneIDs[i] = boneID;
-            break;
+            return;
         }
+        if (vertex.Weights[i] < vertex.Weights[weakest]) {
+            weakest = i;
+        }
+    }
+
+    if (weight > vertex.Weights[weakest]) {
+        vertex.Weights[weakest] = weight;
+        vertex.BoneIDs[weakest] = boneID;
     }
 }
 
-const std::map<std::string, BoneInfo>& ModelLoader::getBoneInfoMap() {
-    return m_BoneInfoMap;
+void ModelLoader::benchmarkImport(const std::string& path, int iterations) {
+    using Clock = std::chrono::high_resolution_clock;
+    iterations = std::max(iterations, 1);
+
+    Assimp::Importer importer;
+    auto readStart = Clock::now();
+    const aiScene* scene = importer.ReadFile(path, importFlags);
+    double readMs = std::chrono::duration<double, std::milli>(Clock::now() - readStart).count();
+
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "ERROR::ASSIMP::" << importer.GetErrorString() << std::endl;
+        return;
+    }
+
+    std::map<std::string, BoneInfo> boneInfoMap;
+    assignBoneIDs(scene, boneInfoMap);
+
+    std::cout << "[ModelLoader] Import benchmark for " << path << " (" << iterations << " iterations, best time)" << std::endl;
+    std::cout << "  Assimp ReadFile: " << readMs << " ms" << std::endl;
+
+    size_t totalVertices = 0;
+    double totalMs = 0.0;
+    for (unsigned int i = 0; i < scene->mNumMeshes; i++) {
+        aiMesh* mesh = scene->mMeshes[i];
+        if (!mesh || !mesh->HasBones()) {
+            continue;
+        }
+
+        size_t weightCount = 0;
+        for (unsigned int boneIndex = 0; boneIndex < mesh->mNumBones; ++boneIndex) {
+            weightCount += mesh->mBones[boneIndex]->mNumWeights;
+        }
+
+        double bestMs = std::numeric_limits<double>::max();
+        for (int iteration = 0; iteration < iterations; ++iteration) {
+            auto start = Clock::now();
+            MeshData meshData = processAnimatedMesh(mesh, scene, boneInfoMap);
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        totalVertices += mesh->mNumVertices;
+        totalMs += bestMs;
+        std::cout << "  " << mesh->mName.C_Str() << ": " << mesh->mNumVertices << " vertices, " << mesh->mNumBones << " bones, "
+            << weightCount << " weights, " << bestMs << " ms (" << (mesh->mNumVertices ? bestMs * 1.0e6 / mesh->mNumVertices : 0.0) << " ns/vertex)" << std::endl;
+    }
+
+    std::cout << "  Skinned total: " << totalVertices << " vertices in " << totalMs << " ms" << std::endl;
 }
 
 
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// Vertex layout of a cooked mesh. Chosen per asset when it is loaded.
+enum class VertexFormat : uint32_t {
+    Float = 0,  // StaticVertex / AnimatedVertex, full precision
+    Packed = 1  // PackedStaticVertex / PackedAnimatedVertex
+};
+
+// 24 bytes instead of 40.
+// Normal: snorm 10_10_10_2. UVs: half floats.
+struct PackedStaticVertex {
+    glm::vec3 Position;
+    uint32_t Normal;
+    uint32_t TexCoords;
+    uint32_t LightMapTexCoords;
+};
+
+// 32 bytes instead of 96.
+// Normal and tangent: snorm 10_10_10_2, with the bitangent handedness in the tangent's w.
+// The bitangent itself is rebuilt in the vertex shader. Bone IDs: uint8. Weights: unorm8.
+struct PackedAnimatedVertex {
+    glm::vec3 Position;
+    uint32_t Normal;
+    uint32_t Tangent;
+    uint32_t TexCoords;
+    uint8_t BoneIDs[4];
+    uint8_t Weights[4];
+};
+
+static_assert(sizeof(PackedStaticVertex) == 24, "Packed static vertex layout changed");
+static_assert(sizeof(PackedAnimatedVertex) == 32, "Packed animated vertex layout changed");
@@ -1,199 +1,423 @@
 #include "StaticGeometry.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
 
 StaticGeometry::StaticGeometry()
-	: VAO(0), VBO(0), EBO(0), shader(nullptr) {
+	: shader(nullptr) {
 }
 
 StaticGeometry::StaticGeometry(const std::vector<StaticVertex>& vertices,
 	const std::vector<unsigned int>& indices,
 	const std::vector<Texture>& textures)
 	: vertices(vertices), indices(indices), textures(textures),
-	VAO(0), VBO(0), EBO(0), shader(nullptr) {
+	shader(nullptr) {
+	lods.assign(1, MeshLod{ 0, static_cast<uint32_t>(this->indices.size()), 0.0f });
+	retainedBytes = this->vertices.size() * sizeof(StaticVertex) + this->indices.size() * sizeof(unsigned int);
+	GeometryMemory::instance().add(retainedBytes, releasedBytes);
+	countedInMemory = true;
 	setupMesh();
 	calculateAABB();
 }
 
+StaticGeometry::StaticGeometry(const MeshData& meshData, const std::vector<Texture>& textures, GeometryRetention retention)
+	: textures(textures), shader(nullptr) {
+	vertexFormat = meshData.vertexFormat;
+	indexType = meshData.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	lods = meshData.lods;
+	if (lods.empty()) {
+		lods.push_back(MeshLod{ 0, meshData.indexCount, 0.0f });
+	}
+	retainCpuGeometry(meshData, retention);
+
+	// Bounds were computed at import time, no need to walk the vertices again
+	aabbMin = meshData.aabbMin;
+	aabbMax = meshData.aabbMax;
+	selectOccluder(meshData);
+
+	// The blobs may live in a mapped cache file or a short-lived import, so the upload keeps its own copy
+	size_t vertexBytes = static_cast<size_t>(meshData.vertexCount) * meshData.getVertexStride();
+	size_t indexBytes = static_cast<size_t>(meshData.indexCount) * meshData.indexSize;
+	auto blob = std::make_shared<std::vector<unsigned char>>(vertexBytes + indexBytes);
+	std::memcpy(blob->data(), meshData.vertexData, vertexBytes);
+	std::memcpy(blob->data() + vertexBytes, meshData.indexData, indexBytes);
+	setupMesh(blob->data(), meshData.vertexCount, blob->data() + vertexBytes, meshData.indexCount, blob);
+}
+
 StaticGeometry::~StaticGeometry() {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	if (countedInMemory) {
+		GeometryMemory::instance().remove(retainedBytes, releasedBytes);
+	}
+	if (uploadTicket) {
+		uploadTicket->cancel();
+	}
+	MeshBufferArena::instance().release(meshAllocation);
 }
 
-void StaticGeometry::setupMesh() {
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
+void StaticGeometry::retainCpuGeometry(const MeshData& meshData, GeometryRetention retention) {
+	// The GPU upload works from its own copy of the blobs, so nothing here is needed for drawing
+	if (retention == GeometryRetention::Full) {
+		VertexLayout::unpack(meshData, vertices);
+		meshData.copyIndices(indices);
+	}
+	else if (retention == GeometryRetention::CollisionOnly) {
+		VertexLayout::copyPositions(meshData, collisionPositions);
+		meshData.copyIndices(indices);
+	}
 
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(StaticVertex), &vertices[0], GL_STATIC_DRAW);
+	size_t fullBytes = static_cast<size_t>(meshData.vertexCount) * sizeof(StaticVertex) + static_cast<size_t>(meshData.getBaseIndexCount()) * sizeof(unsigned int);
+	retainedBytes = vertices.size() * sizeof(StaticVertex) + collisionPositions.size() * sizeof(glm::vec3) + indices.size() * sizeof(unsigned int);
+	releasedBytes = fullBytes > retainedBytes ? fullBytes - retainedBytes : 0;
+	GeometryMemory::instance().add(retainedBytes, releasedBytes);
+	countedInMemory = true;
+}
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+void StaticGeometry::selectOccluder(const MeshData& meshData) {
+	std::string name = meshData.name;
+	std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	const bool authored = name.find("occluder") != std::string::npos;
 
-	// Vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)0);
+	// No view of the mesh covers more than the half area of its bounds
+	if (!authored && getBounds().getHalfArea() < OcclusionCuller::minOccluderArea) {
+		return;
+	}
 
-	// Vertex normals (if needed in shader)
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, Normal));
+	const MeshLod* level = nullptr;
+	for (const MeshLod& lod : lods) {
+		if (authored || (lod.indexCount / 3 <= OcclusionCuller::maxOccluderTriangles && lod.error <= OcclusionCuller::maxOccluderLodError)) {
+			level = &lod;
+			break;
+		}
+	}
+	if (!level) {
+		return;
+	}
 
-	// Vertex texture coords (first UV channel)
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, TexCoords));
+	std::vector<glm::vec3> positions;
+	std::vector<unsigned int> levelIndices;
+	VertexLayout::copyPositions(meshData, positions);
+	meshData.copyIndices(levelIndices, level->indexOffset, level->indexCount);
+	OccluderMesh mesh = OccluderMesh::build(positions, levelIndices);
+	if (authored || mesh.area >= OcclusionCuller::minOccluderArea) {
+		occluder = std::make_shared<const OccluderMesh>(std::move(mesh));
+	}
+}
 
-	// Assuming LightMapTexCoords is properly set in your Vertex struct
-	glEnableVertexAttribArray(3); // Assuming location 3 for lightmap UVs
-	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(StaticVertex), (void*)offsetof(StaticVertex, LightMapTexCoords));
+void StaticGeometry::setupMesh() {
+	setupMesh(vertices.data(), static_cast<uint32_t>(vertices.size()), indices.data(), static_cast<uint32_t>(indices.size()), nullptr);
+}
 
-	glBindVertexArray(0);
+void StaticGeometry::setupMesh(const void* vertexData, uint32_t vertexCount, const void* indexData, uint32_t indexCount, std::shared_ptr<const void> keepAlive) {
+	MeshBufferFormat format;
+	format.animated = false;
+	format.vertexFormat = vertexFormat;
+	format.indexType = indexType;
+
+	// The contents are streamed in by the upload queue, the geometry is skipped until they arrive
+	uploadTicket = std::make_shared<UploadTicket>();
+	ready = false;
+	meshAllocation = MeshBufferArena::instance().allocate(format, vertexData, vertexCount, indexData, indexCount, uploadTicket, std::move(keepAlive));
 }
 
 void StaticGeometry::draw(const glm::mat4& transform) {
+	GLenum error;
+	while ((error = glGetError()) != GL_NO_ERROR) {
+		std::cerr << "OpenGL Error before setting uniforms: " << error << std::endl;
+	}
+
+	// Nothing is known about the current state, so every binding is made
+	GLStateCache& glState = GLStateCache::instance();
+	glState.invalidate();
+	DrawState state;
+	submit(ObjectData(transform), lodLevel, state);
+	glState.bindVertexArray(0);
+	glState.activeTexture(0); // Reset active texture unit after binding
+
+	// Check for errors after drawing
+	while ((error = glGetError()) != GL_NO_ERROR) {
+		std::cerr << "OpenGL Error after drawing: " << error << std::endl;
+	}
+}
+
+void StaticGeometry::submit(const ObjectData& object, int lod, DrawState& state) {
+	if (!isReady()) {
+		return;
+	}
+
 	if (!shader || !shader->Program) {
 		std::cerr << "Shader not set or invalid for geometry, cannot draw." << std::endl;
 		return;
 	}
 
-	shader->use();
+	bindProgram(*shader, uniforms, state);
 
-	GLenum error;
-	while ((error = glGetError()) != GL_NO_ERROR) {
-		std::cerr << "OpenGL Error before setting uniforms: " << error << std::endl;
+	// Pass the matrices to the shader.
+	shader->set(uniforms.model, object.model);
+
+	if (uniforms.normalMatrix.isValid()) {
+		shader->set(uniforms.normalMatrix, object.getNormalMatrix());
 	}
 
-	if (material) {
-		const Technique& technique = material->getTechniqueDetails();
+	drawElements(lod, 1, state);
+}
 
-		// Check and apply face culling state
-		if (technique.enableFaceCulling) {
-			glEnable(GL_CULL_FACE);
-		}
-		else {
-			glDisable(GL_CULL_FACE);
+bool StaticGeometry::supportsInstancing() {
+	if (!shader || !shader->Program) {
+		return false;
+	}
+	if (!instancedShader) {
+		instancedShader = shader->getInstancedVariant();
+		if (instancedShader) {
+			instancedUniforms = resolveHandles(*instancedShader);
+			instancedBindless = instancedShader->findUniformBlock("MaterialTextures") != nullptr;
 		}
+	}
+	return instancedShader != nullptr;
+}
 
-		// Apply blending state
-		if (technique.blending.enabled) {
-			glEnable(GL_BLEND);
-			glBlendFunc(technique.blending.src, technique.blending.dest);
-			glBlendEquation(technique.blending.equation);
-		}
-		else {
-			glDisable(GL_BLEND);
-		}
+void StaticGeometry::submitInstanced(GLsizei instanceCount, int lod, DrawState& state) {
+	if (!isReady() || !supportsInstancing()) {
+		return;
+	}
 
-		if (technique.enableDepthTest) {
-			glEnable(GL_DEPTH_TEST);
-			glDepthFunc(technique.depthFunc);
-		}
-		else {
-			glDisable(GL_DEPTH_TEST);
-		}
+	// The object data comes from the ObjectBuffer range bound by the caller, as do the
+	// texture sets of a bindless variant
+	bindProgram(*instancedShader, instancedUniforms, state, !instancedBindless);
+	drawElements(lod, instanceCount, state);
+}
 
-		// Set tiling factor for the first detail texture if available
-		if (material->hasParameter("TilingFactor1")) {
-			float tilingFactor1 = material->getParameter("TilingFactor1");
-			shader->setFloat("TilingFactor1", tilingFactor1);
-		}
+void StaticGeometry::submitIndirect(GLintptr commandOffset, GLsizei drawCount, DrawState& state) {
+	if (!isReady() || !supportsInstancing()) {
+		return;
+	}
 
-		// Set tiling factor for the second detail texture if available
-		if (material->hasParameter("TilingFactor2")) {
-			float tilingFactor2 = material->getParameter("TilingFactor2");
-			shader->setFloat("TilingFactor2", tilingFactor2);
-		}
+	bindProgram(*instancedShader, instancedUniforms, state, !instancedBindless);
+	bindVertexArray(state);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, indexType, (const void*)commandOffset, drawCount, 0);
+}
 
-		// Set material roughness parameter for materials that use this parameter
-		if (material->hasParameter("roughness")) {
-			float roughnessValue = material->getParameter("roughness");
-			shader->setFloat("roughness", roughnessValue);
-		}
+DrawElementsIndirectCommand StaticGeometry::getDrawCommand(int lod, GLuint instanceCount, GLuint baseInstance) const {
+	const MeshLod& range = lods[std::clamp(lod, 0, static_cast<int>(lods.size()) - 1)];
+	DrawElementsIndirectCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = instanceCount;
+	command.firstIndex = meshAllocation.firstIndex + range.indexOffset;
+	command.baseVertex = static_cast<GLint>(meshAllocation.baseVertex);
+	command.baseInstance = baseInstance;
+	return command;
+}
+
+bool StaticGeometry::canBatchWith(const StaticGeometry& other) const {
+	// Sharing the shader means sharing its instanced variant, bindless or not
+	return shader == other.shader && material == other.material && meshAllocation.vao == other.meshAllocation.vao &&
+		(usesBindlessTextures() || getTextureSetKey() == other.getTextureSetKey());
+}
+
+void StaticGeometry::bindProgram(const Shader& program, const UniformHandles& handles, DrawState& state, bool bindTextureSet) const {
+	// Uniforms belong to the program, so switching it invalidates the material and texture bindings too
+	const bool programChanged = state.program != program.Program;
+	if (programChanged) {
+		GLStateCache::instance().useProgram(program.Program);
+		state.program = program.Program;
+		++state.programChanges;
 	}
 
-	// Pass the matrices to the shader.
-	shader->setMat4("model", transform);
+	if (programChanged || !state.materialApplied || state.material != material.get()) {
+		applyMaterial(program, handles);
+		state.material = material.get();
+		state.materialApplied = true;
+		++state.materialChanges;
+	}
 
-	if (shader->hasUniform("normalMatrix")) {
-		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(transform)));
-		shader->setMat3("normalMatrix", normalMatrix);
+	if (!bindTextureSet) {
+		// Sampled through bindless handles, whatever is bound to the units is left alone
+		state.texturesBound = false;
+		return;
 	}
 
-	// Check for errors after setting uniforms
-	while ((error = glGetError()) != GL_NO_ERROR) {
-		std::cerr << "OpenGL Error after setting matrix uniforms: " << error << std::endl;
+	const uint64_t textureSet = getTextureSetKey();
+	if (programChanged || !state.texturesBound || state.textureSet != textureSet) {
+		bindTextures(program, handles);
+		state.textureSet = textureSet;
+		state.texturesBound = true;
+		++state.textureChanges;
 	}
+}
 
-	GLint maxTextureUnits;
-	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+void StaticGeometry::bindVertexArray(DrawState& state) const {
+	if (state.vao != meshAllocation.vao) {
+		DEBUG_COUT << "Drawing geometry with VAO ID: " << meshAllocation.vao << std::endl;
+		GLStateCache::instance().bindVertexArray(meshAllocation.vao);
+		state.vao = meshAllocation.vao;
+		++state.vaoChanges;
+	}
+}
 
-	// Use the Material::textureUniformMap to get the correct uniform names
-	for (size_t i = 0; i < textures.size() && i < static_cast<size_t>(maxTextureUnits); ++i) {
-		glActiveTexture(GL_TEXTURE0 + i);
+void StaticGeometry::drawElements(int lod, GLsizei instanceCount, DrawState& state) const {
+	bindVertexArray(state);
+
+	const MeshLod& range = lods[std::clamp(lod, 0, static_cast<int>(lods.size()) - 1)];
+	const size_t indexSize = indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int);
+	const void* offset = (void*)((static_cast<size_t>(meshAllocation.firstIndex) + range.indexOffset) * indexSize);
+	const GLint baseVertex = static_cast<GLint>(meshAllocation.baseVertex);
+	if (instanceCount == 1) {
+		glDrawElementsBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), indexType, offset, baseVertex);
+	}
+	else {
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, static_cast<GLsizei>(range.indexCount), indexType, offset, instanceCount, baseVertex);
+	}
+}
+
+void StaticGeometry::applyMaterial(const Shader& program, const UniformHandles& handles) const {
+	if (!material) {
+		return;
+	}
+
+	const Technique& technique = material->getTechniqueDetails();
+	GLStateCache& glState = GLStateCache::instance();
+
+	// Check and apply face culling state
+	glState.setCapability(GL_CULL_FACE, technique.enableFaceCulling);
+
+	// Apply blending state
+	glState.setCapability(GL_BLEND, technique.blending.enabled);
+	if (technique.blending.enabled) {
+		glState.blendFunc(technique.blending.src, technique.blending.dest);
+		glState.blendEquation(technique.blending.equation);
+	}
+
+	glState.setCapability(GL_DEPTH_TEST, technique.enableDepthTest);
+	if (technique.enableDepthTest) {
+		glState.depthFunc(technique.depthFunc);
+	}
+
+	// Set tiling factor for the first detail texture if available
+	if (material->hasParameter("TilingFactor1")) {
+		float tilingFactor1 = material->getParameter("TilingFactor1");
+		program.set(handles.tilingFactor1, tilingFactor1);
+	}
+
+	// Set tiling factor for the second detail texture if available
+	if (material->hasParameter("TilingFactor2")) {
+		float tilingFactor2 = material->getParameter("TilingFactor2");
+		program.set(handles.tilingFactor2, tilingFactor2);
+	}
+
+	// Set material roughness parameter for materials that use this parameter
+	if (material->hasParameter("roughness")) {
+		float roughnessValue = material->getParameter("roughness");
+		program.set(handles.roughness, roughnessValue);
+	}
+}
+
+void StaticGeometry::bindTextures(const Shader& program, const UniformHandles& handles) const {
+	GLStateCache& glState = GLStateCache::instance();
+	const size_t count = std::min<size_t>({ textures.size(), static_cast<size_t>(glState.getMaxTextureUnits()),
+		static_cast<size_t>(GLStateCache::maxBatchedTextures) });
+	GLenum targets[GLStateCache::maxBatchedTextures];
+	GLuint ids[GLStateCache::maxBatchedTextures];
+
+	for (size_t i = 0; i < count; ++i) {
+		ids[i] = textures[i].id;
 
 		// Check if the texture is a cubemap
 		if (textures[i].type == "environment") {
-			glBindTexture(GL_TEXTURE_CUBE_MAP, textures[i].id);
-			shader->setInt("environmentMap", i); // Set the cubemap uniform to the correct texture unit
+			targets[i] = GL_TEXTURE_CUBE_MAP;
 		}
 		else {
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
-
-			// Look up the uniform name from the map using the texture type
-			auto uniformNameIt = Material::textureUniformMap.find(textures[i].type);
-			if (uniformNameIt != Material::textureUniformMap.end()) {
-				// Use the found uniform name to set the texture uniform in the shader
-				shader->setInt(uniformNameIt->second, i);
-				DEBUG_COUT << "Binding texture " << textures[i].path << " to " << uniformNameIt->second << std::endl;
-			}
-			else {
-				std::cerr << "No uniform name found for texture type: " << textures[i].type << std::endl;
-			}
+			targets[i] = GL_TEXTURE_2D;
 		}
-	}
 
-	// Check for errors after texture binding
-	while ((error = glGetError()) != GL_NO_ERROR) {
-		std::cerr << "OpenGL Error after binding textures: " << error << std::endl;
+		// Point the sampler resolved for this texture at its unit
+		if (i < handles.textureSamplers.size() && handles.textureSamplers[i].isValid()) {
+			program.set(handles.textureSamplers[i], static_cast<int>(i));
+		}
 	}
 
-	DEBUG_COUT << "Drawing geometry with VAO ID: " << VAO << std::endl;
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(indices.size()), GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
-	glActiveTexture(GL_TEXTURE0); // Reset active texture unit after binding
+	glState.bindTextures(0, static_cast<GLsizei>(count), targets, ids);
+}
 
-	// Check for errors after drawing
-	while ((error = glGetError()) != GL_NO_ERROR) {
-		std::cerr << "OpenGL Error after drawing: " << error << std::endl;
+uint64_t StaticGeometry::getTextureSetKey() const {
+	// FNV-1a over the texture IDs, in binding order
+	uint64_t key = 14695981039346656037ull;
+	for (const Texture& texture : textures) {
+		key = (key ^ texture.id) * 1099511628211ull;
 	}
+	return key;
+}
+
+bool StaticGeometry::isReady() const {
+	// Textures stream in through the same queue, drawing before they land samples unfilled storage
+	if (!ready) {
+		ready = (!uploadTicket || uploadTicket->isComplete()) && std::all_of(textures.begin(), textures.end(),
+			[](const Texture& texture) { return !texture.resource || texture.resource->isUploaded(); });
+	}
+	return ready;
 }
 
 void StaticGeometry::addTexture(const Texture& texture) {
 	textures.push_back(texture);
+	ready = false;
+	resolveUniforms();
 }
 
 void StaticGeometry::setMaterial(std::shared_ptr<Material> mat) {
 	material = std::move(mat); // Assume ownership or shared reference of the passed material
 	// Directly assign the shader std::shared_ptr from the material's shader program
 	shader = material->getShaderProgram(); // This should return std::shared_ptr<Shader>
+	resolveUniforms();
+}
+
+void StaticGeometry::resolveUniforms() {
+	uniforms = UniformHandles();
+	instancedShader.reset();
+	instancedUniforms = UniformHandles();
+	instancedBindless = false;
+	if (!shader || !shader->Program) {
+		return;
+	}
+
+	uniforms = resolveHandles(*shader);
+}
+
+StaticGeometry::UniformHandles StaticGeometry::resolveHandles(const Shader& program) const {
+	UniformHandles handles;
+	handles.model = program.getUniform<glm::mat4>("model");
+	handles.normalMatrix = program.getUniform<glm::mat3>("normalMatrix");
+	handles.roughness = program.getUniform<float>("roughness");
+	handles.tilingFactor1 = program.getUniform<float>("TilingFactor1");
+	handles.tilingFactor2 = program.getUniform<float>("TilingFactor2");
+
+	// Use the Material::textureUniformMap to get the correct uniform names
+	for (const Texture& texture : textures) {
+		auto uniformNameIt = Material::textureUniformMap.find(texture.type);
+		if (uniformNameIt == Material::textureUniformMap.end()) {
+			std::cerr << "No uniform name found for texture type: " << texture.type << std::endl;
+			handles.textureSamplers.emplace_back();
+			continue;
+		}
+		handles.textureSamplers.push_back(program.getUniform<int>(uniformNameIt->second));
+		DEBUG_COUT << "Binding texture " << texture.path << " to " << uniformNameIt->second << std::endl;
+	}
+	return handles;
 }
 
 btCollisionShape* StaticGeometry::createBulletCollisionShape() const {
+	if (indices.empty() || getPositionCount() == 0) {
+		std::cerr << "[StaticGeometry] CPU geometry was released after upload, cannot build a collision shape" << std::endl;
+		return nullptr;
+	}
+
 	auto mesh = new btTriangleMesh();
 
 	for (size_t i = 0; i < indices.size(); i += 3) {
-		int index0 = indices[i];
-		int index1 = indices[i + 1];
-		int index2 = indices[i + 2];
+		glm::vec3 v0 = getVertexPosition(indices[i]);
+		glm::vec3 v1 = getVertexPosition(indices[i + 1]);
+		glm::vec3 v2 = getVertexPosition(indices[i + 2]);
 
-		const StaticVertex& v0 = vertices[index0];
-		const StaticVertex& v1 = vertices[index1];
-		const StaticVertex& v2 = vertices[index2];
-
-		btVector3 vertex0(v0.Position.x, v0.Position.y, v0.Position.z);
-		btVector3 vertex1(v1.Position.x, v1.Position.y, v1.Position.z);
-		btVector3 vertex2(v2.Position.x, v2.Position.y, v2.Position.z);
+		btVector3 vertex0(v0.x, v0.y, v0.z);
+		btVector3 vertex1(v1.x, v1.y, v1.z);
+		btVector3 vertex2(v2.x, v2.y, v2.z);
 
 		mesh->addTriangle(vertex0, vertex1, vertex2);
 	}
@@ -206,6 +430,9 @@ btCollisionShape* StaticGeometry::createBulletCollisionShape() const {
 
 void StaticGeometry::addToPhysicsWorld(btDiscreteDynamicsWorld* dynamicsWorld) {
 	btCollisionShape* shape = createBulletCollisionShape();
+	if (!shape) {
+		return;
+	}
 
 	// Obtain the model matrix that combines position, rotation, and scale
 	glm::mat4 modelMatrix = getModelMatrix();
@@ -231,39 +458,25 @@ void StaticGeometry::addToPhysicsWorld(btDiscreteDynamicsWorld* dynamicsWorld) {
 	dynamicsWorld->addRigidBody(body);
 }
 
+void StaticGeometry::setLODLevel(int level) {
+	lodLevel = std::clamp(level, 0, static_cast<int>(lods.size()) - 1);
+}
+
 void StaticGeometry::calculateAABB() {
-	if (vertices.empty()) return;
+	// Without CPU positions the bounds computed at import time stay in place
+	size_t positionCount = getPositionCount();
+	if (positionCount == 0) return;
 
-	aabbMin = aabbMax = vertices[0].Position;
+	aabbMin = aabbMax = getVertexPosition(0);
 
-	for (const auto& vertex : vertices) {
-		aabbMin = glm::min(aabbMin, vertex.Position);
-		aabbMax = glm::max(aabbMax, vertex.Position);
+	for (size_t i = 1; i < positionCount; ++i) {
+		aabbMin = glm::min(aabbMin, getVertexPosition(i));
+		aabbMax = glm::max(aabbMax, getVertexPosition(i));
 	}
-
-	// Optionally, apply the current model matrix to the AABB corners
-	glm::mat4 modelMatrix = getModelMatrix();
-	glm::vec4 minCorner = modelMatrix * glm::vec4(aabbMin, 1.0f);
-	glm::vec4 maxCorner = modelMatrix * glm::vec4(aabbMax, 1.0f);
-
-	aabbMin = glm::vec3(minCorner);
-	aabbMax = glm::vec3(maxCorner);
 }
 
-bool StaticGeometry::isInFrustum(const Frustum& frustum) const {
-	for (int i = 0; i < 6; ++i) {
-		const auto& plane = frustum.planes[i];
-
-		glm::vec3 pVertex = aabbMin;
-		if (plane.normal.x >= 0) pVertex.x = aabbMax.x;
-		if (plane.normal.y >= 0) pVertex.y = aabbMax.y;
-		if (plane.normal.z >= 0) pVertex.z = aabbMax.z;
-
-		if (glm::dot(plane.normal, pVertex) + plane.distance < 0) {
-			return false; // AABB is outside the frustum
-		}
-	}
-	return true; // AABB is inside the frustum
+bool StaticGeometry::isInFrustum(const Frustum& frustum, const glm::mat4& transform) const {
+	return frustum.intersects(getBounds().transformed(transform));
 }
 
 glm::mat4 StaticGeometry::getModelMatrix() const {
@@ -289,6 +502,7 @@ void StaticGeometry::updateModelMatrix() {
 
 void StaticGeometry::setShader(std::shared_ptr<Shader> newShader) {
 	shader = std::move(newShader); // Use std::move if you're transferring ownership
+	resolveUniforms();
 }
 
 std::shared_ptr<Shader> StaticGeometry::getShader() const {
@@ -0,0 +1,209 @@
+#include "VertexLayout.h"
+#include "geometry/MeshData.h"
+#include <GL/glew.h>
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+    bool texCoordFits(const glm::vec2& uv) {
+        return std::abs(uv.x) <= VertexLayout::maxPackedTexCoord && std::abs(uv.y) <= VertexLayout::maxPackedTexCoord;
+    }
+
+    uint32_t packNormal(const glm::vec3& normal, float w = 0.0f) {
+        return glm::packSnorm3x10_1x2(glm::vec4(normal, w));
+    }
+
+    PackedStaticVertex packVertex(const StaticVertex& vertex) {
+        PackedStaticVertex packed;
+        packed.Position = vertex.Position;
+        packed.Normal = packNormal(vertex.Normal);
+        packed.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+        packed.LightMapTexCoords = glm::packHalf2x16(vertex.LightMapTexCoords);
+        return packed;
+    }
+
+    PackedAnimatedVertex packVertex(const AnimatedVertex& vertex) {
+        PackedAnimatedVertex packed;
+        packed.Position = vertex.Position;
+        packed.Normal = packNormal(vertex.Normal);
+
+        // Only the handedness of the bitangent is kept, the shader rebuilds it as cross(N, T) * w
+        float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        packed.Tangent = packNormal(vertex.Tangent, handedness);
+        packed.TexCoords = glm::packHalf2x16(vertex.TexCoords);
+
+        // Unused slots (ID -1) keep a zero weight, so they contribute nothing just like in the float layout.
+        // The rounding error is folded into the strongest influence so the weights still sum to one.
+        int total = 0;
+        int strongest = 0;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
+            bool used = vertex.BoneIDs[i] >= 0;
+            packed.BoneIDs[i] = used ? static_cast<uint8_t>(vertex.BoneIDs[i]) : 0;
+            packed.Weights[i] = used ? static_cast<uint8_t>(std::lround(glm::clamp(vertex.Weights[i], 0.0f, 1.0f) * 255.0f)) : 0;
+            total += packed.Weights[i];
+            if (packed.Weights[i] > packed.Weights[strongest]) {
+                strongest = i;
+            }
+        }
+        if (total > 0) {
+            packed.Weights[strongest] = static_cast<uint8_t>(std::clamp(packed.Weights[strongest] + 255 - total, 0, 255));
+        }
+        return packed;
+    }
+
+    StaticVertex unpackVertex(const PackedStaticVertex& packed) {
+        StaticVertex vertex;
+        vertex.Position = packed.Position;
+        vertex.Normal = glm::vec3(glm::unpackSnorm3x10_1x2(packed.Normal));
+        vertex.TexCoords = glm::unpackHalf2x16(packed.TexCoords);
+        vertex.LightMapTexCoords = glm::unpackHalf2x16(packed.LightMapTexCoords);
+        return vertex;
+    }
+
+    AnimatedVertex unpackVertex(const PackedAnimatedVertex& packed) {
+        AnimatedVertex vertex;
+        vertex.Position = packed.Position;
+        vertex.Normal = glm::vec3(glm::unpackSnorm3x10_1x2(packed.Normal));
+        glm::vec4 tangent = glm::unpackSnorm3x10_1x2(packed.Tangent);
+        vertex.Tangent = glm::vec3(tangent);
+        vertex.Bitangent = glm::cross(vertex.Normal, vertex.Tangent) * tangent.w;
+        vertex.TexCoords = glm::unpackHalf2x16(packed.TexCoords);
+        for (int i = 0; i < MAX_BONE_INFLUENCE; ++i) {
+            vertex.BoneIDs[i] = packed.Weights[i] > 0 ? packed.BoneIDs[i] : -1;
+            vertex.Weights[i] = packed.Weights[i] / 255.0f;
+        }
+        return vertex;
+    }
+
+    template <typename Vertex, typename Packed>
+    void unpackBlob(const MeshData& meshData, std::vector<Vertex>& vertices) {
+        if (meshData.vertexFormat == VertexFormat::Float) {
+            const Vertex* source = static_cast<const Vertex*>(meshData.vertexData);
+            vertices.assign(source, source + meshData.vertexCount);
+            return;
+        }
+
+        const Packed* source = static_cast<const Packed*>(meshData.vertexData);
+        vertices.resize(meshData.vertexCount);
+        for (uint32_t i = 0; i < meshData.vertexCount; ++i) {
+            vertices[i] = unpackVertex(source[i]);
+        }
+    }
+}
+
+bool VertexLayout::pack(MeshData& meshData) {
+    if (meshData.vertexFormat == VertexFormat::Packed) {
+        return true;
+    }
+
+    if (meshData.animated) {
+        for (const AnimatedVertex& vertex : meshData.animatedVertices) {
+            if (!texCoordFits(vertex.TexCoords) || vertex.BoneIDs[0] > maxPackedBoneID || vertex.BoneIDs[1] > maxPackedBoneID ||
+                vertex.BoneIDs[2] > maxPackedBoneID || vertex.BoneIDs[3] > maxPackedBoneID) {
+                return false;
+            }
+        }
+
+        meshData.packedAnimatedVertices.resize(meshData.animatedVertices.size());
+        for (size_t i = 0; i < meshData.animatedVertices.size(); ++i) {
+            meshData.packedAnimatedVertices[i] = packVertex(meshData.animatedVertices[i]);
+        }
+        std::vector<AnimatedVertex>().swap(meshData.animatedVertices);
+    }
+    else {
+        for (const StaticVertex& vertex : meshData.staticVertices) {
+            if (!texCoordFits(vertex.TexCoords) || !texCoordFits(vertex.LightMapTexCoords)) {
+                return false;
+            }
+        }
+
+        meshData.packedStaticVertices.resize(meshData.staticVertices.size());
+        for (size_t i = 0; i < meshData.staticVertices.size(); ++i) {
+            meshData.packedStaticVertices[i] = packVertex(meshData.staticVertices[i]);
+        }
+        std::vector<StaticVertex>().swap(meshData.staticVertices);
+    }
+
+    meshData.vertexFormat = VertexFormat::Packed;
+    meshData.bindOwnedBuffers();
+    return true;
+}
+
+void VertexLayout::unpack(const MeshData& meshData, std::vector<StaticVertex>& vertices) {
+    unpackBlob<StaticVertex, PackedStaticVertex>(meshData, vertices);
+}
+
+void VertexLayout::unpack(const MeshData& meshData, std::vector<AnimatedVertex>& vertices) {
+    unpackBlob<AnimatedVertex, PackedAnimatedVertex>(meshData, vertices);
+}
+
+void VertexLayout::copyPositions(const MeshData& meshData, std::vector<glm::vec3>& positions) {
+    static_assert(offsetof(StaticVertex, Position) == 0 && offsetof(AnimatedVertex, Position) == 0 &&
+        offsetof(PackedStaticVertex, Position) == 0 && offsetof(PackedAnimatedVertex, Position) == 0,
+        "Every vertex layout starts with its position");
+
+    const unsigned char* source = static_cast<const unsigned char*>(meshData.vertexData);
+    const size_t stride = meshData.getVertexStride();
+    positions.resize(meshData.vertexCount);
+    for (uint32_t i = 0; i < meshData.vertexCount; ++i) {
+        std::memcpy(&positions[i], source + i * stride, sizeof(glm::vec3));
+    }
+}
+
+void VertexLayout::setupStaticAttributes(VertexFormat format) {
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3); // Lightmap UVs
+
+    if (format == VertexFormat::Packed) {
+        const GLsizei stride = sizeof(PackedStaticVertex);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedStaticVertex, Position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedStaticVertex, Normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedStaticVertex, TexCoords));
+        glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedStaticVertex, LightMapTexCoords));
+        return;
+    }
+
+    const GLsizei stride = sizeof(StaticVertex);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StaticVertex, Position));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StaticVertex, Normal));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StaticVertex, TexCoords));
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(StaticVertex, LightMapTexCoords));
+}
+
+void VertexLayout::setupAnimatedAttributes(VertexFormat format) {
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    glEnableVertexAttribArray(5);
+    glEnableVertexAttribArray(6);
+
+    if (format == VertexFormat::Packed) {
+        const GLsizei stride = sizeof(PackedAnimatedVertex);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedAnimatedVertex, Position));
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedAnimatedVertex, Normal));
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedAnimatedVertex, TexCoords));
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(PackedAnimatedVertex, Tangent));
+        glVertexAttribIPointer(5, 4, GL_UNSIGNED_BYTE, stride, (void*)offsetof(PackedAnimatedVertex, BoneIDs));
+        glVertexAttribPointer(6, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(PackedAnimatedVertex, Weights));
+
+        // No bitangent stream, drawn through the shader's PACKED_VERTICES variant which rebuilds it
+        glDisableVertexAttribArray(4);
+        return;
+    }
+
+    const GLsizei stride = sizeof(AnimatedVertex);
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AnimatedVertex, Position));
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AnimatedVertex, Normal));
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AnimatedVertex, TexCoords));
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AnimatedVertex, Tangent));
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AnimatedVertex, Bitangent));
+    glVertexAttribIPointer(5, 4, GL_INT, stride, (void*)offsetof(AnimatedVertex, BoneIDs));
+    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(AnimatedVertex, Weights));
+}
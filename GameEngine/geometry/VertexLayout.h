@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+#include "geometry/PackedVertex.h"
+#include "geometry/StaticVertex.h"
+#include "geometry/AnimatedVertex.h"
+
+struct MeshData;
+
+// Conversion between the float and packed vertex layouts, and the matching attribute setup.
+// Attribute locations are identical in both layouts, so the same shaders draw either one.
+class VertexLayout {
+public:
+    // Half floats keep ~1/1024 precision below 2.0. Meshes with UVs beyond this stay in float.
+    static constexpr float maxPackedTexCoord = 2.0f;
+    static constexpr int maxPackedBoneID = 255;
+
+    // Converts the owned float vertices of an imported mesh to the packed layout. Returns false and
+    // leaves the mesh in float when it cannot be represented without visible error.
+    static bool pack(MeshData& meshData);
+
+    // Expands the upload blob of a mesh to full precision for CPU-side users (bounds, collision)
+    static void unpack(const MeshData& meshData, std::vector<StaticVertex>& vertices);
+    static void unpack(const MeshData& meshData, std::vector<AnimatedVertex>& vertices);
+
+    // Positions only, without touching the other attributes
+    static void copyPositions(const MeshData& meshData, std::vector<glm::vec3>& positions);
+
+    // Sets up the attributes of the bound VAO over the bound GL_ARRAY_BUFFER
+    static void setupStaticAttributes(VertexFormat format);
+    static void setupAnimatedAttributes(VertexFormat format);
+};
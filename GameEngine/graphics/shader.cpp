@@ -1,6 +1,33 @@
 #include "Shader.h"
+#include <algorithm>
 
-Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
+namespace {
+    // Defines go right after the #version line, which has to stay first
+    std::string injectDefines(const std::string& code, const std::vector<std::string>& defines) {
+        if (defines.empty()) {
+            return code;
+        }
+
+        std::string block;
+        for (const std::string& define : defines) {
+            block += "#define " + define + "\n";
+        }
+
+        size_t insertAt = 0;
+        size_t version = code.find("#version");
+        if (version != std::string::npos) {
+            size_t lineEnd = code.find('\n', version);
+            if (lineEnd == std::string::npos) {
+                return code + "\n" + block;
+            }
+            insertAt = lineEnd + 1;
+        }
+        return code.substr(0, insertAt) + block + code.substr(insertAt);
+    }
+}
+
+Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath) {
     // 1. Retrieve the vertex/fragment source code from filePath
     std::string vertexCode;
     std::string fragmentCode;
@@ -26,8 +53,8 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
         fShaderFile.close();
 
         // Convert stream into string
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
+        vertexCode = injectDefines(vShaderStream.str(), defines);
+        fragmentCode = injectDefines(fShaderStream.str(), defines);
     }
     catch (std::ifstream::failure e) {
         std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
@@ -80,12 +107,47 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath) {
         glDeleteProgram(this->Program); // Delete the invalid program object
         this->Program = 0; // Set the Program member to 0
     }
+    else {
+        reflect();
+    }
 
     // Delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 }
 
+std::unique_ptr<Shader> Shader::createCompute(const std::string& computePath, const std::vector<std::string>& defines) {
+    std::ifstream file(computePath);
+    if (!file) {
+        std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << computePath << std::endl;
+        return nullptr;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    const std::string code = injectDefines(stream.str(), defines);
+    const char* source = code.c_str();
+
+    GLuint compute = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(compute, 1, &source, NULL);
+    glCompileShader(compute);
+
+    std::unique_ptr<Shader> shader(new Shader());
+    shader->checkCompileErrors(compute, "COMPUTE");
+    shader->Program = glCreateProgram();
+    glAttachShader(shader->Program, compute);
+    glLinkProgram(shader->Program);
+    glDeleteShader(compute);
+
+    GLint success;
+    glGetProgramiv(shader->Program, GL_LINK_STATUS, &success);
+    if (!success) {
+        shader->checkCompileErrors(shader->Program, "PROGRAM");
+        return nullptr;
+    }
+    shader->reflect();
+    return shader;
+}
+
 Shader::~Shader() {
     if (Program != 0) {
         glDeleteProgram(Program);
@@ -111,57 +173,226 @@ void Shader::checkCompileErrors(GLuint shader, std::string type) {
     }
 }
 
+std::shared_ptr<Shader> Shader::getInstancedVariant() const {
+    if (!instancedVariantBuilt) {
+        instancedVariantBuilt = true;
+        std::shared_ptr<Shader> variant;
+        if (GLEW_ARB_bindless_texture) {
+            variant = std::make_shared<Shader>(vertexPath, fragmentPath, std::vector<std::string>{ "INSTANCED", "BINDLESS" });
+        }
+        if (!variant || !variant->Program) {
+            variant = std::make_shared<Shader>(vertexPath, fragmentPath, std::vector<std::string>{ "INSTANCED" });
+        }
+
+        // Shaders without an instanced path compile fine but never declare the object block
+        if (variant->Program && variant->findUniformBlock("ObjectBuffer")) {
+            instancedVariant = std::move(variant);
+        }
+    }
+    return instancedVariant;
+}
+
+std::shared_ptr<Shader> Shader::getPackedVertexVariant() const {
+    if (!packedVertexVariant) {
+        packedVertexVariant = std::make_shared<Shader>(vertexPath, fragmentPath, std::vector<std::string>{ "PACKED_VERTICES" });
+    }
+    return packedVertexVariant;
+}
+
 void Shader::use() const {
     if (this->Program) {
         glUseProgram(this->Program);
     }
 }
 
+void Shader::reflect() {
+    uniforms.clear();
+    blocks.clear();
+
+    GLint uniformCount = 0;
+    glGetProgramInterfaceiv(Program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniformCount);
+
+    const GLenum properties[] = { GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE };
+    std::vector<char> name;
+    for (GLint i = 0; i < uniformCount; ++i) {
+        GLint values[4] = {};
+        glGetProgramResourceiv(Program, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+        if (values[2] < 0) {
+            continue; // Member of a uniform block, set through the buffer instead
+        }
+
+        name.resize(static_cast<size_t>(values[0]) + 1);
+        glGetProgramResourceName(Program, GL_UNIFORM, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+        std::string_view uniformName(name.data());
+        const GLenum type = static_cast<GLenum>(values[1]);
+        const GLint arraySize = values[3];
+
+        // Arrays are reported as "name[0]". Register the bare name and every element, so both the
+        // whole array and single elements resolve without asking the driver later.
+        if (arraySize > 1 || (uniformName.size() > 3 && uniformName.substr(uniformName.size() - 3) == "[0]")) {
+            std::string baseName(uniformName.substr(0, uniformName.find('[')));
+            uniforms.push_back(UniformInfo{ hashName(baseName), values[2], type, arraySize });
+            for (GLint element = 0; element < arraySize; ++element) {
+                std::string elementName = baseName + "[" + std::to_string(element) + "]";
+                GLint location = element == 0 ? values[2] : glGetUniformLocation(Program, elementName.c_str());
+                uniforms.push_back(UniformInfo{ hashName(elementName), location, type, arraySize - element });
+            }
+        }
+        else {
+            uniforms.push_back(UniformInfo{ hashName(uniformName), values[2], type, 1 });
+        }
+    }
+    std::sort(uniforms.begin(), uniforms.end(), [](const UniformInfo& a, const UniformInfo& b) { return a.hash < b.hash; });
+
+    for (GLenum blockInterface : { GLenum(GL_UNIFORM_BLOCK), GLenum(GL_SHADER_STORAGE_BLOCK) }) {
+        GLint blockCount = 0;
+        glGetProgramInterfaceiv(Program, blockInterface, GL_ACTIVE_RESOURCES, &blockCount);
+
+        const GLenum blockProperties[] = { GL_NAME_LENGTH, GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+        for (GLint i = 0; i < blockCount; ++i) {
+            GLint values[3] = {};
+            glGetProgramResourceiv(Program, blockInterface, i, 3, blockProperties, 3, nullptr, values);
+            name.resize(static_cast<size_t>(values[0]) + 1);
+            glGetProgramResourceName(Program, blockInterface, i, static_cast<GLsizei>(name.size()), nullptr, name.data());
+
+            UniformBlockInfo block;
+            block.hash = hashName(name.data());
+            block.interface = blockInterface;
+            block.index = static_cast<GLuint>(i);
+            block.binding = values[1];
+            block.dataSize = values[2];
+            blocks.push_back(block);
+        }
+    }
+}
+
+const Shader::UniformInfo* Shader::findUniform(uint64_t hash) const {
+    auto it = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+        [](const UniformInfo& info, uint64_t value) { return info.hash < value; });
+    return it != uniforms.end() && it->hash == hash ? &*it : nullptr;
+}
+
+GLint Shader::locationOf(std::string_view name) const {
+    const UniformInfo* info = findUniform(hashName(name));
+    return info ? info->location : -1;
+}
+
+bool Shader::typeMatches(GLenum expected, GLenum actual) {
+    if (expected == actual) {
+        return true;
+    }
+    if (expected != GL_INT) {
+        return false;
+    }
+
+    // Samplers and booleans are set through glUniform1i
+    switch (actual) {
+    case GL_BOOL:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+    case GL_SAMPLER_2D_SHADOW:
+    case GL_SAMPLER_3D:
+        return true;
+    default:
+        return false;
+    }
+}
+
+const UniformBlockInfo* Shader::findUniformBlock(std::string_view name) const {
+    const uint64_t hash = hashName(name);
+    for (const UniformBlockInfo& block : blocks) {
+        if (block.hash == hash) {
+            return &block;
+        }
+    }
+    return nullptr;
+}
+
+void Shader::set(Uniform<int> uniform, int value) const {
+    glUniform1i(uniform.location, value);
+}
+
+void Shader::set(Uniform<float> uniform, float value) const {
+    glUniform1f(uniform.location, value);
+}
+
+void Shader::set(Uniform<glm::vec2> uniform, const glm::vec2& value) const {
+    glUniform2fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::vec3> uniform, const glm::vec3& value) const {
+    glUniform3fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::vec4> uniform, const glm::vec4& value) const {
+    glUniform4fv(uniform.location, 1, &value[0]);
+}
+
+void Shader::set(Uniform<glm::mat3> uniform, const glm::mat3& value) const {
+    glUniformMatrix3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::set(Uniform<glm::mat4> uniform, const glm::mat4& value) const {
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::set(Uniform<glm::mat4x3> uniform, const glm::mat4x3& value) const {
+    glUniformMatrix4x3fv(uniform.location, 1, GL_FALSE, glm::value_ptr(value));
+}
+
+void Shader::setArray(Uniform<glm::mat4x3> uniform, const glm::mat4x3* values, GLsizei count) const {
+    count = std::min(count, uniform.arraySize);
+    if (uniform.isValid() && count > 0) {
+        glUniformMatrix4x3fv(uniform.location, count, GL_FALSE, glm::value_ptr(values[0]));
+    }
+}
+
 void Shader::setMat4x3(const std::string& name, const glm::mat4x3& mat) const {
     if (this->Program) {
-        glUniformMatrix4x3fv(glGetUniformLocation(this->Program, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+        glUniformMatrix4x3fv(locationOf(name), 1, GL_FALSE, glm::value_ptr(mat));
     }
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
     if (this->Program) {
-        glUniformMatrix4fv(glGetUniformLocation(this->Program, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+        glUniformMatrix4fv(locationOf(name), 1, GL_FALSE, glm::value_ptr(mat));
     }
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const {
     if (this->Program) {
-        glUniformMatrix3fv(glGetUniformLocation(this->Program, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+        glUniformMatrix3fv(locationOf(name), 1, GL_FALSE, glm::value_ptr(mat));
     }
 }
 
 void Shader::setInt(const std::string& name, int value) const {
     if (this->Program) {
-        glUniform1i(glGetUniformLocation(this->Program, name.c_str()), value);
+        glUniform1i(locationOf(name), value);
     }
 }
 
 void Shader::setFloat(const std::string& name, float value) const {
     if (this->Program) {
-        glUniform1f(glGetUniformLocation(this->Program, name.c_str()), value);
+        glUniform1f(locationOf(name), value);
     }
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
     if (this->Program) {
-        glUniform2fv(glGetUniformLocation(this->Program, name.c_str()), 1, &value[0]);
+        glUniform2fv(locationOf(name), 1, &value[0]);
     }
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
     if (this->Program) {
-        glUniform3fv(glGetUniformLocation(this->Program, name.c_str()), 1, &value[0]);
+        glUniform3fv(locationOf(name), 1, &value[0]);
     }
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const {
     if (this->Program) {
-        glUniform4fv(glGetUniformLocation(Program, name.c_str()), 1, &value[0]);
+        glUniform4fv(locationOf(name), 1, &value[0]);
     }
 }
 
@@ -178,9 +409,5 @@ bool Shader::isProgramLinkedSuccessfully() const {
 }
 
 bool Shader::hasUniform(const std::string& name) const {
-    if (this->Program) {
-        GLint location = glGetUniformLocation(this->Program, name.c_str());
-        return location != -1;
-    }
-    return false;
+    return this->Program && locationOf(name) != -1;
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #include "FileSystemUtils.h"
 #include <string>
 #include <algorithm>
+#include <cctype>
+#include <filesystem>
 #include <iostream>
 #include "Debug.h"
 
@@ -63,4 +65,16 @@ std::string FileSystemUtils::getMaterialFilePath(const std::string& materialFile
     std::string materialPath = exePath + "/media/materials/" + materialFileName;
     DEBUG_COUT << "Constructed Material File Path: " << materialPath << std::endl;
     return materialPath;
-}
\ No newline at end of file
+}
+
+std::string FileSystemUtils::normalizeAssetPath(const std::string& path) {
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(path, error);
+    std::string normalized = (error ? std::filesystem::path(path) : absolute).lexically_normal().generic_string();
+#if defined(_WIN32) || defined(_WIN64)
+    // Windows paths are case-insensitive
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+    return normalized;
+}
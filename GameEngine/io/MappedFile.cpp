@@ -0,0 +1,89 @@
+#include "MappedFile.h"
+#include <iostream>
+
+#if defined(_WIN32) || defined(_WIN64)
+// Windows specific includes
+#define NOMINMAX
+#include <windows.h>
+#else
+// POSIX specific includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED) {
+        close(fd);
+        return;
+    }
+
+    fileDescriptor = fd;
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<size_t>(fileStat.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(_WIN32) || defined(_WIN64)
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+#else
+    if (data) {
+        munmap(const_cast<unsigned char*>(data), size);
+    }
+    if (fileDescriptor >= 0) {
+        close(fileDescriptor);
+    }
+#endif
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The view stays valid for the lifetime of the object.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return data != nullptr; }
+    const unsigned char* getData() const { return data; }
+    size_t getSize() const { return size; }
+
+private:
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+#if defined(_WIN32) || defined(_WIN64)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+};
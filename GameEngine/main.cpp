@@ -1,6 +1,15 @@
 #include "GameEngine.h"
+#include "rendering/DynamicBVHBenchmark.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--bvh-benchmark") == 0) {
+        runDynamicBVHBenchmark(10000, std::cout);
+        runDynamicBVHBenchmark(100000, std::cout);
+        return 0;
+    }
 
-int main() {
     GameEngine gameEngine;
 
     gameEngine.initialize();
@@ -1,10 +1,15 @@
 #include "Node.h"
+#include "node/SceneIndex.h"
 
 Node::Node(const std::string& name)
     : m_Name(name), m_Parent(nullptr), m_Position(0.0f), m_Rotation(1.0f, 0.0f, 0.0f, 0.0f), m_Scale(1.0f),
     m_Transform(1.0f), m_IsVisible(true), m_IsDirty(true) {}
 
-Node::~Node() {}
+Node::~Node() {
+    if (m_SceneIndex) {
+        m_SceneIndex->remove(*this);
+    }
+}
 
 // Hierarchy
 Node* Node::getParent() const {
@@ -21,6 +26,7 @@ const std::vector<std::unique_ptr<Node>>& Node::getChildren() const {
 
 void Node::addChild(std::unique_ptr<Node> child) {
     child->setParent(this);
+    child->markDirty();
     m_Children.push_back(std::move(child));
 }
 
@@ -42,6 +48,7 @@ const glm::vec3& Node::getPosition() const {
 void Node::setPosition(const glm::vec3& position) {
     m_Position = position;
     m_IsDirty = true;
+    markDirty();
 }
 
 const glm::quat& Node::getRotation() const {
@@ -51,6 +58,7 @@ const glm::quat& Node::getRotation() const {
 void Node::setRotation(const glm::quat& rotation) {
     m_Rotation = rotation;
     m_IsDirty = true;
+    markDirty();
 }
 
 const glm::vec3& Node::getScale() const {
@@ -60,6 +68,7 @@ const glm::vec3& Node::getScale() const {
 void Node::setScale(const glm::vec3& scale) {
     m_Scale = scale;
     m_IsDirty = true;
+    markDirty();
 }
 
 const glm::mat4& Node::getTransform() const {
@@ -73,6 +82,7 @@ const glm::mat4& Node::getTransform() const {
 void Node::setTransform(const glm::mat4& transform) {
     m_Transform = transform;
     m_IsDirty = false;
+    markDirty();
 }
 
 // Animation
@@ -101,7 +111,10 @@ bool Node::isVisible() const {
 }
 
 void Node::setVisible(bool visible) {
-    m_IsVisible = visible;
+    if (m_IsVisible != visible) {
+        m_IsVisible = visible;
+        markDirty();
+    }
 }
 
 // Update and Render
@@ -127,6 +140,42 @@ void Node::render(const glm::mat4& parentTransform) {
     }
 }
 
+void Node::collectDraws(RenderQueue& /*queue*/) {}
+
+// Bounds
+BoundingBox Node::getLocalBounds() const {
+    return BoundingBox();
+}
+
+const OccluderMesh* Node::getOccluder() const {
+    return nullptr;
+}
+
+void Node::markDirty() {
+    m_WorldDirty = true;
+    for (Node* parent = m_Parent; parent && !parent->m_ChildDirty; parent = parent->m_Parent) {
+        parent->m_ChildDirty = true;
+    }
+}
+
+void Node::updateSpatial(const glm::mat4& parentWorld, bool parentChanged, bool parentVisible, SceneIndex& index) {
+    const bool changed = parentChanged || m_WorldDirty;
+    const bool visible = parentVisible && m_IsVisible;
+    if (changed) {
+        m_WorldTransform = parentWorld * getTransform();
+        m_WorldBounds = visible ? getLocalBounds().transformed(m_WorldTransform) : BoundingBox();
+        index.update(*this, m_WorldBounds);
+        m_WorldDirty = false;
+    }
+
+    if (changed || m_ChildDirty) {
+        m_ChildDirty = false;
+        for (const auto& child : m_Children) {
+            child->updateSpatial(m_WorldTransform, changed, visible, index);
+        }
+    }
+}
+
 // Misc
 const std::string& Node::getName() const {
     return m_Name;
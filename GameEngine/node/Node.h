@@ -6,6 +6,11 @@
 #include <memory>
 #include <animations/Animation.h>
 #include <animations/Animator.h>
+#include "rendering/BoundingBox.h"
+
+class RenderQueue;
+class SceneIndex;
+struct OccluderMesh;
 
 class Node {
 public:
@@ -42,6 +47,19 @@ public:
     virtual void update(float deltaTime);
     virtual void render(const glm::mat4& parentTransform);
 
+    // Adds the node's own draws to the queue instead of drawing them immediately. Called for the nodes
+    // the scene index finds visible, placed by the world transform of its last update.
+    virtual void collectDraws(RenderQueue& queue);
+
+    // Bounds
+    // Model-space bounds of what the node itself draws, empty for nodes that draw nothing
+    virtual BoundingBox getLocalBounds() const;
+    // Model-space mesh that hides what is behind the node from the occlusion culler, null by default
+    virtual const OccluderMesh* getOccluder() const;
+    // World transform and bounds as of the last SceneIndex::synchronize
+    const glm::mat4& getWorldTransform() const { return m_WorldTransform; }
+    const BoundingBox& getWorldBounds() const { return m_WorldBounds; }
+
     // Misc
     const std::string& getName() const;
     void setName(const std::string& name);
@@ -58,4 +76,20 @@ protected:
     mutable bool m_IsDirty;
     std::shared_ptr<Animation> m_Animation;
     std::shared_ptr<Animator> m_Animator;
+
+    // Flags the world transform for the next index update, and the path to it for the traversal
+    void markDirty();
+
+private:
+    friend class SceneIndex;
+
+    // Refits the nodes whose world transform or visibility changed, skipping clean subtrees
+    void updateSpatial(const glm::mat4& parentWorld, bool parentChanged, bool parentVisible, SceneIndex& index);
+
+    glm::mat4 m_WorldTransform = glm::mat4(1.0f);
+    BoundingBox m_WorldBounds;
+    SceneIndex* m_SceneIndex = nullptr;
+    int m_SpatialProxy = -1;
+    bool m_WorldDirty = true;  // Transform, visibility or parent changed
+    bool m_ChildDirty = true;  // Some descendant is dirty
 };
\ No newline at end of file
@@ -1,12 +1,16 @@
 #include "RenderableNode.h"
+#include "rendering/GpuCuller.h"
 
-RenderableNode::RenderableNode(const std::string& name, std::unique_ptr<StaticGeometry> geometry)
-    : Node(name), m_StaticGeometry(std::move(geometry)), m_AnimatedGeometry(nullptr) {}
+RenderableNode::RenderableNode(const std::string& name, std::shared_ptr<StaticGeometry> geometry)
+    : Node(name), m_StaticGeometry(std::move(geometry)), m_AnimatedGeometry(nullptr),
+    m_VisibilitySlot(GpuCuller::allocateVisibilitySlot()) {}
 
 RenderableNode::RenderableNode(const std::string& name, std::unique_ptr<AnimatedGeometry> geometry)
     : Node(name), m_StaticGeometry(nullptr), m_AnimatedGeometry(std::move(geometry)) {}
 
-RenderableNode::~RenderableNode() {}
+RenderableNode::~RenderableNode() {
+    GpuCuller::releaseVisibilitySlot(m_VisibilitySlot);
+}
 
 void RenderableNode::render(const glm::mat4& parentTransform) {
     if (!isVisible()) {
@@ -27,6 +31,73 @@ void RenderableNode::render(const glm::mat4& parentTransform) {
     }
 }
 
+void RenderableNode::collectDraws(RenderQueue& queue) {
+    const glm::mat4& worldTransform = getWorldTransform();
+    selectLOD(queue.getViewPosition(), worldTransform);
+
+    if (m_StaticGeometry) {
+        updateObjectData(worldTransform);
+        queue.add(*m_StaticGeometry, m_ObjectData);
+    }
+    else if (m_AnimatedGeometry) {
+        queue.add(*m_AnimatedGeometry, worldTransform, m_Animator.get());
+    }
+}
+
+BoundingBox RenderableNode::getLocalBounds() const {
+    if (m_StaticGeometry) {
+        return m_StaticGeometry->getBounds();
+    }
+    if (m_AnimatedGeometry) {
+        return m_AnimatedGeometry->getBounds();
+    }
+    return BoundingBox();
+}
+
+const OccluderMesh* RenderableNode::getOccluder() const {
+    if (!m_StaticGeometry) {
+        return nullptr;
+    }
+    // Blended surfaces let what is behind them show through
+    const std::shared_ptr<Material>& material = m_StaticGeometry->getMaterial();
+    if (material && material->getTechniqueDetails().blending.enabled) {
+        return nullptr;
+    }
+    return m_StaticGeometry->getOccluder();
+}
+
+void RenderableNode::updateObjectData(const glm::mat4& nodeTransform) {
+    if (!m_ObjectDataValid) {
+        m_ObjectData = ObjectData(nodeTransform);
+        m_ObjectData.visibilitySlot = m_VisibilitySlot;
+        m_ObjectDataValid = true;
+        return;
+    }
+
+    m_ObjectData.previousModel = m_ObjectData.model;
+    if (nodeTransform != m_ObjectData.model) {
+        m_ObjectData.model = nodeTransform;
+        m_ObjectData.normalMatrix = ObjectData::packNormalMatrix(nodeTransform);
+    }
+}
+
+void RenderableNode::selectLOD(const glm::vec3& viewPosition, const glm::mat4& nodeTransform) {
+    if (!m_LODManager) {
+        return;
+    }
+
+    if (m_StaticGeometry && m_StaticGeometry->getLODCount() > 1) {
+        m_StaticGeometry->setLODLevel(m_LODManager->getLODLevel(viewPosition, *m_StaticGeometry, nodeTransform));
+    }
+    else if (m_AnimatedGeometry && m_AnimatedGeometry->getLODCount() > 1) {
+        m_AnimatedGeometry->setLODLevel(m_LODManager->getLODLevel(viewPosition, *m_AnimatedGeometry, nodeTransform));
+    }
+}
+
 void RenderableNode::setAnimator(std::shared_ptr<Animator> animator) {
     m_Animator = animator;
+}
+
+void RenderableNode::setLODManager(std::shared_ptr<LODManager> lodManager) {
+    m_LODManager = std::move(lodManager);
 }
\ No newline at end of file
@@ -3,17 +3,40 @@
 #include "Node.h"
 #include "StaticGeometry.h"
 #include "geometry/AnimatedGeometry.h"
+#include "rendering/LODManager.h"
+#include "rendering/RenderQueue.h"
 
 class RenderableNode : public Node {
 public:
-    RenderableNode(const std::string& name, std::unique_ptr<StaticGeometry> geometry);
+    // Static geometry may be shared by several nodes, the render queue then draws it instanced
+    RenderableNode(const std::string& name, std::shared_ptr<StaticGeometry> geometry);
     RenderableNode(const std::string& name, std::unique_ptr<AnimatedGeometry> geometry);
     virtual ~RenderableNode();
 
     virtual void render(const glm::mat4& parentTransform) override;
+    virtual void collectDraws(RenderQueue& queue) override;
+    // Bind pose bounds for animated geometry
+    virtual BoundingBox getLocalBounds() const override;
+    // The occluder of opaque static geometry
+    virtual const OccluderMesh* getOccluder() const override;
     void setAnimator(std::shared_ptr<Animator> animator);
 
+    // Picks the level of detail drawn each frame from the view position of the render queue.
+    // Without one the full mesh is drawn.
+    void setLODManager(std::shared_ptr<LODManager> lodManager);
+
+    const std::shared_ptr<StaticGeometry>& getStaticGeometry() const { return m_StaticGeometry; }
+
 private:
-    std::unique_ptr<StaticGeometry> m_StaticGeometry;
+    void selectLOD(const glm::vec3& viewPosition, const glm::mat4& nodeTransform);
+    void updateObjectData(const glm::mat4& nodeTransform);
+
+    std::shared_ptr<LODManager> m_LODManager;
+    std::shared_ptr<StaticGeometry> m_StaticGeometry;
     std::unique_ptr<AnimatedGeometry> m_AnimatedGeometry;
+
+    // Object data of the last collected frame, its normal matrix only recomputed when the world transform changes
+    ObjectData m_ObjectData;
+    bool m_ObjectDataValid = false;
+    uint32_t m_VisibilitySlot = 0; // Static geometry only, see GpuCuller
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "SceneIndex.h"
+#include "node/Node.h"
+
+SceneIndex::~SceneIndex() {
+    clear();
+}
+
+void SceneIndex::synchronize(Node* root) {
+    updated = 0;
+    if (root != this->root) {
+        clear();
+        this->root = root;
+        if (root) {
+            root->markDirty();
+        }
+    }
+    if (root) {
+        root->updateSpatial(glm::mat4(1.0f), false, true, *this);
+    }
+}
+
+void SceneIndex::clear() {
+    tree.forEachProxy([](void* userData) {
+        Node* node = static_cast<Node*>(userData);
+        node->m_SceneIndex = nullptr;
+        node->m_SpatialProxy = DynamicBVH::nullNode;
+    });
+    tree.clear();
+    root = nullptr;
+}
+
+void SceneIndex::update(Node& node, const BoundingBox& bounds) {
+    ++updated;
+    if (bounds.isEmpty()) {
+        remove(node);
+        return;
+    }
+
+    if (node.m_SpatialProxy == DynamicBVH::nullNode) {
+        node.m_SpatialProxy = tree.createProxy(bounds, &node);
+        node.m_SceneIndex = this;
+    }
+    else {
+        tree.moveProxy(node.m_SpatialProxy, bounds);
+    }
+}
+
+void SceneIndex::remove(Node& node) {
+    if (node.m_SpatialProxy == DynamicBVH::nullNode) {
+        return;
+    }
+    tree.destroyProxy(node.m_SpatialProxy);
+    node.m_SpatialProxy = DynamicBVH::nullNode;
+    node.m_SceneIndex = nullptr;
+}
+
+std::vector<Node*> SceneIndex::queryBox(const BoundingBox& box) const {
+    std::vector<Node*> nodes;
+    tree.queryBox(box, [&](void* userData) {
+        nodes.push_back(static_cast<Node*>(userData));
+        return true;
+    });
+    return nodes;
+}
+
+std::vector<Node*> SceneIndex::querySphere(const glm::vec3& center, float radius) const {
+    std::vector<Node*> nodes;
+    tree.querySphere(center, radius, [&](void* userData) {
+        nodes.push_back(static_cast<Node*>(userData));
+        return true;
+    });
+    return nodes;
+}
+
+std::vector<Node*> SceneIndex::queryNearest(const glm::vec3& point, size_t k) const {
+    std::vector<BVHNearest> nearest;
+    tree.queryNearest(point, k, nearest);
+
+    std::vector<Node*> nodes;
+    nodes.reserve(nearest.size());
+    for (const BVHNearest& result : nearest) {
+        nodes.push_back(static_cast<Node*>(result.userData));
+    }
+    return nodes;
+}
+
+SceneRayHit SceneIndex::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+    SceneRayHit hit;
+    hit.distance = maxDistance;
+    tree.raycast(origin, direction, maxDistance, [&](void* userData, float entry) {
+        if (entry < hit.distance || !hit.node) {
+            hit.node = static_cast<Node*>(userData);
+            hit.distance = entry;
+        }
+        return hit.distance;
+    });
+    return hit;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "rendering/BoundingBox.h"
+#include "rendering/DynamicBVH.h"
+#include "rendering/FrustumCuller.h"
+
+class Node;
+
+struct SceneRayHit {
+    Node* node = nullptr;
+    float distance = 0.0f; // Where the ray enters the node's world bounds
+};
+
+// World-space spatial index over the drawable nodes of a scene graph, which is an authoring
+// hierarchy and says nothing about where things are. Backs the renderer's visibility pass and
+// gameplay queries alike. Synchronizing only visits the paths to nodes whose transform, visibility
+// or parent changed, and the tree only reinserts those that left their fat box.
+class SceneIndex {
+public:
+    SceneIndex() = default;
+    ~SceneIndex();
+
+    // Brings the index up to date with the graph under root. A different root rebuilds it.
+    void synchronize(Node* root);
+    void clear();
+
+    // Visits the nodes whose bounds intersect the frustum set on the culler
+    template <typename Callback>
+    void queryFrustum(FrustumCuller& culler, Callback&& callback) {
+        tree.queryFrustum(culler, [&](void* userData) { callback(*static_cast<Node*>(userData)); });
+    }
+
+    std::vector<Node*> queryBox(const BoundingBox& box) const;
+    std::vector<Node*> querySphere(const glm::vec3& center, float radius) const;
+    // The k nodes with the nearest bounds, nearest first
+    std::vector<Node*> queryNearest(const glm::vec3& point, size_t k) const;
+    // First node whose bounds the ray enters, node is nullptr on a miss
+    SceneRayHit raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const;
+
+    size_t size() const { return tree.size(); }
+    size_t getUpdatedCount() const { return updated; } // Nodes refit by the last synchronize
+    DynamicBVHStats getStats() const { return tree.getStats(); }
+
+private:
+    friend class Node;
+
+    void update(Node& node, const BoundingBox& bounds);
+    void remove(Node& node);
+
+    DynamicBVH tree;
+    Node* root = nullptr;
+    size_t updated = 0;
+};
@@ -9,7 +9,7 @@ FrameBufferManager::~FrameBufferManager() {
     for (const auto& frameBuffer : frameBuffers) {
         glDeleteFramebuffers(1, &frameBuffer.frameBufferId);
         glDeleteTextures(1, &frameBuffer.textureId);
-        glDeleteRenderbuffers(1, &frameBuffer.renderBufferId);
+        glDeleteTextures(1, &frameBuffer.depthTextureId);
     }
 }
 
@@ -34,12 +34,17 @@ void FrameBufferManager::createFrameBuffer(int width, int height) {
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameBuffer.textureId, 0);
 
-    // Generate and attach the renderbuffer for depth
-    glGenRenderbuffers(1, &frameBuffer.renderBufferId);
-    glBindRenderbuffer(GL_RENDERBUFFER, frameBuffer.renderBufferId);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, screenWidth, screenHeight);
-    glBindRenderbuffer(GL_RENDERBUFFER, 0);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, frameBuffer.renderBufferId);
+    // Generate and attach a depth texture, a renderbuffer could not be sampled
+    glGenTextures(1, &frameBuffer.depthTextureId);
+    glBindTexture(GL_TEXTURE_2D, frameBuffer.depthTextureId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, screenWidth, screenHeight, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, frameBuffer.depthTextureId, 0);
 
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cerr << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
@@ -182,4 +187,8 @@ GLuint FrameBufferManager::getSceneTexture() {
         return frameBuffers[0].textureId; // Return the texture ID of the first framebuffer
     }
     return 0; // Return an invalid ID if there are no framebuffers
+}
+
+GLuint FrameBufferManager::getDepthTexture(unsigned int index) const {
+    return index < frameBuffers.size() ? frameBuffers[index].depthTextureId : 0;
 }
\ No newline at end of file
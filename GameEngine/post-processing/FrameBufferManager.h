@@ -21,12 +21,14 @@ public:
     void applyPostProcessingEffects(GLuint inputTexture);
     void setActiveEffects(const std::vector<std::string>& effectNames);
     GLuint getSceneTexture();
+    // Depth attachment of a framebuffer, sampled by the GPU culling to build its Hi-Z pyramid
+    GLuint getDepthTexture(unsigned int index) const;
 
 private:
     struct FrameBuffer {
         GLuint frameBufferId;
         GLuint textureId;
-        GLuint renderBufferId;
+        GLuint depthTextureId;
     };
 
     std::vector<FrameBuffer> frameBuffers;
@@ -0,0 +1,44 @@
+#include "BindlessTextures.h"
+#include <algorithm>
+#include <map>
+
+int BindlessTextures::slotOf(const std::string& type) {
+    // Must match the textures[N] uniforms of Material::textureUniformMap and the BINDLESS shaders
+    static const std::map<std::string, int> slots = {
+        {"diffuse", 0},
+        {"emissive", 1},
+        {"detail1", 2},
+        {"detail2", 3},
+        {"normal", 4},
+        {"environment", 5}
+    };
+    auto it = slots.find(type);
+    return it != slots.end() ? it->second : -1;
+}
+
+void BindlessTextures::fillTextureSet(const std::vector<Texture>& textures, uint64_t* handles) {
+    std::fill(handles, handles + slotsPerSet, uint64_t(0));
+    for (const Texture& texture : textures) {
+        int slot = slotOf(texture.type);
+        if (slot >= 0) {
+            handles[slot] = getHandle(texture);
+        }
+    }
+}
+
+uint64_t BindlessTextures::getHandle(const Texture& texture) {
+    // Only textures owned by a resource can keep their handle resident for their whole lifetime
+    if (!texture.resource || texture.resource->id == 0) {
+        return 0;
+    }
+
+    TextureResource& resource = *texture.resource;
+    if (resource.bindlessHandle == 0) {
+        // Immutable storage makes the texture complete before its pixels arrive
+        resource.bindlessHandle = glGetTextureHandleARB(resource.id);
+        if (resource.bindlessHandle != 0) {
+            glMakeTextureHandleResidentARB(resource.bindlessHandle);
+        }
+    }
+    return resource.bindlessHandle;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Texture.h"
+
+// Resident ARB_bindless_texture handles for material textures. Every texture type has a fixed
+// slot, the textures[N] index Material::textureUniformMap gives it, with the environment cubemap
+// last, so one texture set is slotsPerSet handles.
+// Batched draws stream the sets they use to materialTexturesBindingPoint and the set of each
+// draw to drawTextureSetsBindingPoint; shaders built with BINDLESS sample through those instead
+// of bound texture units, so draws with different textures can share one call.
+class BindlessTextures {
+public:
+    static constexpr int slotsPerSet = 6;
+    static constexpr GLuint drawTextureSetsBindingPoint = 3;
+    static constexpr GLuint materialTexturesBindingPoint = 4;
+
+    static bool isSupported() { return GLEW_ARB_bindless_texture != 0; }
+
+    // Slot of a texture type, or -1 when the type has none
+    static int slotOf(const std::string& type);
+
+    // Writes slotsPerSet handles, zero where the set has no texture of that type
+    static void fillTextureSet(const std::vector<Texture>& textures, uint64_t* handles);
+
+private:
+    static uint64_t getHandle(const Texture& texture);
+};
@@ -0,0 +1,49 @@
+#include "BonePalette.h"
+#include <algorithm>
+
+BonePalette& BonePalette::instance() {
+    static BonePalette instance;
+    return instance;
+}
+
+BonePalette::BonePalette()
+    : ring(GL_SHADER_STORAGE_BUFFER, 256 * 1024, "bone palette") {}
+
+void BonePalette::beginFrame() {
+    if (ring.getBuffer() == 0) {
+        GLint offsetAlignment = 256;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        alignment = static_cast<size_t>(std::max(offsetAlignment, 16));
+    }
+
+    ring.beginFrame();
+    lastFrame = current;
+    current = BonePaletteStats();
+}
+
+void BonePalette::endFrame() {
+    ring.endFrame();
+}
+
+void BonePalette::bind(const std::vector<glm::mat4>& boneMatrices) {
+    if (boneMatrices.empty()) {
+        return;
+    }
+
+    // glm is column-major, the packed rows are the first three components of every column
+    packed.resize(boneMatrices.size());
+    for (size_t i = 0; i < boneMatrices.size(); ++i) {
+        const glm::mat4& m = boneMatrices[i];
+        packed[i].rows[0] = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+        packed[i].rows[1] = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+        packed[i].rows[2] = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+    }
+
+    const size_t size = packed.size() * sizeof(PackedBone);
+    const size_t offset = ring.write(packed.data(), size, alignment);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, bindingPoint, ring.getBuffer(), static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+
+    ++current.palettes;
+    current.bones += packed.size();
+    current.bytes += size;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <vector>
+#include "rendering/GpuRingBuffer.h"
+
+struct BonePaletteStats {
+    size_t palettes = 0; // Skinned draws this frame
+    size_t bones = 0;
+    size_t bytes = 0;
+};
+
+// Streams the bone matrices of every skinned draw into a shader storage ring buffer, one write per
+// draw, and binds that range to bindingPoint for the draw. Each bone is the top three rows of its
+// affine matrix (48 bytes). Shaders declare
+//     layout(std430, binding = 1) readonly buffer BonePalette { mat3x4 bones[]; };
+// and skin with vec4(position, 1.0) * bones[id], so skeletons of any size fit.
+class BonePalette {
+public:
+    static constexpr GLuint bindingPoint = 1;
+
+    static BonePalette& instance();
+
+    // Render thread, once per frame around all skinned draws
+    void beginFrame();
+    void endFrame();
+
+    // Uploads the palette and binds it for the next draw
+    void bind(const std::vector<glm::mat4>& boneMatrices);
+
+    const BonePaletteStats& getStats() const { return lastFrame; }
+
+private:
+    BonePalette();
+    BonePalette(const BonePalette&) = delete;
+    BonePalette& operator=(const BonePalette&) = delete;
+
+    struct PackedBone {
+        glm::vec4 rows[3];
+    };
+    static_assert(sizeof(PackedBone) == 48, "Bones are packed as three vec4 rows");
+
+    GpuRingBuffer ring;
+    size_t alignment = 256;
+    std::vector<PackedBone> packed;
+    BonePaletteStats current;
+    BonePaletteStats lastFrame;
+};
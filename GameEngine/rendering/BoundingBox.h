@@ -0,0 +1,80 @@
+// BoundingBox.h
+#pragma once
+#include <cfloat>
+#include <glm/glm.hpp>
+
+// Axis-aligned box. A default constructed box is empty and grows through merge.
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    BoundingBox() = default;
+    BoundingBox(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+    bool isEmpty() const { return min.x > max.x; }
+    glm::vec3 getCenter() const { return (min + max) * 0.5f; }
+    glm::vec3 getExtents() const { return (max - min) * 0.5f; }
+
+    void merge(const BoundingBox& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    static BoundingBox merged(const BoundingBox& a, const BoundingBox& b) {
+        return BoundingBox(glm::min(a.min, b.min), glm::max(a.max, b.max));
+    }
+
+    BoundingBox expanded(float margin) const {
+        return BoundingBox(min - glm::vec3(margin), max + glm::vec3(margin));
+    }
+
+    bool contains(const BoundingBox& other) const {
+        return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+            && other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+    }
+
+    bool intersects(const BoundingBox& other) const {
+        return min.x <= other.max.x && other.min.x <= max.x
+            && min.y <= other.max.y && other.min.y <= max.y
+            && min.z <= other.max.z && other.min.z <= max.z;
+    }
+
+    // Half the surface area, the cost measure of the surface area heuristic
+    float getHalfArea() const {
+        glm::vec3 size = max - min;
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    // 0 for points inside the box
+    float distanceSquared(const glm::vec3& point) const {
+        glm::vec3 delta = glm::max(glm::max(min - point, point - max), glm::vec3(0.0f));
+        return glm::dot(delta, delta);
+    }
+
+    // Slab test of the ray from origin with inverseDirection = 1 / direction. On a hit within
+    // maxDistance, entry is set to the distance at which the ray enters the box, 0 when it starts inside.
+    bool intersectsRay(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance, float& entry) const {
+        glm::vec3 t0 = (min - origin) * inverseDirection;
+        glm::vec3 t1 = (max - origin) * inverseDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float enter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+        float exit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, maxDistance));
+        entry = enter;
+        return enter <= exit;
+    }
+
+    // Box enclosing this one after an affine transform. Each world axis gathers the extents scaled
+    // by the absolute matrix terms, so the result stays tight under rotation (Arvo).
+    BoundingBox transformed(const glm::mat4& transform) const {
+        if (isEmpty()) {
+            return *this;
+        }
+        glm::vec3 center = glm::vec3(transform * glm::vec4(getCenter(), 1.0f));
+        glm::vec3 extents = getExtents();
+        glm::vec3 worldExtents = glm::abs(glm::vec3(transform[0])) * extents.x
+            + glm::abs(glm::vec3(transform[1])) * extents.y
+            + glm::abs(glm::vec3(transform[2])) * extents.z;
+        return BoundingBox(center - worldExtents, center + worldExtents);
+    }
+};
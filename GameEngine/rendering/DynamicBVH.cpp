@@ -0,0 +1,306 @@
+#include "DynamicBVH.h"
+#include <cassert>
+#include <functional>
+#include <initializer_list>
+
+DynamicBVH::DynamicBVH(float margin)
+    : margin(margin) {}
+
+int DynamicBVH::allocateNode() {
+    if (freeList == nullNode) {
+        nodes.emplace_back();
+        nodes.back().height = 0;
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+    const int node = freeList;
+    freeList = nodes[node].parent;
+    nodes[node] = TreeNode();
+    nodes[node].height = 0;
+    return node;
+}
+
+void DynamicBVH::freeNode(int node) {
+    nodes[node].parent = freeList;
+    nodes[node].height = -1;
+    nodes[node].userData = nullptr;
+    freeList = node;
+}
+
+int DynamicBVH::createProxy(const BoundingBox& box, void* userData) {
+    const int proxy = allocateNode();
+    nodes[proxy].box = box.expanded(margin);
+    nodes[proxy].objectBox = box;
+    nodes[proxy].userData = userData;
+    insertLeaf(proxy);
+    ++proxyCount;
+    return proxy;
+}
+
+void DynamicBVH::destroyProxy(int proxy) {
+    assert(nodes[proxy].isLeaf() && nodes[proxy].height == 0);
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --proxyCount;
+}
+
+bool DynamicBVH::moveProxy(int proxy, const BoundingBox& box) {
+    TreeNode& node = nodes[proxy];
+    node.objectBox = box;
+
+    // Keep the fat box while it holds the proxy and has not grown far larger than it
+    if (node.box.contains(box) && box.expanded(4.0f * margin).contains(node.box)) {
+        return false;
+    }
+
+    removeLeaf(proxy);
+    nodes[proxy].box = box.expanded(margin);
+    insertLeaf(proxy);
+    ++reinsertions;
+    return true;
+}
+
+void DynamicBVH::clear() {
+    nodes.clear();
+    candidates.clear();
+    root = nullNode;
+    freeList = nullNode;
+    proxyCount = 0;
+}
+
+int DynamicBVH::findBestSibling(const BoundingBox& box) {
+    // Inserting next to a node costs the area of the new parent plus the growth of every ancestor.
+    // Descending only pays off while that inherited growth and the box itself stay below the best cost.
+    const float boxArea = box.getHalfArea();
+    int best = root;
+    float bestCost = BoundingBox::merged(nodes[root].box, box).getHalfArea();
+
+    candidates.clear();
+    candidates.push_back(Candidate{ 0.0f, root });
+    while (!candidates.empty()) {
+        std::pop_heap(candidates.begin(), candidates.end());
+        const Candidate candidate = candidates.back();
+        candidates.pop_back();
+
+        const TreeNode& node = nodes[candidate.node];
+        const float directCost = BoundingBox::merged(node.box, box).getHalfArea();
+        const float cost = directCost + candidate.inheritedCost;
+        if (cost < bestCost) {
+            bestCost = cost;
+            best = candidate.node;
+        }
+
+        if (node.isLeaf()) {
+            continue;
+        }
+        const float inheritedCost = candidate.inheritedCost + directCost - node.box.getHalfArea();
+        if (boxArea + inheritedCost < bestCost) {
+            candidates.push_back(Candidate{ inheritedCost, node.child1 });
+            std::push_heap(candidates.begin(), candidates.end());
+            candidates.push_back(Candidate{ inheritedCost, node.child2 });
+            std::push_heap(candidates.begin(), candidates.end());
+        }
+    }
+    return best;
+}
+
+void DynamicBVH::insertLeaf(int leaf) {
+    if (root == nullNode) {
+        root = leaf;
+        nodes[root].parent = nullNode;
+        return;
+    }
+
+    const int sibling = findBestSibling(nodes[leaf].box);
+    const int oldParent = nodes[sibling].parent;
+    const int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].box = BoundingBox::merged(nodes[leaf].box, nodes[sibling].box);
+    nodes[newParent].height = nodes[sibling].height + 1;
+    nodes[newParent].child1 = sibling;
+    nodes[newParent].child2 = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == nullNode) {
+        root = newParent;
+    }
+    else if (nodes[oldParent].child1 == sibling) {
+        nodes[oldParent].child1 = newParent;
+    }
+    else {
+        nodes[oldParent].child2 = newParent;
+    }
+
+    refitAncestors(newParent);
+}
+
+void DynamicBVH::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = nullNode;
+        return;
+    }
+
+    const int parent = nodes[leaf].parent;
+    const int grandParent = nodes[parent].parent;
+    const int sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+    // The sibling takes the place of the parent
+    if (grandParent == nullNode) {
+        root = sibling;
+        nodes[sibling].parent = nullNode;
+        freeNode(parent);
+        return;
+    }
+
+    if (nodes[grandParent].child1 == parent) {
+        nodes[grandParent].child1 = sibling;
+    }
+    else {
+        nodes[grandParent].child2 = sibling;
+    }
+    nodes[sibling].parent = grandParent;
+    freeNode(parent);
+    refitAncestors(grandParent);
+}
+
+void DynamicBVH::refitAncestors(int node) {
+    for (int index = node; index != nullNode; index = nodes[index].parent) {
+        rotate(index);
+
+        TreeNode& current = nodes[index];
+        const TreeNode& child1 = nodes[current.child1];
+        const TreeNode& child2 = nodes[current.child2];
+        current.box = BoundingBox::merged(child1.box, child2.box);
+        current.height = 1 + std::max(child1.height, child2.height);
+    }
+}
+
+void DynamicBVH::rotate(int a) {
+    TreeNode& nodeA = nodes[a];
+    if (nodeA.height < 2) {
+        return;
+    }
+
+    // Swapping a child of A with a grandchild on the other side changes the area of one child only
+    const int b = nodeA.child1;
+    const int c = nodeA.child2;
+    enum class Rotation { None, BF, BG, CD, CE };
+    Rotation best = Rotation::None;
+    float bestDelta = 0.0f;
+
+    if (!nodes[c].isLeaf()) {
+        const float areaC = nodes[c].box.getHalfArea();
+        const int f = nodes[c].child1;
+        const int g = nodes[c].child2;
+        const float deltaBF = BoundingBox::merged(nodes[b].box, nodes[g].box).getHalfArea() - areaC;
+        const float deltaBG = BoundingBox::merged(nodes[b].box, nodes[f].box).getHalfArea() - areaC;
+        if (deltaBF < bestDelta) { best = Rotation::BF; bestDelta = deltaBF; }
+        if (deltaBG < bestDelta) { best = Rotation::BG; bestDelta = deltaBG; }
+    }
+    if (!nodes[b].isLeaf()) {
+        const float areaB = nodes[b].box.getHalfArea();
+        const int d = nodes[b].child1;
+        const int e = nodes[b].child2;
+        const float deltaCD = BoundingBox::merged(nodes[c].box, nodes[e].box).getHalfArea() - areaB;
+        const float deltaCE = BoundingBox::merged(nodes[c].box, nodes[d].box).getHalfArea() - areaB;
+        if (deltaCD < bestDelta) { best = Rotation::CD; bestDelta = deltaCD; }
+        if (deltaCE < bestDelta) { best = Rotation::CE; bestDelta = deltaCE; }
+    }
+    if (best == Rotation::None) {
+        return;
+    }
+
+    // Moves the child of A into the slot of the grandchild, whose parent is then refit
+    auto swap = [this, a](int child, int parent, bool firstGrandchild) {
+        TreeNode& p = nodes[parent];
+        const int grandchild = firstGrandchild ? p.child1 : p.child2;
+        if (nodes[a].child1 == child) {
+            nodes[a].child1 = grandchild;
+        }
+        else {
+            nodes[a].child2 = grandchild;
+        }
+        nodes[grandchild].parent = a;
+        (firstGrandchild ? p.child1 : p.child2) = child;
+        nodes[child].parent = parent;
+        p.box = BoundingBox::merged(nodes[p.child1].box, nodes[p.child2].box);
+        p.height = 1 + std::max(nodes[p.child1].height, nodes[p.child2].height);
+    };
+
+    switch (best) {
+    case Rotation::BF: swap(b, c, true); break;
+    case Rotation::BG: swap(b, c, false); break;
+    case Rotation::CD: swap(c, b, true); break;
+    case Rotation::CE: swap(c, b, false); break;
+    default: break;
+    }
+    nodes[a].height = 1 + std::max(nodes[nodes[a].child1].height, nodes[nodes[a].child2].height);
+    ++rotations;
+}
+
+void DynamicBVH::queryNearest(const glm::vec3& point, size_t k, std::vector<BVHNearest>& results) const {
+    results.clear();
+    if (root == nullNode || k == 0) {
+        return;
+    }
+
+    // Best first over the nodes; results is kept as a max-heap on distance until the end
+    auto farther = [](const BVHNearest& x, const BVHNearest& y) { return x.distanceSquared < y.distanceSquared; };
+    std::vector<std::pair<float, int>> open;
+    open.emplace_back(nodes[root].box.distanceSquared(point), root);
+    while (!open.empty()) {
+        std::pop_heap(open.begin(), open.end(), std::greater<>());
+        const auto [distance, index] = open.back();
+        open.pop_back();
+        if (results.size() == k && distance >= results.front().distanceSquared) {
+            break;
+        }
+
+        const TreeNode& node = nodes[index];
+        if (node.isLeaf()) {
+            const float objectDistance = node.objectBox.distanceSquared(point);
+            if (results.size() < k) {
+                results.push_back(BVHNearest{ node.userData, objectDistance });
+                std::push_heap(results.begin(), results.end(), farther);
+            }
+            else if (objectDistance < results.front().distanceSquared) {
+                std::pop_heap(results.begin(), results.end(), farther);
+                results.back() = BVHNearest{ node.userData, objectDistance };
+                std::push_heap(results.begin(), results.end(), farther);
+            }
+            continue;
+        }
+
+        for (int child : { node.child1, node.child2 }) {
+            open.emplace_back(nodes[child].box.distanceSquared(point), child);
+            std::push_heap(open.begin(), open.end(), std::greater<>());
+        }
+    }
+    std::sort_heap(results.begin(), results.end(), farther);
+}
+
+DynamicBVHStats DynamicBVH::getStats() const {
+    DynamicBVHStats stats;
+    stats.proxies = proxyCount;
+    stats.reinsertions = reinsertions;
+    stats.rotations = rotations;
+    if (root == nullNode) {
+        return stats;
+    }
+
+    stats.height = nodes[root].height;
+    float internalArea = 0.0f;
+    for (const TreeNode& node : nodes) {
+        if (node.height < 0) {
+            continue;
+        }
+        ++stats.nodes;
+        if (!node.isLeaf()) {
+            internalArea += node.box.getHalfArea();
+        }
+    }
+    const float rootArea = nodes[root].box.getHalfArea();
+    stats.areaRatio = rootArea > 0.0f ? internalArea / rootArea : 0.0f;
+    return stats;
+}
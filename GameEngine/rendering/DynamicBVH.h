@@ -0,0 +1,296 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "rendering/BoundingBox.h"
+#include "rendering/FrustumCuller.h"
+
+struct DynamicBVHStats {
+    size_t proxies = 0;
+    size_t nodes = 0;
+    int height = 0;
+    float areaRatio = 0.0f;  // Summed area of the internal nodes over the root area, lower is a better tree
+    size_t reinsertions = 0; // Moves that left their fat box
+    size_t rotations = 0;
+};
+
+struct BVHNearest {
+    void* userData;
+    float distanceSquared;
+};
+
+// Dynamic AABB tree over proxies, each a box with a user pointer. Leaves store the box enlarged by a
+// margin, so small moves leave the tree untouched; a proxy is reinserted once its box leaves the fat
+// one. Insertion picks the sibling with the lowest surface area heuristic cost through a branch and
+// bound search, then the path back to the root is refit and rotated where swapping a child with a
+// grandchild reduces the summed area (Kensler).
+class DynamicBVH {
+public:
+    static constexpr int nullNode = -1;
+
+    explicit DynamicBVH(float margin = 0.1f);
+
+    int createProxy(const BoundingBox& box, void* userData);
+    void destroyProxy(int proxy);
+    // Returns true when the proxy had to be reinserted
+    bool moveProxy(int proxy, const BoundingBox& box);
+    void clear();
+
+    void* getUserData(int proxy) const { return nodes[proxy].userData; }
+    const BoundingBox& getBounds(int proxy) const { return nodes[proxy].objectBox; }
+    size_t size() const { return proxyCount; }
+    DynamicBVHStats getStats() const;
+
+    // Visits every proxy whose box overlaps. The callback takes the user pointer and returns false to stop.
+    template <typename Callback>
+    void queryBox(const BoundingBox& box, Callback&& callback) const;
+    template <typename Callback>
+    void querySphere(const glm::vec3& center, float radius, Callback&& callback) const;
+
+    // Visits the proxies whose box intersects the frustum set on the culler. The children of
+    // several nodes are tested as one SIMD group with plane masks, subtrees inside every plane are
+    // visited without further tests.
+    template <typename Callback>
+    void queryFrustum(FrustumCuller& culler, Callback&& callback);
+
+    // Visits the proxies hit along the ray, nearer boxes first. The callback takes the user pointer
+    // and the distance at which the ray enters the box, and returns the distance of its own hit to
+    // clip the ray there, or maxDistance to keep going.
+    template <typename Callback>
+    void raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const;
+
+    // The k proxies nearest to the point, nearest first
+    void queryNearest(const glm::vec3& point, size_t k, std::vector<BVHNearest>& results) const;
+
+    // Visits the user pointer of every proxy, in no particular order
+    template <typename Callback>
+    void forEachProxy(Callback&& callback) const {
+        for (const TreeNode& node : nodes) {
+            if (node.height == 0) {
+                callback(node.userData);
+            }
+        }
+    }
+
+private:
+    struct TreeNode {
+        BoundingBox box;       // Fat box for leaves
+        BoundingBox objectBox; // Exact box, leaves only
+        void* userData = nullptr;
+        int parent = nullNode; // Next free node while on the free list
+        int child1 = nullNode;
+        int child2 = nullNode;
+        int height = -1;       // 0 for leaves, -1 while free
+        uint8_t cullPlane = 0; // Frustum plane that last rejected one of the children
+
+        bool isLeaf() const { return child1 == nullNode; }
+    };
+
+    int allocateNode();
+    void freeNode(int node);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int findBestSibling(const BoundingBox& box);
+    void refitAncestors(int node);
+    void rotate(int node);
+
+    std::vector<TreeNode> nodes;
+    int root = nullNode;
+    int freeList = nullNode;
+    size_t proxyCount = 0;
+    float margin;
+    size_t reinsertions = 0;
+    size_t rotations = 0;
+    uint8_t rootCullPlane = 0;
+
+    struct Candidate {
+        float inheritedCost;
+        int node;
+        bool operator<(const Candidate& other) const { return inheritedCost > other.inheritedCost; }
+    };
+    std::vector<Candidate> candidates; // Heap of the sibling search
+};
+
+template <typename Callback>
+void DynamicBVH::queryBox(const BoundingBox& box, Callback&& callback) const {
+    if (root == nullNode) {
+        return;
+    }
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const TreeNode& node = nodes[stack.back()];
+        stack.pop_back();
+        if (!node.box.intersects(box)) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (node.objectBox.intersects(box) && !callback(node.userData)) {
+                return;
+            }
+        }
+        else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBVH::querySphere(const glm::vec3& center, float radius, Callback&& callback) const {
+    if (root == nullNode) {
+        return;
+    }
+
+    const float radiusSquared = radius * radius;
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const TreeNode& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.box.distanceSquared(center) > radiusSquared) {
+            continue;
+        }
+        if (node.isLeaf()) {
+            if (node.objectBox.distanceSquared(center) <= radiusSquared && !callback(node.userData)) {
+                return;
+            }
+        }
+        else {
+            stack.push_back(node.child1);
+            stack.push_back(node.child2);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBVH::queryFrustum(FrustumCuller& culler, Callback&& callback) {
+    if (root == nullNode) {
+        return;
+    }
+
+    // Leaves are tested with their exact box like in the other queries, the fat one only shapes the tree
+    auto testedBox = [this](int index) -> const BoundingBox& {
+        return nodes[index].isLeaf() ? nodes[index].objectBox : nodes[index].box;
+    };
+
+    uint8_t rootMask;
+    culler.testBoxes(&testedBox(root), 1, FrustumCuller::allPlanes, &rootMask, rootCullPlane);
+    if (rootMask == FrustumCuller::culled) {
+        culler.addCulled(1, 0);
+        return;
+    }
+
+    std::vector<std::pair<int, uint8_t>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, rootMask);
+    while (!stack.empty()) {
+        // Gather the children of several nodes into one SIMD group. They are tested against the
+        // planes any of their parents still crosses; a child inside a plane its parent was already
+        // inside simply clears the bit again.
+        BoundingBox boxes[FrustumCuller::maxGroupSize];
+        int children[FrustumCuller::maxGroupSize];
+        int parents[FrustumCuller::maxGroupSize / 2];
+        size_t count = 0;
+        size_t parentCount = 0;
+        uint8_t groupMask = 0;
+        while (!stack.empty() && count < FrustumCuller::maxGroupSize) {
+            const auto [index, planeMask] = stack.back();
+            stack.pop_back();
+            const TreeNode& node = nodes[index];
+            if (node.isLeaf()) {
+                callback(node.userData);
+                continue;
+            }
+            if (planeMask == 0) {
+                stack.emplace_back(node.child1, 0);
+                stack.emplace_back(node.child2, 0);
+                continue;
+            }
+            boxes[count] = testedBox(node.child1);
+            children[count++] = node.child1;
+            boxes[count] = testedBox(node.child2);
+            children[count++] = node.child2;
+            parents[parentCount++] = index;
+            groupMask |= planeMask;
+        }
+        if (count == 0) {
+            continue;
+        }
+
+        uint8_t masks[FrustumCuller::maxGroupSize];
+        uint8_t cullPlane = nodes[parents[0]].cullPlane;
+        culler.testBoxes(boxes, count, groupMask, masks, cullPlane);
+        for (size_t i = 0; i < parentCount; ++i) {
+            nodes[parents[i]].cullPlane = cullPlane;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (masks[i] == FrustumCuller::culled) {
+                culler.addCulled(1, 0);
+                continue;
+            }
+            if (masks[i] == 0) {
+                culler.addInside(1);
+            }
+            stack.emplace_back(children[i], masks[i]);
+        }
+    }
+}
+
+template <typename Callback>
+void DynamicBVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Callback&& callback) const {
+    if (root == nullNode) {
+        return;
+    }
+
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    float entry;
+    if (!nodes[root].box.intersectsRay(origin, inverseDirection, maxDistance, entry)) {
+        return;
+    }
+
+    // Entries carry the distance at which the ray entered the node, it may be past a hit found since
+    std::vector<std::pair<int, float>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, entry);
+    while (!stack.empty()) {
+        const auto [index, nodeEntry] = stack.back();
+        stack.pop_back();
+        if (nodeEntry > maxDistance) {
+            continue;
+        }
+
+        const TreeNode& node = nodes[index];
+        if (node.isLeaf()) {
+            float objectEntry;
+            if (node.objectBox.intersectsRay(origin, inverseDirection, maxDistance, objectEntry)) {
+                maxDistance = std::min(maxDistance, callback(node.userData, objectEntry));
+            }
+            continue;
+        }
+
+        float entry1, entry2;
+        const bool hit1 = nodes[node.child1].box.intersectsRay(origin, inverseDirection, maxDistance, entry1);
+        const bool hit2 = nodes[node.child2].box.intersectsRay(origin, inverseDirection, maxDistance, entry2);
+        // The nearer child goes on top
+        if (hit1 && hit2 && entry1 < entry2) {
+            stack.emplace_back(node.child2, entry2);
+            stack.emplace_back(node.child1, entry1);
+        }
+        else {
+            if (hit1) {
+                stack.emplace_back(node.child1, entry1);
+            }
+            if (hit2) {
+                stack.emplace_back(node.child2, entry2);
+            }
+        }
+    }
+}
@@ -0,0 +1,172 @@
+#include "DynamicBVHBenchmark.h"
+#include "rendering/DynamicBVH.h"
+#include "rendering/Frustum.h"
+#include "rendering/FrustumCuller.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double elapsedMs(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    constexpr int frames = 60;
+    constexpr int queriesPerFrame = 64;
+}
+
+void runDynamicBVHBenchmark(size_t objectCount, std::ostream& out) {
+    // Objects spread over a square kilometre, most of them small props
+    std::mt19937 random(1234);
+    const float worldSize = 1000.0f;
+    std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+    std::uniform_real_distribution<float> height(0.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.25f, 4.0f);
+    std::uniform_real_distribution<float> step(-0.05f, 0.05f); // Walking pace at 60 frames per second
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    std::vector<BoundingBox> boxes(objectCount);
+    for (BoundingBox& box : boxes) {
+        glm::vec3 center(position(random), height(random), position(random));
+        glm::vec3 extents(size(random), size(random), size(random));
+        box = BoundingBox(center - extents, center + extents);
+    }
+
+    out << "[DynamicBVH] " << objectCount << " objects" << std::endl;
+
+    DynamicBVH tree;
+    std::vector<int> proxies(objectCount);
+    auto start = Clock::now();
+    for (size_t i = 0; i < objectCount; ++i) {
+        proxies[i] = tree.createProxy(boxes[i], reinterpret_cast<void*>(i));
+    }
+    const double buildMs = elapsedMs(start);
+    DynamicBVHStats stats = tree.getStats();
+    out << "  build " << buildMs << " ms, height " << stats.height << ", area ratio " << stats.areaRatio << std::endl;
+
+    // A tenth of the objects move every frame, a few of them far enough to leave their fat box
+    const size_t movers = std::max<size_t>(1, objectCount / 10);
+    double updateMs = 0.0;
+    for (int frame = 0; frame < frames; ++frame) {
+        start = Clock::now();
+        for (size_t m = 0; m < movers; ++m) {
+            const size_t i = (static_cast<size_t>(frame) * movers + m) % objectCount;
+            glm::vec3 delta(step(random), 0.0f, step(random));
+            if (m % 16 == 0) {
+                delta *= 400.0f;
+            }
+            boxes[i] = BoundingBox(boxes[i].min + delta, boxes[i].max + delta);
+            tree.moveProxy(proxies[i], boxes[i]);
+        }
+        updateMs += elapsedMs(start);
+    }
+    stats = tree.getStats();
+    out << "  update " << movers << " moves/frame: " << updateMs / frames << " ms/frame, " << stats.reinsertions
+        << " reinsertions, " << stats.rotations << " rotations, height " << stats.height << ", area ratio " << stats.areaRatio << std::endl;
+
+    // Frustum: a camera above the field looking across it
+    Frustum frustum;
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 300.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 30.0f, 0.0f), glm::vec3(100.0f, 0.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    frustum.update(projection * view);
+    FrustumCuller culler;
+
+    size_t treeVisible = 0;
+    std::vector<char> treeVisibleObjects(objectCount);
+    start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        culler.begin(frustum);
+        treeVisible = 0;
+        tree.queryFrustum(culler, [&](void* userData) {
+            treeVisibleObjects[reinterpret_cast<size_t>(userData)] = 1;
+            ++treeVisible;
+        });
+    }
+    const double treeFrustumMs = elapsedMs(start) / frames;
+
+    size_t linearVisible = 0;
+    std::vector<char> linearVisibleObjects(objectCount);
+    start = Clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+        linearVisible = 0;
+        for (size_t i = 0; i < objectCount; ++i) {
+            linearVisibleObjects[i] = frustum.intersects(boxes[i]) ? 1 : 0;
+            linearVisible += linearVisibleObjects[i];
+        }
+    }
+    const double linearFrustumMs = elapsedMs(start) / frames;
+    size_t frustumMismatches = 0;
+    for (size_t i = 0; i < objectCount; ++i) {
+        frustumMismatches += treeVisibleObjects[i] != linearVisibleObjects[i] ? 1 : 0;
+    }
+    out << "  frustum: tree " << treeFrustumMs << " ms (" << treeVisible << " visible, " << culler.getStats().nodesTested
+        << " nodes tested), linear " << linearFrustumMs << " ms (" << linearVisible << " visible), "
+        << frustumMismatches << " mismatches" << std::endl;
+
+    // Rays from random points above the field, aimed down and across it; sphere and nearest queries around random points
+    size_t rayMismatches = 0, sphereMismatches = 0, nearestMismatches = 0;
+    double treeRayMs = 0.0, linearRayMs = 0.0, treeSphereMs = 0.0, linearSphereMs = 0.0, treeNearestMs = 0.0, linearNearestMs = 0.0;
+    std::vector<BVHNearest> nearest;
+    const size_t k = 8;
+    for (int query = 0; query < queriesPerFrame * 4; ++query) {
+        glm::vec3 origin(position(random), 60.0f, position(random));
+        glm::vec3 direction = glm::normalize(glm::vec3(unit(random), -1.0f, unit(random)));
+        const glm::vec3 inverseDirection = 1.0f / direction;
+        const float maxDistance = 500.0f;
+
+        start = Clock::now();
+        float treeHit = maxDistance;
+        tree.raycast(origin, direction, maxDistance, [&](void*, float entry) { treeHit = std::min(treeHit, entry); return entry; });
+        treeRayMs += elapsedMs(start);
+
+        start = Clock::now();
+        float linearHit = maxDistance;
+        for (size_t i = 0; i < objectCount; ++i) {
+            float entry;
+            if (boxes[i].intersectsRay(origin, inverseDirection, linearHit, entry)) {
+                linearHit = std::min(linearHit, entry);
+            }
+        }
+        linearRayMs += elapsedMs(start);
+        rayMismatches += std::abs(treeHit - linearHit) > 1e-3f ? 1 : 0;
+
+        glm::vec3 center(position(random), height(random), position(random));
+        const float radius = 20.0f;
+        start = Clock::now();
+        size_t treeCount = 0;
+        tree.querySphere(center, radius, [&](void*) { ++treeCount; return true; });
+        treeSphereMs += elapsedMs(start);
+
+        start = Clock::now();
+        size_t linearCount = 0;
+        for (size_t i = 0; i < objectCount; ++i) {
+            linearCount += boxes[i].distanceSquared(center) <= radius * radius ? 1 : 0;
+        }
+        linearSphereMs += elapsedMs(start);
+        sphereMismatches += treeCount != linearCount ? 1 : 0;
+
+        start = Clock::now();
+        tree.queryNearest(center, k, nearest);
+        treeNearestMs += elapsedMs(start);
+
+        start = Clock::now();
+        std::vector<float> distances(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) {
+            distances[i] = boxes[i].distanceSquared(center);
+        }
+        std::nth_element(distances.begin(), distances.begin() + (k - 1), distances.end());
+        linearNearestMs += elapsedMs(start);
+        nearestMismatches += nearest.size() != k || std::abs(nearest.back().distanceSquared - distances[k - 1]) > 1e-3f ? 1 : 0;
+    }
+
+    const int queries = queriesPerFrame * 4;
+    out << "  ray: tree " << treeRayMs / queries << " ms, linear " << linearRayMs / queries << " ms, " << rayMismatches << " mismatches" << std::endl;
+    out << "  sphere: tree " << treeSphereMs / queries << " ms, linear " << linearSphereMs / queries << " ms, " << sphereMismatches << " mismatches" << std::endl;
+    out << "  " << k << " nearest: tree " << treeNearestMs / queries << " ms, linear " << linearNearestMs / queries << " ms, "
+        << nearestMismatches << " mismatches" << std::endl;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+
+// Builds a DynamicBVH over objectCount random boxes, moves a share of them per frame and times the
+// frustum, ray, sphere and nearest queries against a linear scan, checking that both agree.
+// Run with GameEngine --bvh-benchmark.
+void runDynamicBVHBenchmark(size_t objectCount, std::ostream& out);
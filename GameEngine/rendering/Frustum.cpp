@@ -23,3 +23,23 @@ void Frustum::update(const glm::mat4& VPMatrix) {
     }
 }
 
+bool Frustum::intersects(const BoundingBox& box) const {
+    if (box.isEmpty()) {
+        return false;
+    }
+
+    for (int i = 0; i < 6; ++i) {
+        const Plane& plane = planes[i];
+
+        // The corner furthest along the plane normal
+        glm::vec3 pVertex = box.min;
+        if (plane.normal.x >= 0) pVertex.x = box.max.x;
+        if (plane.normal.y >= 0) pVertex.y = box.max.y;
+        if (plane.normal.z >= 0) pVertex.z = box.max.z;
+
+        if (glm::dot(plane.normal, pVertex) + plane.distance < 0) {
+            return false;
+        }
+    }
+    return true;
+}
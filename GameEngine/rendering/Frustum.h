@@ -1,6 +1,7 @@
 // Frustum.h
 #pragma once
 #include <glm/glm.hpp>
+#include "rendering/BoundingBox.h"
 
 struct Plane {
     glm::vec3 normal;
@@ -17,5 +18,8 @@ struct Frustum {
     Plane planes[6];
 
     void update(const glm::mat4& VPMatrix);
+
+    // False once the box lies entirely behind one of the planes
+    bool intersects(const BoundingBox& box) const;
 };
 
@@ -0,0 +1,125 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define FRUSTUM_CULLER_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FRUSTUM_CULLER_SSE
+#endif
+
+namespace {
+
+#if defined(FRUSTUM_CULLER_AVX)
+struct SimdLanes {
+    using Vec = __m256;
+    static constexpr int lanes = 8;
+    static Vec load(const float* values) { return _mm256_load_ps(values); }
+    static Vec broadcast(float value) { return _mm256_set1_ps(value); }
+    static Vec add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+    static int negativeMask(Vec a) { return _mm256_movemask_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_LT_OQ)); }
+};
+#elif defined(FRUSTUM_CULLER_SSE)
+struct SimdLanes {
+    using Vec = __m128;
+    static constexpr int lanes = 4;
+    static Vec load(const float* values) { return _mm_load_ps(values); }
+    static Vec broadcast(float value) { return _mm_set1_ps(value); }
+    static Vec add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+    static int negativeMask(Vec a) { return _mm_movemask_ps(_mm_cmplt_ps(a, _mm_setzero_ps())); }
+};
+#else
+struct SimdLanes {
+    using Vec = float;
+    static constexpr int lanes = 1;
+    static Vec load(const float* values) { return *values; }
+    static Vec broadcast(float value) { return value; }
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec sub(Vec a, Vec b) { return a - b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+    static int negativeMask(Vec a) { return a < 0.0f ? 1 : 0; }
+};
+#endif
+
+} // namespace
+
+void FrustumCuller::begin(const Frustum& frustum) {
+    for (int i = 0; i < 6; ++i) {
+        normalX[i] = frustum.planes[i].normal.x;
+        normalY[i] = frustum.planes[i].normal.y;
+        normalZ[i] = frustum.planes[i].normal.z;
+        distance[i] = frustum.planes[i].distance;
+    }
+    stats = CullingStats();
+}
+
+void FrustumCuller::testBoxes(const BoundingBox* boxes, size_t count, uint8_t planeMask, uint8_t* masks, uint8_t& cachedPlane) {
+    stats.nodesTested += count;
+    const size_t lanes = SimdLanes::lanes;
+    for (size_t first = 0; first < count; first += lanes) {
+        testGroup<SimdLanes>(boxes + first, std::min(lanes, count - first), planeMask, masks + first, cachedPlane);
+    }
+}
+
+template <typename Simd>
+void FrustumCuller::testGroup(const BoundingBox* boxes, size_t count, uint8_t planeMask, uint8_t* masks, uint8_t& cachedPlane) {
+    using Vec = typename Simd::Vec;
+    constexpr int lanes = Simd::lanes;
+    constexpr int allLanes = (1 << lanes) - 1;
+
+    // Boxes as centers and extents, lanes without a box start out culled
+    alignas(32) float centerX[lanes] = {}, centerY[lanes] = {}, centerZ[lanes] = {};
+    alignas(32) float extentX[lanes] = {}, extentY[lanes] = {}, extentZ[lanes] = {};
+    int outside = allLanes;
+    for (size_t i = 0; i < count; ++i) {
+        if (boxes[i].isEmpty()) {
+            continue;
+        }
+        const glm::vec3 center = boxes[i].getCenter();
+        const glm::vec3 extents = boxes[i].getExtents();
+        centerX[i] = center.x; centerY[i] = center.y; centerZ[i] = center.z;
+        extentX[i] = extents.x; extentY[i] = extents.y; extentZ[i] = extents.z;
+        outside &= ~(1 << i);
+    }
+
+    const Vec cx = Simd::load(centerX), cy = Simd::load(centerY), cz = Simd::load(centerZ);
+    const Vec ex = Simd::load(extentX), ey = Simd::load(extentY), ez = Simd::load(extentZ);
+    uint8_t crossing[lanes] = {};
+
+    const int firstPlane = cachedPlane;
+    for (int k = 0; k < 6 && outside != allLanes; ++k) {
+        const int plane = (firstPlane + k) % 6;
+        if (!(planeMask & (1 << plane))) {
+            continue;
+        }
+
+        // Signed distance of the center and the projected radius of the box along the normal
+        const Vec dist = Simd::add(Simd::add(Simd::mul(Simd::broadcast(normalX[plane]), cx), Simd::mul(Simd::broadcast(normalY[plane]), cy)),
+            Simd::add(Simd::mul(Simd::broadcast(normalZ[plane]), cz), Simd::broadcast(distance[plane])));
+        const Vec radius = Simd::add(Simd::add(Simd::mul(Simd::broadcast(std::fabs(normalX[plane])), ex),
+            Simd::mul(Simd::broadcast(std::fabs(normalY[plane])), ey)), Simd::mul(Simd::broadcast(std::fabs(normalZ[plane])), ez));
+        ++stats.planeTests;
+
+        const int rejected = Simd::negativeMask(Simd::add(dist, radius)) & ~outside;
+        const int crosses = Simd::negativeMask(Simd::sub(dist, radius));
+        if (rejected) {
+            cachedPlane = static_cast<uint8_t>(plane);
+        }
+        outside |= rejected;
+        for (int i = 0; i < lanes; ++i) {
+            if (crosses & (1 << i)) {
+                crossing[i] |= static_cast<uint8_t>(1 << plane);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        masks[i] = (outside & (1 << i)) ? culled : crossing[i];
+    }
+}
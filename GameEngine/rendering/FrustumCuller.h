@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "rendering/BoundingBox.h"
+#include "rendering/Frustum.h"
+
+struct CullingStats {
+    size_t objectsVisible = 0;  // Drawables that reached the render queue
+    size_t objectsCulled = 0;
+    size_t nodesTested = 0;     // BVH nodes
+    size_t nodesCulled = 0;
+    size_t nodesInside = 0;     // Subtrees accepted whole, their descendants skip the tests
+    size_t planeTests = 0;      // Plane tests of a whole SIMD group count once
+    double cullMs = 0.0;
+};
+
+// Tests world-space boxes against the view frustum, a SIMD group of boxes per plane at a time
+// (8 with AVX, 4 with SSE2, one by one otherwise).
+// Plane masks make the tests hierarchical: bit i is set while a box still crosses plane i. A box
+// fully inside a plane clears the bit, and its children are only tested against the planes left in
+// its mask; a mask of 0 accepts the whole subtree. Plane coherency: the caller keeps the plane that
+// last rejected a box of the group, and the next frame starts testing with it.
+class FrustumCuller {
+public:
+    static constexpr uint8_t allPlanes = 0x3f;
+    static constexpr uint8_t culled = 0x80;
+    static constexpr size_t maxGroupSize = 8;
+
+    void begin(const Frustum& frustum);
+
+    // Writes the plane mask of each box to masks, or culled when the box is outside. Empty boxes are
+    // always culled. cachedPlane is read as the first plane to test and updated with the last rejecting one.
+    void testBoxes(const BoundingBox* boxes, size_t count, uint8_t planeMask, uint8_t* masks, uint8_t& cachedPlane);
+
+    // Counters are updated by the hierarchy traversal through these
+    void addVisible(size_t count = 1) { stats.objectsVisible += count; }
+    void addCulled(size_t nodes, size_t objects) { stats.nodesCulled += nodes; stats.objectsCulled += objects; }
+    void addInside(size_t nodes) { stats.nodesInside += nodes; }
+
+    CullingStats& getStats() { return stats; }
+    const CullingStats& getStats() const { return stats; }
+
+private:
+    template <typename Simd>
+    void testGroup(const BoundingBox* boxes, size_t count, uint8_t planeMask, uint8_t* masks, uint8_t& cachedPlane);
+
+    // Planes as structure of arrays, one lane broadcast per plane
+    float normalX[6] = {};
+    float normalY[6] = {};
+    float normalZ[6] = {};
+    float distance[6] = {};
+    CullingStats stats;
+};
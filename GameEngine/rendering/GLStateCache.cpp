@@ -0,0 +1,193 @@
+#include "GLStateCache.h"
+#include <algorithm>
+#include <iostream>
+
+GLStateCache& GLStateCache::instance() {
+    static GLStateCache instance;
+    return instance;
+}
+
+void GLStateCache::initialize() {
+    if (initialized) {
+        return;
+    }
+
+    // Combined units cover every stage, so the shadow never indexes past what a shader can use
+    glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+    maxTextureUnits = std::max(maxTextureUnits, 1);
+    multiBind = GLEW_ARB_multi_bind != 0;
+    units.resize(static_cast<size_t>(maxTextureUnits));
+    initialized = true;
+
+    std::cout << "[GLStateCache] " << maxTextureUnits << " texture units, multi-bind " << (multiBind ? "available" : "unavailable") << std::endl;
+    invalidate();
+}
+
+void GLStateCache::invalidate() {
+    if (!initialized) {
+        initialize(); // Comes back here once the units are sized
+        return;
+    }
+
+    program = unknown;
+    vao = unknown;
+    activeUnit = unknown;
+    blendSource = blendDestination = 0;
+    blendEquationMode = 0;
+    depthFunction = 0;
+    for (Capability& capability : capabilities) {
+        capability.enabled = -1;
+    }
+    std::fill(units.begin(), units.end(), TextureUnit());
+}
+
+void GLStateCache::beginFrame() {
+    lastFrame = current;
+    current = GLStateStats();
+}
+
+bool GLStateCache::issue(bool changed) {
+    if (changed) {
+        ++current.issued;
+    }
+    else {
+        ++current.skipped;
+    }
+    return changed;
+}
+
+GLStateCache::Capability& GLStateCache::findCapability(GLenum capability) {
+    // A handful of capabilities are ever tracked, a linear scan beats hashing
+    for (Capability& entry : capabilities) {
+        if (entry.capability == capability) {
+            return entry;
+        }
+    }
+    capabilities.push_back(Capability{ capability, -1 });
+    return capabilities.back();
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (issue(this->program != program)) {
+        glUseProgram(program);
+        this->program = program;
+    }
+}
+
+void GLStateCache::bindVertexArray(GLuint vao) {
+    if (issue(this->vao != vao)) {
+        glBindVertexArray(vao);
+        this->vao = vao;
+    }
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled) {
+    Capability& entry = findCapability(capability);
+    if (issue(entry.enabled != static_cast<int8_t>(enabled))) {
+        if (enabled) {
+            glEnable(capability);
+        }
+        else {
+            glDisable(capability);
+        }
+        entry.enabled = static_cast<int8_t>(enabled);
+    }
+}
+
+void GLStateCache::blendFunc(GLenum source, GLenum destination) {
+    if (issue(blendSource != source || blendDestination != destination)) {
+        glBlendFunc(source, destination);
+        blendSource = source;
+        blendDestination = destination;
+    }
+}
+
+void GLStateCache::blendEquation(GLenum equation) {
+    if (issue(blendEquationMode != equation)) {
+        glBlendEquation(equation);
+        blendEquationMode = equation;
+    }
+}
+
+void GLStateCache::depthFunc(GLenum function) {
+    if (issue(depthFunction != function)) {
+        glDepthFunc(function);
+        depthFunction = function;
+    }
+}
+
+void GLStateCache::activeTexture(GLuint unit) {
+    if (issue(activeUnit != unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+}
+
+void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+    if (unit >= units.size()) {
+        std::cerr << "[GLStateCache] Texture unit " << unit << " exceeds the " << units.size() << " available" << std::endl;
+        return;
+    }
+
+    TextureUnit& slot = units[unit];
+    if (issue(slot.target != target || slot.texture != texture)) {
+        activeTexture(unit);
+        glBindTexture(target, texture);
+        slot.target = target;
+        slot.texture = texture;
+    }
+}
+
+void GLStateCache::bindTextures(GLuint first, GLsizei count, const GLenum* targets, const GLuint* textures) {
+    count = std::min<GLsizei>(count, static_cast<GLsizei>(units.size()) - static_cast<GLsizei>(std::min<size_t>(first, units.size())));
+    if (count <= 0) {
+        return;
+    }
+
+    // Narrow the call to the span of units that actually change
+    GLsizei begin = count;
+    GLsizei end = 0;
+    for (GLsizei i = 0; i < count; ++i) {
+        const TextureUnit& slot = units[first + i];
+        if (slot.target != targets[i] || slot.texture != textures[i]) {
+            begin = std::min(begin, i);
+            end = i + 1;
+        }
+    }
+
+    if (!issue(begin < end)) {
+        return;
+    }
+
+    if (multiBind) {
+        // glBindTextures takes the target from each texture object, the active unit is untouched
+        glBindTextures(first + begin, end - begin, textures + begin);
+    }
+    else {
+        GLuint previousUnit = activeUnit;
+        for (GLsizei i = begin; i < end; ++i) {
+            activeTexture(first + i);
+            glBindTexture(targets[i], textures[i]);
+        }
+        if (previousUnit != unknown) {
+            activeTexture(previousUnit);
+        }
+    }
+
+    for (GLsizei i = begin; i < end; ++i) {
+        units[first + i].target = targets[i];
+        units[first + i].texture = textures[i];
+    }
+}
+
+void GLStateCache::bindSampler(GLuint unit, GLuint sampler) {
+    if (unit >= units.size()) {
+        return;
+    }
+
+    TextureUnit& slot = units[unit];
+    if (issue(slot.sampler != sampler)) {
+        glBindSampler(unit, sampler);
+        slot.sampler = sampler;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct GLStateStats {
+    size_t issued = 0;   // State calls that reached the driver
+    size_t skipped = 0;  // State calls dropped because the state was already set
+};
+
+// Shadow copy of the GL state the scene draws touch. Calls that would set a value the context already
+// has are dropped, and texture units are bound with ARB_multi_bind where the driver supports it.
+// Code outside the cache (skybox, post-processing, uploads, ImGui) changes GL state directly, so the
+// shadow is only trusted between invalidate() and the end of a block of cached calls.
+class GLStateCache {
+public:
+    static GLStateCache& instance();
+
+    // Upper bound on the textures a single bindTextures() call is expected to carry
+    static constexpr GLsizei maxBatchedTextures = 32;
+
+    // Queries the limits and extensions once. Needs a current context.
+    void initialize();
+
+    // Forgets the shadow state, the next call of every kind is issued
+    void invalidate();
+
+    // Starts a new frame of counters; getStats() then reports the frame that just ended
+    void beginFrame();
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void setCapability(GLenum capability, bool enabled);
+    void blendFunc(GLenum source, GLenum destination);
+    void blendEquation(GLenum equation);
+    void depthFunc(GLenum function);
+
+    void activeTexture(GLuint unit);
+    void bindTexture(GLuint unit, GLenum target, GLuint texture);
+    // Binds textures[i] to unit first + i. Only the units that change are touched, in one
+    // glBindTextures call when available. Leaves the active texture unit as it was.
+    void bindTextures(GLuint first, GLsizei count, const GLenum* targets, const GLuint* textures);
+    void bindSampler(GLuint unit, GLuint sampler);
+
+    GLint getMaxTextureUnits() const { return maxTextureUnits; }
+    bool hasMultiBind() const { return multiBind; }
+    const GLStateStats& getStats() const { return lastFrame; }
+
+private:
+    GLStateCache() = default;
+    GLStateCache(const GLStateCache&) = delete;
+    GLStateCache& operator=(const GLStateCache&) = delete;
+
+    static constexpr GLuint unknown = ~0u;
+
+    struct TextureUnit {
+        GLenum target = 0;
+        GLuint texture = unknown;
+        GLuint sampler = unknown;
+    };
+
+    struct Capability {
+        GLenum capability;
+        int8_t enabled; // -1 while unknown
+    };
+
+    bool issue(bool changed);
+    Capability& findCapability(GLenum capability);
+
+    bool initialized = false;
+    GLint maxTextureUnits = 16;
+    bool multiBind = false;
+
+    GLuint program = unknown;
+    GLuint vao = unknown;
+    GLuint activeUnit = unknown;
+    GLenum blendSource = 0;
+    GLenum blendDestination = 0;
+    GLenum blendEquationMode = 0;
+    GLenum depthFunction = 0;
+    std::vector<Capability> capabilities;
+    std::vector<TextureUnit> units;
+
+    GLStateStats current;
+    GLStateStats lastFrame;
+};
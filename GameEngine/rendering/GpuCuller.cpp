@@ -0,0 +1,357 @@
+#include "GpuCuller.h"
+#include "FileSystemUtils.h"
+#include "rendering/GLStateCache.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+
+namespace {
+    constexpr GLuint cullGroupSize = 64; // local_size_x of gpu_cull.comp
+    constexpr GLuint hiZGroupSize = 8;   // local_size_x and local_size_y of hiz_downsample.comp
+    constexpr int counterCount = 4;
+
+    // Storage blocks of gpu_cull.comp
+    constexpr GLuint inputObjectsBinding = 0;
+    constexpr GLuint cullObjectsBinding = 1;
+    constexpr GLuint commandsBinding = 2;
+    constexpr GLuint visibleObjectsBinding = 3;
+    constexpr GLuint visibilityBinding = 4;
+    constexpr GLuint countersBinding = 5;
+
+    // Namespace scope, so the slots outlive the nodes still released during static destruction
+    std::mutex slotMutex;
+    std::vector<uint32_t> freeSlots;
+    uint32_t slotCount = 1; // Slot 0 is never handed out
+
+    uint32_t roundUp(uint32_t value, uint32_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    int nextPowerOfTwo(int value) {
+        int power = 1;
+        while (power < value) {
+            power *= 2;
+        }
+        return power;
+    }
+
+    // Grows a buffer the GPU writes to, keeping the first keepBytes of its contents
+    void reserve(GLuint& buffer, size_t& capacity, size_t bytes, size_t keepBytes) {
+        if (bytes <= capacity) {
+            return;
+        }
+
+        const size_t grownCapacity = std::max(bytes, capacity * 2);
+        GLuint grown = 0;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(grownCapacity), nullptr, GL_DYNAMIC_COPY);
+        if (buffer != 0) {
+            if (keepBytes > 0) {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(keepBytes));
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = grown;
+        capacity = grownCapacity;
+    }
+}
+
+GpuCuller::GpuCuller()
+    : uploads(GL_SHADER_STORAGE_BUFFER, 1024 * 1024, "GPU culling input") {}
+
+GpuCuller::~GpuCuller() {
+    if (hiZTexture != 0) {
+        glDeleteTextures(1, &hiZTexture);
+    }
+    for (GLuint* buffer : { &commandBuffer, &visibleObjectBuffer, &visibilityBuffer }) {
+        if (*buffer != 0) {
+            glDeleteBuffers(1, buffer);
+        }
+    }
+    for (int i = 0; i < GpuRingBuffer::framesInFlight; ++i) {
+        if (counterBuffers[i] != 0) {
+            glDeleteBuffers(1, &counterBuffers[i]);
+        }
+        if (counterFences[i]) {
+            glDeleteSync(counterFences[i]);
+        }
+    }
+}
+
+uint32_t GpuCuller::allocateVisibilitySlot() {
+    std::lock_guard<std::mutex> lock(slotMutex);
+    if (!freeSlots.empty()) {
+        // A reused slot may start out visible, the object is then drawn in phase 0 until phase 1 corrects it
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+    return slotCount++;
+}
+
+void GpuCuller::releaseVisibilitySlot(uint32_t slot) {
+    if (slot == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(slotMutex);
+    freeSlots.push_back(slot);
+}
+
+void GpuCuller::setDepthSource(GLuint depthTexture, int width, int height) {
+    this->depthTexture = depthTexture;
+    depthWidth = width;
+    depthHeight = height;
+}
+
+bool GpuCuller::isAvailable() {
+    if (!programsLoaded) {
+        loadPrograms();
+    }
+    return cullProgram && hiZProgram && depthTexture != 0 && depthWidth > 0 && depthHeight > 0;
+}
+
+void GpuCuller::loadPrograms() {
+    programsLoaded = true;
+    if (!GLEW_VERSION_4_3) {
+        std::cerr << "[GpuCuller] Compute shaders are not supported, batches are drawn without GPU culling" << std::endl;
+        return;
+    }
+
+    cullProgram = Shader::createCompute(FileSystemUtils::getAssetFilePath("shaders/gpu_cull.comp"));
+    hiZProgram = Shader::createCompute(FileSystemUtils::getAssetFilePath("shaders/hiz_downsample.comp"));
+    if (!cullProgram || !hiZProgram) {
+        std::cerr << "[GpuCuller] Failed to build the culling programs, batches are drawn without GPU culling" << std::endl;
+        cullProgram.reset();
+        hiZProgram.reset();
+        return;
+    }
+
+    cullUniforms.viewProjection = cullProgram->getUniform<glm::mat4>("viewProjection");
+    cullUniforms.objectCount = cullProgram->getUniform<int>("objectCount");
+    cullUniforms.phase = cullProgram->getUniform<int>("phase");
+    cullUniforms.commandOffset = cullProgram->getUniform<int>("commandOffset");
+    cullUniforms.outputOffset = cullProgram->getUniform<int>("outputOffset");
+    cullUniforms.hiZLevels = cullProgram->getUniform<int>("hiZLevels");
+    cullUniforms.hiZSize = cullProgram->getUniform<glm::vec2>("hiZSize");
+    sourceLevel = hiZProgram->getUniform<int>("sourceLevel");
+}
+
+void GpuCuller::beginFrame(size_t storageAlignment) {
+    this->storageAlignment = storageAlignment;
+    // Batches are bound at multiples of the storage alignment, which ObjectData need not divide
+    objectAlignment = static_cast<uint32_t>(storageAlignment / std::gcd(storageAlignment, sizeof(ObjectData)));
+
+    objects.clear();
+    cullObjects.clear();
+    commands.clear();
+    outputCount = 0;
+    batchOutput = 0;
+    dispatched = false;
+
+    frame = (frame + 1) % GpuRingBuffer::framesInFlight;
+    readCounters();
+    uploads.beginFrame();
+}
+
+uint32_t GpuCuller::beginBatch() {
+    outputCount = roundUp(outputCount, objectAlignment);
+    batchOutput = outputCount;
+    return batchOutput;
+}
+
+void GpuCuller::addCommand(const DrawElementsIndirectCommand& command) {
+    commands.push_back(command);
+    commands.back().instanceCount = 0;
+}
+
+void GpuCuller::addObject(const ObjectData& object, const BoundingBox& bounds) {
+    GpuCullObject cull;
+    cull.boundsMin = glm::vec4(bounds.min, 1.0f);
+    cull.boundsMax = glm::vec4(bounds.max, 1.0f);
+    cull.object = static_cast<uint32_t>(objects.size());
+    cull.command = static_cast<uint32_t>(commands.size() - 1);
+    cull.outputBase = batchOutput + commands.back().baseInstance;
+    cullObjects.push_back(cull);
+    objects.push_back(object);
+    ++outputCount;
+}
+
+void GpuCuller::cullLastVisible() {
+    stats.objects = objects.size();
+    stats.commands = commands.size();
+    if (commands.empty()) {
+        return;
+    }
+
+    // Phase 1 writes its objects after those of phase 0, starting on an aligned slot as well
+    outputCount = roundUp(outputCount, objectAlignment);
+    createHiZ();
+    reserveBuffers();
+
+    // All three uploads must land in one buffer, the offsets are bound against it until the frame ends
+    const size_t commandsSize = commands.size() * sizeof(DrawElementsIndirectCommand);
+    uploads.reserve(objects.size() * sizeof(ObjectData) + cullObjects.size() * sizeof(GpuCullObject) + commandsSize + 3 * storageAlignment);
+    objectsOffset = uploads.write(objects.data(), objects.size() * sizeof(ObjectData), storageAlignment);
+    cullObjectsOffset = uploads.write(cullObjects.data(), cullObjects.size() * sizeof(GpuCullObject), storageAlignment);
+
+    // Both phases start from the commands with no instances
+    const size_t commandsOffset = uploads.write(commands.data(), commandsSize, sizeof(GLuint));
+    glBindBuffer(GL_COPY_READ_BUFFER, uploads.getBuffer());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(commandsOffset), 0,
+        static_cast<GLsizeiptr>(commandsSize));
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(commandsOffset),
+        static_cast<GLintptr>(commandsSize), static_cast<GLsizeiptr>(commandsSize));
+
+    dispatched = true;
+    dispatch(Phase::LastVisible);
+}
+
+void GpuCuller::cullDisoccluded() {
+    if (!dispatched) {
+        return;
+    }
+    buildHiZ();
+    dispatch(Phase::Disoccluded);
+}
+
+GLintptr GpuCuller::bindBatch(Phase phase, uint32_t firstCommand, uint32_t firstObject, uint32_t objectCount) {
+    const size_t phaseIndex = phase == Phase::Disoccluded ? 1 : 0;
+    const size_t objectOffset = (phaseIndex * outputCount + firstObject) * sizeof(ObjectData);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, RenderQueue::objectBindingPoint, visibleObjectBuffer,
+        static_cast<GLintptr>(objectOffset), static_cast<GLsizeiptr>(objectCount * sizeof(ObjectData)));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    return static_cast<GLintptr>((phaseIndex * commands.size() + firstCommand) * sizeof(DrawElementsIndirectCommand));
+}
+
+void GpuCuller::endFrame() {
+    if (dispatched) {
+        counterFences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    uploads.endFrame();
+}
+
+void GpuCuller::createHiZ() {
+    // Level 0 halves the depth buffer rounded up to a power of two, so every level halves the one above
+    const int width = std::max(nextPowerOfTwo(depthWidth) / 2, 1);
+    const int height = std::max(nextPowerOfTwo(depthHeight) / 2, 1);
+    if (hiZTexture != 0 && width == hiZWidth && height == hiZHeight) {
+        return;
+    }
+
+    if (hiZTexture != 0) {
+        glDeleteTextures(1, &hiZTexture);
+    }
+    hiZWidth = width;
+    hiZHeight = height;
+    hiZLevels = 1 + static_cast<int>(std::log2(static_cast<float>(std::max(width, height))));
+    stats.hiZLevels = hiZLevels;
+
+    glGenTextures(1, &hiZTexture);
+    GLStateCache::instance().bindTexture(0, GL_TEXTURE_2D, hiZTexture);
+    glTexStorage2D(GL_TEXTURE_2D, hiZLevels, GL_R32F, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+void GpuCuller::buildHiZ() {
+    GLStateCache& glState = GLStateCache::instance();
+    glState.useProgram(hiZProgram->Program);
+
+    // Each level reads the one above it, the first reads the depth buffer
+    for (int level = 0; level < hiZLevels; ++level) {
+        glState.bindTexture(0, GL_TEXTURE_2D, level == 0 ? depthTexture : hiZTexture);
+        hiZProgram->set(sourceLevel, level == 0 ? 0 : level - 1);
+        glBindImageTexture(0, hiZTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+        const GLuint width = static_cast<GLuint>(std::max(hiZWidth >> level, 1));
+        const GLuint height = static_cast<GLuint>(std::max(hiZHeight >> level, 1));
+        glDispatchCompute((width + hiZGroupSize - 1) / hiZGroupSize, (height + hiZGroupSize - 1) / hiZGroupSize, 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+}
+
+void GpuCuller::dispatch(Phase phase) {
+    const bool disoccluded = phase == Phase::Disoccluded;
+    GLStateCache& glState = GLStateCache::instance();
+    glState.useProgram(cullProgram->Program);
+    cullProgram->set(cullUniforms.viewProjection, viewProjection);
+    cullProgram->set(cullUniforms.objectCount, static_cast<int>(objects.size()));
+    cullProgram->set(cullUniforms.phase, disoccluded ? 1 : 0);
+    cullProgram->set(cullUniforms.commandOffset, disoccluded ? static_cast<int>(commands.size()) : 0);
+    cullProgram->set(cullUniforms.outputOffset, disoccluded ? static_cast<int>(outputCount) : 0);
+    cullProgram->set(cullUniforms.hiZLevels, hiZLevels);
+    cullProgram->set(cullUniforms.hiZSize, glm::vec2(static_cast<float>(hiZWidth), static_cast<float>(hiZHeight)));
+    glState.bindTexture(0, GL_TEXTURE_2D, hiZTexture);
+
+    // The draws rebind the blocks that share these binding points before using them
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, inputObjectsBinding, uploads.getBuffer(),
+        static_cast<GLintptr>(objectsOffset), static_cast<GLsizeiptr>(objects.size() * sizeof(ObjectData)));
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, cullObjectsBinding, uploads.getBuffer(),
+        static_cast<GLintptr>(cullObjectsOffset), static_cast<GLsizeiptr>(cullObjects.size() * sizeof(GpuCullObject)));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, commandsBinding, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, visibleObjectsBinding, visibleObjectBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, visibilityBinding, visibilityBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, countersBinding, counterBuffers[frame]);
+
+    const GLuint groups = static_cast<GLuint>((objects.size() + cullGroupSize - 1) / cullGroupSize);
+    glDispatchCompute(groups, 1, 1);
+    // The commands are read by the indirect draws, the visible objects by their vertex shaders
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCuller::reserveBuffers() {
+    reserve(commandBuffer, commandCapacity, 2 * commands.size() * sizeof(DrawElementsIndirectCommand), 0);
+    reserve(visibleObjectBuffer, visibleObjectCapacity, 2 * size_t(outputCount) * sizeof(ObjectData), 0);
+
+    // Visibility outlives the frame: keep it when growing and start new slots as not visible
+    uint32_t slots;
+    {
+        std::lock_guard<std::mutex> lock(slotMutex);
+        slots = slotCount;
+    }
+    const size_t keptBytes = visibilityCapacity;
+    reserve(visibilityBuffer, visibilityCapacity, slots * sizeof(uint32_t), keptBytes);
+    if (visibilityCapacity > keptBytes) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, visibilityBuffer);
+        glClearBufferSubData(GL_COPY_WRITE_BUFFER, GL_R32UI, static_cast<GLintptr>(keptBytes),
+            static_cast<GLsizeiptr>(visibilityCapacity - keptBytes), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+
+    if (counterBuffers[frame] == 0) {
+        glGenBuffers(1, &counterBuffers[frame]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, counterBuffers[frame]);
+        glBufferData(GL_COPY_WRITE_BUFFER, counterCount * sizeof(GLuint), nullptr, GL_DYNAMIC_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, counterBuffers[frame]);
+    glClearBufferData(GL_COPY_WRITE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+void GpuCuller::readCounters() {
+    GLsync& fence = counterFences[frame];
+    if (!fence) {
+        return;
+    }
+
+    // Never waits: a frame the GPU has not finished yet is skipped and its counters reused
+    const GLenum status = glClientWaitSync(fence, 0, 0);
+    glDeleteSync(fence);
+    fence = nullptr;
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        return;
+    }
+
+    GLuint counters[counterCount] = {};
+    glBindBuffer(GL_COPY_READ_BUFFER, counterBuffers[frame]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(counters), counters);
+    stats.drawnLastVisible = counters[0];
+    stats.drawnDisoccluded = counters[1];
+    stats.occluded = counters[2];
+    stats.outsideFrustum = counters[3];
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "shader.h"
+#include "rendering/BoundingBox.h"
+#include "rendering/GpuRingBuffer.h"
+#include "rendering/RenderQueue.h"
+
+struct GpuCullingStats {
+    size_t objects = 0;  // Instances of the culled batches this frame
+    size_t commands = 0; // Indirect commands per phase
+    // Counted on the GPU, read back once the frame's fence has passed, a few frames late
+    size_t drawnLastVisible = 0;
+    size_t drawnDisoccluded = 0;
+    size_t occluded = 0;
+    size_t outsideFrustum = 0;
+    int hiZLevels = 0;
+};
+
+// Instance of a culled batch as read by gpu_cull.comp
+struct GpuCullObject {
+    glm::vec4 boundsMin; // Model space
+    glm::vec4 boundsMax;
+    uint32_t object;     // Index in the frame's objects
+    uint32_t command;    // Index in the frame's commands
+    uint32_t outputBase; // Output slot of the command's first instance
+    uint32_t _padding = 0;
+};
+static_assert(sizeof(GpuCullObject) == 48, "GpuCullObject must match the std430 layout of the cull shader");
+
+// Culls the instances of the opaque multi-draw batches on the GPU, in two phases per frame.
+// The render queue hands over every batch as indirect commands with no instances and the objects
+// they may draw. Phase 0 appends the objects visible last frame and inside the frustum to their
+// commands, the queue draws them, and a Hi-Z pyramid (farthest depth per texel) is built from the
+// depth written so far. Phase 1 then tests every object against the frustum and the pyramid, keeps
+// the result in the object's visibility slot for the next frame, and appends the visible objects
+// phase 0 skipped, which the queue draws before the transparent pass. Objects that come into view
+// are therefore drawn the same frame and nothing pops in.
+// Visible objects are compacted into their own ObjectData array, so the instanced shaders read them
+// through the ObjectBuffer block unchanged.
+class GpuCuller {
+public:
+    enum class Phase { LastVisible = 0, Disoccluded = 1 };
+
+    GpuCuller();
+    ~GpuCuller();
+
+    GpuCuller(const GpuCuller&) = delete;
+    GpuCuller& operator=(const GpuCuller&) = delete;
+
+    // Visibility slots carry an object's test result from one frame to the next, see
+    // ObjectData::visibilitySlot. Safe from any thread; slot 0 is never handed out.
+    static uint32_t allocateVisibilitySlot();
+    static void releaseVisibilitySlot(uint32_t slot);
+
+    // Depth attachment of the scene framebuffer, sampled to build the Hi-Z pyramid
+    void setDepthSource(GLuint depthTexture, int width, int height);
+    void setViewProjection(const glm::mat4& viewProjection) { this->viewProjection = viewProjection; }
+
+    // Loads the compute programs on first use. False without compute shaders or a depth source.
+    bool isAvailable();
+
+    void beginFrame(size_t storageAlignment);
+    // Starts a batch and returns its first output slot. Its objects are bound as one ObjectBuffer range.
+    uint32_t beginBatch();
+    // A command of the current batch, its baseInstance relative to the batch
+    void addCommand(const DrawElementsIndirectCommand& command);
+    // An object drawn by the last command added
+    void addObject(const ObjectData& object, const BoundingBox& bounds);
+    uint32_t getCommandCount() const { return static_cast<uint32_t>(commands.size()); }
+    uint32_t getObjectCount() const { return static_cast<uint32_t>(objects.size()); }
+
+    // Uploads the frame's batches and fills the phase 0 commands
+    void cullLastVisible();
+    // Builds the Hi-Z pyramid from the depth drawn so far and fills the phase 1 commands
+    void cullDisoccluded();
+    // Binds the objects of a batch that passed the phase to the ObjectBuffer, and the phase's
+    // commands to GL_DRAW_INDIRECT_BUFFER. Returns the offset of the batch's first command.
+    GLintptr bindBatch(Phase phase, uint32_t firstCommand, uint32_t firstObject, uint32_t objectCount);
+    void endFrame();
+
+    const GpuCullingStats& getStats() const { return stats; }
+
+private:
+    void loadPrograms();
+    void createHiZ();
+    void buildHiZ();
+    void dispatch(Phase phase);
+    void reserveBuffers();
+    void readCounters();
+
+    struct CullUniforms {
+        Uniform<glm::mat4> viewProjection;
+        Uniform<int> objectCount;
+        Uniform<int> phase;
+        Uniform<int> commandOffset;
+        Uniform<int> outputOffset;
+        Uniform<int> hiZLevels;
+        Uniform<glm::vec2> hiZSize;
+    };
+
+    std::unique_ptr<Shader> cullProgram;
+    std::unique_ptr<Shader> hiZProgram;
+    CullUniforms cullUniforms;
+    Uniform<int> sourceLevel;
+    bool programsLoaded = false;
+
+    GLuint depthTexture = 0;
+    int depthWidth = 0;
+    int depthHeight = 0;
+    GLuint hiZTexture = 0;
+    int hiZWidth = 0;
+    int hiZHeight = 0;
+    int hiZLevels = 0;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+
+    // The frame's batches as built on the CPU
+    std::vector<ObjectData> objects;
+    std::vector<GpuCullObject> cullObjects;
+    std::vector<DrawElementsIndirectCommand> commands;
+    uint32_t outputCount = 0;  // Output slots of one phase, batches start on aligned slots
+    uint32_t batchOutput = 0;  // First output slot of the current batch
+    size_t storageAlignment = 16;
+    uint32_t objectAlignment = 1; // Output slots per storage alignment step
+
+    GpuRingBuffer uploads;
+    size_t objectsOffset = 0;
+    size_t cullObjectsOffset = 0;
+    bool dispatched = false;
+
+    // Written by the compute shader, both phases side by side
+    GLuint commandBuffer = 0;
+    size_t commandCapacity = 0;
+    GLuint visibleObjectBuffer = 0;
+    size_t visibleObjectCapacity = 0;
+    GLuint visibilityBuffer = 0;
+    size_t visibilityCapacity = 0;
+    GLuint counterBuffers[GpuRingBuffer::framesInFlight] = {};
+    GLsync counterFences[GpuRingBuffer::framesInFlight] = {};
+    int frame = 0;
+
+    GpuCullingStats stats;
+};
@@ -0,0 +1,164 @@
+#include "GpuRingBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+GpuRingBuffer::GpuRingBuffer(GLenum target, size_t bytesPerFrame, const char* name)
+    : target(target), name(name), bytesPerFrame(bytesPerFrame) {}
+
+GpuRingBuffer::~GpuRingBuffer() {
+    destroy();
+}
+
+void GpuRingBuffer::create(size_t size) {
+    bytesPerFrame = size;
+    const GLsizeiptr capacity = static_cast<GLsizeiptr>(bytesPerFrame * framesInFlight);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    if (GLEW_ARB_buffer_storage) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, capacity, nullptr, flags);
+        mapped = static_cast<unsigned char*>(glMapBufferRange(target, 0, capacity, flags));
+        if (!mapped) {
+            std::cerr << "[GpuRingBuffer] Failed to map the " << name << " buffer, writing through glBufferSubData" << std::endl;
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+        }
+    }
+    if (!mapped) {
+        glBufferData(target, capacity, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(target, 0);
+}
+
+void GpuRingBuffer::grow(size_t size) {
+    // Ranges handed out this frame still point into the old buffer, draws may not even be issued yet
+    if (mapped) {
+        glBindBuffer(target, buffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+        mapped = nullptr;
+    }
+    retired.push_back(RetiredBuffer{ buffer, nullptr });
+    buffer = 0;
+
+    // The fences guard regions of the old buffer, the regions of the new one have never been read
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    create(size);
+    head = 0;
+}
+
+void GpuRingBuffer::releaseRetired(bool wait) {
+    for (size_t i = 0; i < retired.size();) {
+        RetiredBuffer& old = retired[i];
+        if (!wait) {
+            // Without a fence the buffer is still used by the frame being recorded
+            const GLenum result = old.fence ? glClientWaitSync(old.fence, 0, 0) : GL_TIMEOUT_EXPIRED;
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+                ++i;
+                continue;
+            }
+        }
+        if (old.fence) {
+            glDeleteSync(old.fence);
+        }
+        glDeleteBuffers(1, &old.buffer);
+        retired.erase(retired.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+}
+
+void GpuRingBuffer::destroy() {
+    // Draws still in flight keep the storage of deleted buffers alive until they complete
+    releaseRetired(true);
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (buffer) {
+        if (mapped) {
+            glBindBuffer(target, buffer);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+            mapped = nullptr;
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+}
+
+void GpuRingBuffer::beginFrame() {
+    if (!initialized) {
+        create(bytesPerFrame);
+        initialized = true;
+    }
+
+    releaseRetired(false);
+    frame = (frame + 1) % framesInFlight;
+    head = 0;
+
+    GLsync& fence = fences[frame];
+    if (fence) {
+        // Normally signalled long ago, the CPU only waits when it runs frames ahead of the GPU
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void GpuRingBuffer::endFrame() {
+    for (RetiredBuffer& old : retired) {
+        if (!old.fence) {
+            old.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+    if (!initialized || head == 0) {
+        return;
+    }
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void GpuRingBuffer::reserve(size_t size) {
+    if (!initialized) {
+        beginFrame();
+    }
+    if (head + size > bytesPerFrame) {
+        grow(std::max(bytesPerFrame * 2, size * 2));
+    }
+}
+
+size_t GpuRingBuffer::write(const void* data, size_t size, size_t alignment) {
+    if (!initialized) {
+        beginFrame();
+    }
+
+    size_t offset = (head + alignment - 1) & ~(alignment - 1);
+    if (offset + size > bytesPerFrame) {
+        grow(std::max(bytesPerFrame * 2, size * 2));
+        offset = 0;
+    }
+
+    const size_t bufferOffset = static_cast<size_t>(frame) * bytesPerFrame + offset;
+    if (mapped) {
+        std::memcpy(mapped + bufferOffset, data, size);
+    }
+    else {
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, static_cast<GLintptr>(bufferOffset), static_cast<GLsizeiptr>(size), data);
+        glBindBuffer(target, 0);
+    }
+
+    head = offset + size;
+    return bufferOffset;
+}
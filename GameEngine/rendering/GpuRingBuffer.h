@@ -0,0 +1,62 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// Per-frame streaming buffer for data the GPU reads once per draw. The buffer is split into one
+// region per frame in flight; each frame appends into its region and a fence placed at the end of
+// the frame guards the region until the GPU has consumed it. With ARB_buffer_storage the buffer is
+// persistently mapped and writes are plain copies, otherwise they go through glBufferSubData.
+// A region that runs out of space moves to a larger buffer allocated beside the current one. The
+// old buffer keeps the ranges already handed out and is deleted once the GPU is done with the frame.
+class GpuRingBuffer {
+public:
+    static constexpr int framesInFlight = 3;
+
+    GpuRingBuffer(GLenum target, size_t bytesPerFrame, const char* name);
+    ~GpuRingBuffer();
+
+    GpuRingBuffer(const GpuRingBuffer&) = delete;
+    GpuRingBuffer& operator=(const GpuRingBuffer&) = delete;
+
+    // Moves to the next region, waiting for the GPU if it still reads from it
+    void beginFrame();
+    // Fences the region written this frame
+    void endFrame();
+
+    // Makes room for size more bytes, alignment padding included, in the current region, so the
+    // writes that follow land in the same buffer. Callers that know their size up front reserve it.
+    void reserve(size_t size);
+    // Copies size bytes into the current region and returns their offset in getBuffer() as it is
+    // right after the call. alignment must be a power of two.
+    size_t write(const void* data, size_t size, size_t alignment);
+
+    GLuint getBuffer() const { return buffer; }
+    size_t getBytesPerFrame() const { return bytesPerFrame; }
+    size_t getBytesThisFrame() const { return head; }
+    bool isPersistent() const { return mapped != nullptr; }
+
+private:
+    void create(size_t bytesPerFrame);
+    void grow(size_t bytesPerFrame);
+    void releaseRetired(bool wait);
+    void destroy();
+
+    // A buffer replaced by a larger one, alive until the fence of the frame that last used it passes
+    struct RetiredBuffer {
+        GLuint buffer;
+        GLsync fence;
+    };
+
+    GLenum target;
+    const char* name;
+    GLuint buffer = 0;
+    unsigned char* mapped = nullptr;
+    size_t bytesPerFrame = 0;
+    size_t head = 0;
+    int frame = 0;
+    bool initialized = false;
+    GLsync fences[framesInFlight] = {};
+    std::vector<RetiredBuffer> retired;
+};
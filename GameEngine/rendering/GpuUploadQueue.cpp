@@ -0,0 +1,330 @@
+#include "GpuUploadQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace {
+    constexpr size_t stagingAlignment = 16;
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    size_t bytesPerPixel(GLenum format) {
+        switch (format) {
+        case GL_RED: return 1;
+        case GL_RG: return 2;
+        case GL_RGB: return 3;
+        default: return 4;
+        }
+    }
+}
+
+GpuUploadQueue& GpuUploadQueue::instance() {
+    static GpuUploadQueue instance;
+    return instance;
+}
+
+void GpuUploadQueue::shutdown() {
+    requests.clear();
+    stats.pendingBytes = 0;
+
+    for (auto& segment : stagingSegments) {
+        glDeleteSync(segment.fence);
+    }
+    stagingSegments.clear();
+    if (stagingBuffer) {
+        glDeleteBuffers(1, &stagingBuffer);
+        stagingBuffer = 0;
+    }
+    stagingPointer = nullptr;
+}
+
+void GpuUploadQueue::setBudget(double msPerFrame, size_t bytesPerFrame) {
+    budgetMs = msPerFrame;
+    budgetBytes = std::max<size_t>(bytesPerFrame, 1);
+}
+
+void GpuUploadQueue::uploadBuffer(GLuint buffer, size_t offset, const void* data, size_t size,
+    const std::shared_ptr<UploadTicket>& ticket, std::shared_ptr<const void> keepAlive) {
+    if (size == 0 || !data) {
+        return;
+    }
+
+    UploadRequest request;
+    request.object = buffer;
+    request.offset = offset;
+    request.data = static_cast<const unsigned char*>(data);
+    request.size = size;
+    request.ticket = ticket;
+    request.keepAlive = std::move(keepAlive);
+
+    if (ticket) {
+        ++ticket->pendingUploads;
+    }
+    stats.pendingBytes += size;
+    requests.push_back(std::move(request));
+}
+
+void GpuUploadQueue::uploadTexture(GLuint texture, GLenum bindTarget, GLenum imageTarget, GLsizei width, GLsizei height,
+    GLenum format, const void* pixels, const std::shared_ptr<UploadTicket>& ticket,
+    std::shared_ptr<const void> keepAlive, bool generateMipmaps) {
+    if (!pixels || width <= 0 || height <= 0) {
+        return;
+    }
+
+    UploadRequest request;
+    request.isTexture = true;
+    request.object = texture;
+    request.bindTarget = bindTarget;
+    request.imageTarget = imageTarget;
+    request.format = format;
+    request.width = width;
+    request.height = height;
+    request.rowBytes = static_cast<size_t>(width) * bytesPerPixel(format);
+    request.data = static_cast<const unsigned char*>(pixels);
+    request.size = request.rowBytes * static_cast<size_t>(height);
+    request.generateMipmaps = generateMipmaps;
+    request.ticket = ticket;
+    request.keepAlive = std::move(keepAlive);
+
+    if (ticket) {
+        ++ticket->pendingUploads;
+    }
+    stats.pendingBytes += request.size;
+    requests.push_back(std::move(request));
+}
+
+void GpuUploadQueue::processFrame() {
+    process(false);
+}
+
+void GpuUploadQueue::flush() {
+    process(true);
+}
+
+void GpuUploadQueue::initializeStaging() {
+    stagingInitialized = true;
+
+    if (!GLEW_ARB_buffer_storage) {
+        std::cout << "[GpuUploadQueue] ARB_buffer_storage not available, uploading from client memory" << std::endl;
+        return;
+    }
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &stagingBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+    glBufferStorage(GL_COPY_READ_BUFFER, stagingCapacity, nullptr, flags);
+    stagingPointer = static_cast<unsigned char*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, stagingCapacity, flags));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    if (!stagingPointer) {
+        std::cerr << "[GpuUploadQueue] Failed to map the staging buffer, uploading from client memory" << std::endl;
+        glDeleteBuffers(1, &stagingBuffer);
+        stagingBuffer = 0;
+        return;
+    }
+
+    stats.persistentStaging = true;
+    stats.stagingCapacity = stagingCapacity;
+}
+
+void GpuUploadQueue::reclaimStaging() {
+    while (!stagingSegments.empty()) {
+        StagingSegment& segment = stagingSegments.front();
+        GLenum result = glClientWaitSync(segment.fence, 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(segment.fence);
+        stagingTail = segment.end;
+        stagingSegments.pop_front();
+    }
+
+    if (stagingSegments.empty() && !stagedThisFrame) {
+        stagingHead = 0;
+        stagingTail = 0;
+    }
+}
+
+bool GpuUploadQueue::allocateStaging(size_t size, size_t& offset) {
+    bool inFlight = !stagingSegments.empty() || stagedThisFrame;
+    size_t head = alignUp(stagingHead, stagingAlignment);
+
+    if (!inFlight) {
+        if (size > stagingCapacity) {
+            return false;
+        }
+        offset = 0;
+    }
+    else if (stagingHead > stagingTail) {
+        // Free space is [head, capacity) followed by [0, tail)
+        if (head + size <= stagingCapacity) {
+            offset = head;
+        }
+        else if (size <= stagingTail) {
+            offset = 0;
+        }
+        else {
+            return false;
+        }
+    }
+    else if (stagingHead < stagingTail) {
+        if (head + size > stagingTail) {
+            return false;
+        }
+        offset = head;
+    }
+    else {
+        // Head caught up with the tail, the whole ring is in flight
+        return false;
+    }
+
+    stagingHead = offset + size;
+    stagedThisFrame = true;
+    return true;
+}
+
+bool GpuUploadQueue::issueChunk(UploadRequest& request, size_t maxBytes) {
+    size_t remaining = request.size - request.uploaded;
+    size_t chunk = std::min(remaining, maxBytes);
+    if (stagingPointer) {
+        chunk = std::min(chunk, stagingCapacity / 4);
+    }
+
+    GLint firstRow = 0;
+    GLsizei rowCount = 0;
+    if (request.isTexture) {
+        // Textures go up in whole rows
+        firstRow = static_cast<GLint>(request.uploaded / request.rowBytes);
+        rowCount = static_cast<GLsizei>(std::max<size_t>(chunk / request.rowBytes, 1));
+        rowCount = std::min(rowCount, request.height - firstRow);
+        chunk = static_cast<size_t>(rowCount) * request.rowBytes;
+    }
+
+    const unsigned char* source = request.data + request.uploaded;
+    const void* pixelSource = source;
+
+    if (stagingPointer) {
+        size_t stagingOffset = 0;
+        if (!allocateStaging(chunk, stagingOffset)) {
+            return false;
+        }
+        std::memcpy(stagingPointer + stagingOffset, source, chunk);
+
+        if (request.isTexture) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+            pixelSource = reinterpret_cast<const void*>(stagingOffset);
+        }
+        else {
+            glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, request.object);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, stagingOffset, request.offset + request.uploaded, chunk);
+        }
+    }
+    else if (!request.isTexture) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, request.object);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, request.offset + request.uploaded, chunk, source);
+    }
+
+    if (request.isTexture) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(request.bindTarget, request.object);
+        glTexSubImage2D(request.imageTarget, 0, 0, firstRow, request.width, rowCount, request.format, GL_UNSIGNED_BYTE, pixelSource);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    request.uploaded += chunk;
+    stats.bytesLastFrame += chunk;
+    stats.pendingBytes -= chunk;
+    return true;
+}
+
+void GpuUploadQueue::completeRequest(UploadRequest& request) {
+    if (request.isTexture && request.generateMipmaps && !(request.ticket && request.ticket->isCancelled())) {
+        glBindTexture(request.bindTarget, request.object);
+        glGenerateMipmap(request.bindTarget);
+    }
+
+    if (request.ticket) {
+        --request.ticket->pendingUploads;
+    }
+    ++stats.uploadsLastFrame;
+}
+
+void GpuUploadQueue::process(bool ignoreBudget) {
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+
+    if (!stagingInitialized) {
+        initializeStaging();
+    }
+    if (stagingPointer) {
+        reclaimStaging();
+    }
+
+    stats.bytesLastFrame = 0;
+    stats.uploadsLastFrame = 0;
+    stagedThisFrame = false;
+
+    while (!requests.empty()) {
+        UploadRequest& request = requests.front();
+
+        if (request.ticket && request.ticket->isCancelled()) {
+            stats.pendingBytes -= request.size - request.uploaded;
+            --request.ticket->pendingUploads;
+            requests.pop_front();
+            continue;
+        }
+
+        double elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (!ignoreBudget && (elapsedMs >= budgetMs || stats.bytesLastFrame >= budgetBytes)) {
+            break;
+        }
+
+        size_t maxBytes = ignoreBudget ? request.size : budgetBytes - stats.bytesLastFrame;
+        if (!issueChunk(request, maxBytes)) {
+            if (!ignoreBudget) {
+                // Staging ring is full until the GPU catches up
+                break;
+            }
+
+            // Wait for the oldest staged copies to retire, then try again
+            if (!stagingSegments.empty()) {
+                glClientWaitSync(stagingSegments.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+            }
+            else if (stagedThisFrame) {
+                glFinish();
+                stagedThisFrame = false;
+            }
+            reclaimStaging();
+            continue;
+        }
+
+        if (request.uploaded == request.size) {
+            completeRequest(request);
+            requests.pop_front();
+        }
+    }
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if (stagedThisFrame) {
+        stagingSegments.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), stagingHead });
+        stagedThisFrame = false;
+    }
+
+    stats.msLastFrame = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    stats.peakMs = std::max(stats.peakMs, stats.msLastFrame);
+    stats.totalBytes += stats.bytesLastFrame;
+    stats.queueDepth = requests.size();
+
+    size_t inFlight = 0;
+    if (!stagingSegments.empty()) {
+        inFlight = stagingHead >= stagingTail ? stagingHead - stagingTail : stagingCapacity - stagingTail + stagingHead;
+    }
+    stats.stagingInFlight = inFlight;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+// Tracks the uploads that belong to one resource. Complete once every queued upload has been issued.
+class UploadTicket {
+public:
+    bool isComplete() const { return pendingUploads == 0; }
+
+    // The resource is going away, skip anything still queued for it
+    void cancel() { cancelled = true; }
+    bool isCancelled() const { return cancelled; }
+
+private:
+    friend class GpuUploadQueue;
+
+    size_t pendingUploads = 0;
+    bool cancelled = false;
+};
+
+struct GpuUploadStats {
+    size_t queueDepth = 0;
+    size_t pendingBytes = 0;
+    size_t uploadsLastFrame = 0;
+    size_t bytesLastFrame = 0;
+    double msLastFrame = 0.0;
+    double peakMs = 0.0;
+    uint64_t totalBytes = 0;
+    size_t stagingCapacity = 0;
+    size_t stagingInFlight = 0;
+    bool persistentStaging = false;
+};
+
+// Spreads buffer and texture uploads across frames. processFrame() issues queued uploads until the
+// per-frame time or byte budget is used up, splitting large uploads into chunks. When
+// ARB_buffer_storage is available data goes through a persistently mapped staging ring, copied
+// with glCopyBufferSubData or read as a pixel unpack buffer, and fences guard ring reuse.
+// Otherwise the chunks are submitted straight from client memory.
+// Source pointers must stay valid until the ticket completes or is cancelled.
+class GpuUploadQueue {
+public:
+    static GpuUploadQueue& instance();
+
+    // Runs after the GL context is gone, staging not deleted by shutdown() is leaked to it
+    ~GpuUploadQueue() = default;
+
+    void setBudget(double msPerFrame, size_t bytesPerFrame);
+
+    // The destination buffer must already have storage for offset + size bytes
+    void uploadBuffer(GLuint buffer, size_t offset, const void* data, size_t size,
+        const std::shared_ptr<UploadTicket>& ticket, std::shared_ptr<const void> keepAlive = nullptr);
+
+    // Uploads a tightly packed GL_UNSIGNED_BYTE image into texture storage that already exists.
+    // imageTarget is the face for cubemaps; mipmaps are generated once the last row has been issued.
+    void uploadTexture(GLuint texture, GLenum bindTarget, GLenum imageTarget, GLsizei width, GLsizei height,
+        GLenum format, const void* pixels, const std::shared_ptr<UploadTicket>& ticket,
+        std::shared_ptr<const void> keepAlive = nullptr, bool generateMipmaps = false);
+
+    // Render thread, once per frame
+    void processFrame();
+
+    // Issues everything that is queued, ignoring the budget
+    void flush();
+
+    const GpuUploadStats& getStats() const { return stats; }
+
+    // Drops the queued uploads and deletes the staging buffer while the GL context is still current
+    void shutdown();
+
+private:
+    GpuUploadQueue() = default;
+    GpuUploadQueue(const GpuUploadQueue&) = delete;
+    GpuUploadQueue& operator=(const GpuUploadQueue&) = delete;
+
+    struct UploadRequest {
+        bool isTexture = false;
+        GLuint object = 0;
+        GLenum bindTarget = 0;
+        GLenum imageTarget = 0;
+        GLenum format = 0;
+        GLsizei width = 0;
+        GLsizei height = 0;
+        size_t rowBytes = 0;
+        size_t offset = 0;
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+        size_t uploaded = 0;
+        bool generateMipmaps = false;
+        std::shared_ptr<UploadTicket> ticket;
+        std::shared_ptr<const void> keepAlive;
+    };
+
+    struct StagingSegment {
+        GLsync fence;
+        size_t end;
+    };
+
+    void initializeStaging();
+    void reclaimStaging();
+    bool allocateStaging(size_t size, size_t& offset);
+    bool issueChunk(UploadRequest& request, size_t maxBytes);
+    void completeRequest(UploadRequest& request);
+    void process(bool ignoreBudget);
+
+    std::deque<UploadRequest> requests;
+    double budgetMs = 2.0;
+    size_t budgetBytes = 8 * 1024 * 1024;
+
+    bool stagingInitialized = false;
+    GLuint stagingBuffer = 0;
+    unsigned char* stagingPointer = nullptr;
+    size_t stagingCapacity = 16 * 1024 * 1024;
+    size_t stagingHead = 0;
+    size_t stagingTail = 0;
+    bool stagedThisFrame = false;
+    std::deque<StagingSegment> stagingSegments;
+
+    GpuUploadStats stats;
+};
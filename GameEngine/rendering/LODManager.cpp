@@ -7,17 +7,17 @@ LODManager::LODManager(const std::vector<float>& distanceThresholds)
     : m_distanceThresholds(distanceThresholds) {
 }
 
-int LODManager::getLODLevel(const glm::vec3& cameraPosition, const StaticGeometry& geometry) const {
+int LODManager::getLODLevel(const glm::vec3& cameraPosition, const StaticGeometry& geometry, const glm::mat4& transform) const {
     // Calculate the distance between the camera and the geometry's bounding box center
-    glm::vec3 boundingBoxCenter = (geometry.getAABBMin() + geometry.getAABBMax()) * 0.5f;
+    glm::vec3 boundingBoxCenter = glm::vec3(transform * glm::vec4((geometry.getAABBMin() + geometry.getAABBMax()) * 0.5f, 1.0f));
     float distance = glm::distance(cameraPosition, boundingBoxCenter);
 
     return calculateLODLevel(distance);
 }
 
-int LODManager::getLODLevel(const glm::vec3& cameraPosition, const AnimatedGeometry& geometry) const {
+int LODManager::getLODLevel(const glm::vec3& cameraPosition, const AnimatedGeometry& geometry, const glm::mat4& transform) const {
     // Calculate the distance between the camera and the geometry's bounding box center
-    glm::vec3 boundingBoxCenter = (geometry.getAABBMin() + geometry.getAABBMax()) * 0.5f;
+    glm::vec3 boundingBoxCenter = glm::vec3(transform * glm::vec4((geometry.getAABBMin() + geometry.getAABBMax()) * 0.5f, 1.0f));
     float distance = glm::distance(cameraPosition, boundingBoxCenter);
 
     return calculateLODLevel(distance);
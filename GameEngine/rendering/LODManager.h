@@ -11,8 +11,9 @@ class LODManager {
 public:
     LODManager(const std::vector<float>& distanceThresholds);
 
-    int getLODLevel(const glm::vec3& cameraPosition, const StaticGeometry& geometry) const;
-    int getLODLevel(const glm::vec3& cameraPosition, const AnimatedGeometry& geometry) const;
+    // The transform places the model-space bounds of the geometry in the world
+    int getLODLevel(const glm::vec3& cameraPosition, const StaticGeometry& geometry, const glm::mat4& transform = glm::mat4(1.0f)) const;
+    int getLODLevel(const glm::vec3& cameraPosition, const AnimatedGeometry& geometry, const glm::mat4& transform = glm::mat4(1.0f)) const;
 
 private:
     std::vector<float> m_distanceThresholds;
@@ -0,0 +1,240 @@
+#include "MeshBufferArena.h"
+#include "geometry/VertexLayout.h"
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+    : capacity(capacity), freeCount(capacity) {
+    if (capacity > 0) {
+        freeBlocks.emplace(0, capacity);
+    }
+}
+
+bool RangeAllocator::allocate(uint32_t count, uint32_t& offset) {
+    if (count == 0) {
+        offset = 0;
+        return true;
+    }
+
+    for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+        if (it->second < count) {
+            continue;
+        }
+
+        offset = it->first;
+        const uint32_t remaining = it->second - count;
+        freeBlocks.erase(it);
+        if (remaining > 0) {
+            freeBlocks.emplace(offset + count, remaining);
+        }
+        freeCount -= count;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::release(uint32_t offset, uint32_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    auto next = freeBlocks.lower_bound(offset);
+    uint32_t start = offset;
+    uint32_t size = count;
+
+    // Merge with the free block right before, then with the one right after
+    if (next != freeBlocks.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            start = previous->first;
+            size += previous->second;
+            freeBlocks.erase(previous);
+        }
+    }
+    if (next != freeBlocks.end() && offset + count == next->first) {
+        size += next->second;
+        freeBlocks.erase(next);
+    }
+
+    freeBlocks.emplace(start, size);
+    freeCount += count;
+}
+
+uint32_t RangeAllocator::getLargestFreeBlock() const {
+    uint32_t largest = 0;
+    for (const auto& block : freeBlocks) {
+        largest = std::max(largest, block.second);
+    }
+    return largest;
+}
+
+size_t MeshBufferFormat::getVertexStride() const {
+    if (vertexFormat == VertexFormat::Packed) {
+        return animated ? sizeof(PackedAnimatedVertex) : sizeof(PackedStaticVertex);
+    }
+    return animated ? sizeof(AnimatedVertex) : sizeof(StaticVertex);
+}
+
+MeshBufferArena& MeshBufferArena::instance() {
+    static MeshBufferArena instance;
+    return instance;
+}
+
+void MeshBufferArena::shutdown() {
+    for (Pool& pool : pools) {
+        for (auto& page : pool.pages) {
+            if (page) {
+                destroyPage(*page);
+            }
+        }
+    }
+    isShutDown = true;
+}
+
+GLuint MeshBufferArena::createBuffer(GLenum target, size_t size) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    if (GLEW_ARB_buffer_storage) {
+        // The upload queue copies from its staging ring, or falls back to glBufferSubData
+        glBufferStorage(target, static_cast<GLsizeiptr>(size), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    }
+    else {
+        glBufferData(target, static_cast<GLsizeiptr>(size), nullptr, GL_STATIC_DRAW);
+    }
+    return buffer;
+}
+
+std::unique_ptr<MeshBufferArena::Page> MeshBufferArena::createPage(const MeshBufferFormat& format, uint32_t vertexCapacity, uint32_t indexCapacity) {
+    auto page = std::make_unique<Page>();
+    page->vertices = RangeAllocator(vertexCapacity);
+    page->indices = RangeAllocator(indexCapacity);
+
+    glGenVertexArrays(1, &page->vao);
+    glBindVertexArray(page->vao);
+
+    page->vertexBuffer = createBuffer(GL_ARRAY_BUFFER, static_cast<size_t>(vertexCapacity) * format.getVertexStride());
+    if (format.animated) {
+        VertexLayout::setupAnimatedAttributes(format.vertexFormat);
+    }
+    else {
+        VertexLayout::setupStaticAttributes(format.vertexFormat);
+    }
+    page->indexBuffer = createBuffer(GL_ELEMENT_ARRAY_BUFFER, static_cast<size_t>(indexCapacity) * format.getIndexSize());
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return page;
+}
+
+void MeshBufferArena::destroyPage(Page& page) {
+    glDeleteVertexArrays(1, &page.vao);
+    glDeleteBuffers(1, &page.vertexBuffer);
+    glDeleteBuffers(1, &page.indexBuffer);
+    page.vao = page.vertexBuffer = page.indexBuffer = 0;
+}
+
+int MeshBufferArena::findPool(const MeshBufferFormat& format) {
+    for (size_t i = 0; i < pools.size(); ++i) {
+        if (pools[i].format == format) {
+            return static_cast<int>(i);
+        }
+    }
+    pools.push_back(Pool{ format, {} });
+    return static_cast<int>(pools.size() - 1);
+}
+
+MeshAllocation MeshBufferArena::allocate(const MeshBufferFormat& format, const void* vertexData, uint32_t vertexCount,
+    const void* indexData, uint32_t indexCount, const std::shared_ptr<UploadTicket>& ticket, std::shared_ptr<const void> keepAlive) {
+    MeshAllocation allocation;
+    allocation.pool = findPool(format);
+    allocation.vertexCount = vertexCount;
+    allocation.indexCount = indexCount;
+    Pool& pool = pools[allocation.pool];
+
+    // First page with room for both ranges
+    Page* target = nullptr;
+    for (size_t i = 0; i < pool.pages.size() && !target; ++i) {
+        Page* page = pool.pages[i].get();
+        if (!page || page->vertices.getLargestFreeBlock() < vertexCount || page->indices.getLargestFreeBlock() < indexCount) {
+            continue;
+        }
+        target = page;
+        allocation.page = static_cast<int>(i);
+    }
+
+    if (!target) {
+        const uint32_t vertexCapacity = std::max(static_cast<uint32_t>(vertexPageBytes / format.getVertexStride()), vertexCount);
+        const uint32_t indexCapacity = std::max(static_cast<uint32_t>(indexPageBytes / format.getIndexSize()), indexCount);
+
+        auto slot = std::find(pool.pages.begin(), pool.pages.end(), nullptr);
+        if (slot == pool.pages.end()) {
+            slot = pool.pages.insert(pool.pages.end(), nullptr);
+        }
+        *slot = createPage(format, vertexCapacity, indexCapacity);
+        target = slot->get();
+        allocation.page = static_cast<int>(slot - pool.pages.begin());
+    }
+
+    target->vertices.allocate(vertexCount, allocation.baseVertex);
+    target->indices.allocate(indexCount, allocation.firstIndex);
+    ++target->allocations;
+    allocation.vao = target->vao;
+
+    GpuUploadQueue& uploads = GpuUploadQueue::instance();
+    uploads.uploadBuffer(target->vertexBuffer, static_cast<size_t>(allocation.baseVertex) * format.getVertexStride(),
+        vertexData, static_cast<size_t>(vertexCount) * format.getVertexStride(), ticket, keepAlive);
+    uploads.uploadBuffer(target->indexBuffer, static_cast<size_t>(allocation.firstIndex) * format.getIndexSize(),
+        indexData, static_cast<size_t>(indexCount) * format.getIndexSize(), ticket, std::move(keepAlive));
+    return allocation;
+}
+
+void MeshBufferArena::release(MeshAllocation& allocation) {
+    if (!allocation.isValid()) {
+        return;
+    }
+
+    Pool& pool = pools[allocation.pool];
+    std::unique_ptr<Page>& page = pool.pages[allocation.page];
+    page->vertices.release(allocation.baseVertex, allocation.vertexCount);
+    page->indices.release(allocation.firstIndex, allocation.indexCount);
+
+    // Draws still in flight keep the buffers alive until they complete
+    const size_t livePages = std::count_if(pool.pages.begin(), pool.pages.end(), [](const std::unique_ptr<Page>& p) { return p != nullptr; });
+    if (--page->allocations == 0 && livePages > 1 && !isShutDown) {
+        destroyPage(*page);
+        page.reset();
+        ++pagesReleased;
+    }
+
+    allocation = MeshAllocation();
+}
+
+MeshArenaStats MeshBufferArena::getStats() const {
+    MeshArenaStats stats;
+    stats.pools = pools.size();
+    stats.pagesReleased = pagesReleased;
+
+    // Free space outside the largest block of its page cannot take a mesh of that size
+    size_t freeVertexBytes = 0;
+    size_t scatteredVertexBytes = 0;
+    for (const Pool& pool : pools) {
+        const size_t stride = pool.format.getVertexStride();
+        const size_t indexSize = pool.format.getIndexSize();
+        for (const auto& page : pool.pages) {
+            if (!page) {
+                continue;
+            }
+            ++stats.pages;
+            stats.allocations += page->allocations;
+            stats.vertexCapacityBytes += page->vertices.getCapacity() * stride;
+            stats.vertexUsedBytes += (page->vertices.getCapacity() - page->vertices.getFreeCount()) * stride;
+            stats.indexCapacityBytes += page->indices.getCapacity() * indexSize;
+            stats.indexUsedBytes += (page->indices.getCapacity() - page->indices.getFreeCount()) * indexSize;
+            stats.freeBlocks += page->vertices.getFreeBlockCount() + page->indices.getFreeBlockCount();
+            freeVertexBytes += page->vertices.getFreeCount() * stride;
+            scatteredVertexBytes += (page->vertices.getFreeCount() - page->vertices.getLargestFreeBlock()) * stride;
+        }
+    }
+    stats.fragmentation = freeVertexBytes > 0 ? float(scatteredVertexBytes) / float(freeVertexBytes) : 0.0f;
+    return stats;
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "geometry/PackedVertex.h"
+#include "rendering/GpuUploadQueue.h"
+
+// First-fit free list over a range of elements. Released ranges merge with free neighbours.
+class RangeAllocator {
+public:
+    explicit RangeAllocator(uint32_t capacity = 0);
+
+    bool allocate(uint32_t count, uint32_t& offset);
+    void release(uint32_t offset, uint32_t count);
+
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t getFreeCount() const { return freeCount; }
+    uint32_t getLargestFreeBlock() const;
+    size_t getFreeBlockCount() const { return freeBlocks.size(); }
+
+private:
+    std::map<uint32_t, uint32_t> freeBlocks; // Offset to element count
+    uint32_t capacity;
+    uint32_t freeCount;
+};
+
+// Vertex layout and index type shared by every mesh of one arena pool
+struct MeshBufferFormat {
+    bool animated = false;
+    VertexFormat vertexFormat = VertexFormat::Float;
+    GLenum indexType = GL_UNSIGNED_INT;
+
+    size_t getVertexStride() const;
+    size_t getIndexSize() const { return indexType == GL_UNSIGNED_SHORT ? sizeof(uint16_t) : sizeof(unsigned int); }
+
+    bool operator==(const MeshBufferFormat& other) const {
+        return animated == other.animated && vertexFormat == other.vertexFormat && indexType == other.indexType;
+    }
+};
+
+// Where a mesh lives in the arena. Its indices are relative to baseVertex, so draws go through
+// glDrawElementsBaseVertex with firstIndex added to the index offset.
+struct MeshAllocation {
+    GLuint vao = 0;
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    int pool = -1;
+    int page = -1;
+
+    bool isValid() const { return pool >= 0; }
+};
+
+struct MeshArenaStats {
+    size_t pools = 0;
+    size_t pages = 0;
+    size_t allocations = 0;
+    size_t vertexCapacityBytes = 0;
+    size_t vertexUsedBytes = 0;
+    size_t indexCapacityBytes = 0;
+    size_t indexUsedBytes = 0;
+    size_t freeBlocks = 0;
+    float fragmentation = 0.0f; // Share of free vertex space outside the largest free block of its page
+    size_t pagesReleased = 0;   // Pages deleted after their last mesh went away
+};
+
+// Shared vertex and index buffers for every mesh of the same format. Each pool is a list of pages,
+// a page being one vertex buffer, one index buffer and the VAO over both; meshes get ranges out of
+// a page, so geometries of one format draw from the same VAO and switch nothing in between.
+// Storage is immutable where ARB_buffer_storage is available and filled through the upload queue.
+// A mesh larger than a page gets a page of its own. Pages left empty are deleted, except the last
+// one of a pool.
+class MeshBufferArena {
+public:
+    static constexpr size_t vertexPageBytes = 32 * 1024 * 1024;
+    static constexpr size_t indexPageBytes = 16 * 1024 * 1024;
+
+    static MeshBufferArena& instance();
+
+    // Runs after the GL context is gone, pages not deleted by shutdown() are leaked to it
+    ~MeshBufferArena() = default;
+
+    // Reserves ranges for the mesh and queues its data on the upload ticket. The data must stay
+    // valid until the ticket completes, as for GpuUploadQueue::uploadBuffer.
+    MeshAllocation allocate(const MeshBufferFormat& format, const void* vertexData, uint32_t vertexCount,
+        const void* indexData, uint32_t indexCount, const std::shared_ptr<UploadTicket>& ticket,
+        std::shared_ptr<const void> keepAlive = nullptr);
+
+    // Returns the ranges. Uploads still pending for them must have been cancelled.
+    void release(MeshAllocation& allocation);
+
+    MeshArenaStats getStats() const;
+
+    // Deletes every page while the GL context is still current. Meshes released afterwards only
+    // give their ranges back.
+    void shutdown();
+
+private:
+    MeshBufferArena() = default;
+    MeshBufferArena(const MeshBufferArena&) = delete;
+    MeshBufferArena& operator=(const MeshBufferArena&) = delete;
+
+    struct Page {
+        GLuint vao = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+        size_t allocations = 0;
+    };
+
+    struct Pool {
+        MeshBufferFormat format;
+        std::vector<std::unique_ptr<Page>> pages; // Deleted pages leave a null slot for reuse
+    };
+
+    int findPool(const MeshBufferFormat& format);
+    std::unique_ptr<Page> createPage(const MeshBufferFormat& format, uint32_t vertexCapacity, uint32_t indexCapacity);
+    static void destroyPage(Page& page);
+    static GLuint createBuffer(GLenum target, size_t size);
+
+    std::vector<Pool> pools;
+    size_t pagesReleased = 0;
+    bool isShutDown = false;
+};
@@ -0,0 +1,611 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include "utilities/ThreadPool.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCCLUSION_CULLER_SSE
+#endif
+
+namespace {
+
+// Pulls the edges of a region inwards, so rounding in their bounds never covers a pixel it should not
+constexpr float edgeMargin = 1.0f / 64.0f;
+// Triangles further off the plane of a fan, relative to their distance, keep it from forming
+constexpr float coplanarTolerance = 1e-5f;
+
+// Bits first to last of the row of tile column tileX, both in pixels
+uint32_t spanMask(int first, int last, int tileX) {
+    const int tileFirst = tileX * OcclusionCuller::tileWidth;
+    const int lo = std::max(first, tileFirst) - tileFirst;
+    const int hi = std::min(last, tileFirst + OcclusionCuller::tileWidth - 1) - tileFirst;
+    if (lo > hi) {
+        return 0;
+    }
+    return static_cast<uint32_t>(((uint64_t(1) << (hi + 1)) - 1) ^ ((uint64_t(1) << lo) - 1));
+}
+
+// Twice the signed screen area of a, b, c, positive when counter-clockwise
+float signedArea(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    return (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+}
+
+} // namespace
+
+OccluderMesh OccluderMesh::build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+    OccluderMesh mesh;
+    // Welded by position, so triangles split apart by texture seams still find each other
+    std::map<std::array<float, 3>, uint32_t> welded;
+    const size_t indexCount = indices.size() - indices.size() % 3;
+    mesh.indices.reserve(indexCount);
+    for (size_t i = 0; i < indexCount; i += 3) {
+        uint32_t triangle[3];
+        bool valid = true;
+        for (int corner = 0; corner < 3; ++corner) {
+            const uint32_t index = indices[i + corner];
+            if (index >= positions.size()) {
+                valid = false;
+                break;
+            }
+            const glm::vec3& position = positions[index];
+            auto [it, inserted] = welded.try_emplace({ position.x, position.y, position.z }, static_cast<uint32_t>(mesh.positions.size()));
+            if (inserted) {
+                mesh.positions.push_back(position);
+            }
+            triangle[corner] = it->second;
+        }
+        if (!valid || triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[2] == triangle[0]) {
+            continue;
+        }
+
+        const glm::vec3& a = mesh.positions[triangle[0]];
+        const glm::vec3& b = mesh.positions[triangle[1]];
+        const glm::vec3& c = mesh.positions[triangle[2]];
+        mesh.area += 0.5f * glm::length(glm::cross(b - a, c - a));
+        mesh.indices.insert(mesh.indices.end(), triangle, triangle + 3);
+    }
+
+    // A vertex's triangles form a fan when each outline vertex starts at most one of them, walking
+    // the outline from the one start, or any when closed, visits all of them, and they share a plane
+    std::vector<std::vector<uint32_t>> vertexTriangles(mesh.positions.size());
+    for (uint32_t corner = 0; corner < mesh.indices.size(); ++corner) {
+        vertexTriangles[mesh.indices[corner]].push_back(corner / 3);
+    }
+    for (uint32_t center = 0; center < vertexTriangles.size(); ++center) {
+        const std::vector<uint32_t>& triangles = vertexTriangles[center];
+        const size_t count = triangles.size();
+        if (count < 2 || count > static_cast<size_t>(maxFanEdges)) {
+            continue;
+        }
+
+        // Each triangle as its outline edge, from -> to, opposite the center
+        uint32_t from[maxFanEdges], to[maxFanEdges];
+        for (size_t i = 0; i < count; ++i) {
+            const uint32_t* triangle = &mesh.indices[triangles[i] * 3];
+            const int corner = triangle[0] == center ? 0 : triangle[1] == center ? 1 : 2;
+            from[i] = triangle[(corner + 1) % 3];
+            to[i] = triangle[(corner + 2) % 3];
+        }
+        size_t start = 0;
+        int starts = 0;
+        bool valid = true;
+        for (size_t i = 0; i < count; ++i) {
+            bool reached = false;
+            for (size_t j = 0; j < count; ++j) {
+                valid = valid && (j == i || from[j] != from[i]);
+                reached = reached || to[j] == from[i];
+            }
+            if (!reached) {
+                start = i;
+                ++starts;
+            }
+        }
+        const bool closed = starts == 0;
+        // Open fans add the center to their outline
+        if (!valid || starts > 1 || (!closed && count + 2 > static_cast<size_t>(maxFanEdges))) {
+            continue;
+        }
+
+        Fan fan;
+        fan.center = center;
+        fan.firstOutline = static_cast<uint32_t>(mesh.fanOutlines.size());
+        fan.firstTriangle = static_cast<uint32_t>(mesh.fanTriangles.size());
+        fan.count = static_cast<uint32_t>(count);
+        fan.closed = closed;
+        const glm::vec3& origin = mesh.positions[center];
+        const glm::vec3 normal = glm::cross(mesh.positions[from[start]] - origin, mesh.positions[to[start]] - origin);
+        const float normalLength = glm::length(normal);
+        auto onPlane = [&](uint32_t vertex) {
+            const glm::vec3 offset = mesh.positions[vertex] - origin;
+            return std::abs(glm::dot(normal, offset)) <= coplanarTolerance * normalLength * glm::length(offset);
+        };
+
+        uint32_t current = from[start];
+        for (size_t step = 0; step < count && valid; ++step) {
+            size_t next = 0;
+            while (next < count && from[next] != current) {
+                ++next;
+            }
+            valid = next < count && onPlane(current);
+            if (valid) {
+                mesh.fanOutlines.push_back(current);
+                mesh.fanTriangles.push_back(triangles[next]);
+                current = to[next];
+            }
+        }
+        // Closed fans come back to where they started, open ones end on one more outline vertex
+        valid = valid && normalLength > 0.0f && (closed ? current == from[start] : onPlane(current));
+        if (!valid) {
+            mesh.fanOutlines.resize(fan.firstOutline);
+            mesh.fanTriangles.resize(fan.firstTriangle);
+            continue;
+        }
+        if (!closed) {
+            mesh.fanOutlines.push_back(current);
+        }
+        mesh.fans.push_back(fan);
+    }
+    return mesh;
+}
+
+OcclusionCuller::OcclusionCuller()
+    : referenceDepth(tilesX * tilesY, 0.0f),
+      workingDepth(tilesX * tilesY, 0.0f),
+      coverage(tilesX * tilesY * tileHeight, 0u) {}
+
+void OcclusionCuller::begin(const glm::mat4& viewProjection, float nearPlane) {
+    this->viewProjection = viewProjection;
+    this->nearPlane = nearPlane;
+    occluders.clear();
+    std::fill(referenceDepth.begin(), referenceDepth.end(), 0.0f);
+    std::fill(workingDepth.begin(), workingDepth.end(), 0.0f);
+    std::fill(coverage.begin(), coverage.end(), 0u);
+    stats = OcclusionStats();
+}
+
+void OcclusionCuller::addOccluder(const OccluderMesh& mesh, const glm::mat4& transform) {
+    occluders.push_back(Occluder{ &mesh, transform });
+}
+
+void OcclusionCuller::rasterize() {
+    auto start = std::chrono::steady_clock::now();
+    stats.occluders = occluders.size();
+    if (occluders.empty()) {
+        return;
+    }
+
+    ThreadPool& pool = ThreadPool::instance();
+    if (occluderTriangles.size() < occluders.size()) {
+        occluderTriangles.resize(occluders.size());
+    }
+    pool.parallelFor(occluders.size(), [this](size_t i) {
+        setupTriangles(occluders[i], occluderTriangles[i]);
+    });
+    for (size_t i = 0; i < occluders.size(); ++i) {
+        stats.occluderTriangles += occluderTriangles[i].size();
+    }
+
+    // Bands of tile rows never share a tile, and each walks the triangles in the order they were added
+    const size_t bandCount = std::min<size_t>(tilesY, pool.getWorkerCount() + 1);
+    pool.parallelFor(bandCount, [this, bandCount](size_t band) {
+        rasterizeBand(static_cast<int>(band * tilesY / bandCount), static_cast<int>((band + 1) * tilesY / bandCount));
+    });
+
+    stats.rasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionCuller::setupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& triangles) const {
+    triangles.clear();
+    const glm::mat4 transform = viewProjection * occluder.transform;
+    const OccluderMesh& mesh = *occluder.mesh;
+
+    std::vector<glm::vec4> clipPositions(mesh.positions.size());
+    std::vector<glm::vec3> screenPositions(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); ++i) {
+        clipPositions[i] = transform * glm::vec4(mesh.positions[i], 1.0f);
+        if (clipPositions[i].w >= nearPlane) {
+            const float inverseW = 1.0f / clipPositions[i].w;
+            screenPositions[i] = glm::vec3((clipPositions[i].x * inverseW * 0.5f + 0.5f) * width,
+                (clipPositions[i].y * inverseW * 0.5f + 0.5f) * height, inverseW);
+        }
+    }
+    auto inFront = [&](uint32_t vertex) { return clipPositions[vertex].w >= nearPlane; };
+
+    // Fans in front of the near plane, a convex one standing in for its triangles
+    std::vector<bool> covered(mesh.indices.size() / 3, false);
+    for (const OccluderMesh::Fan& fan : mesh.fans) {
+        const uint32_t* outlineVertices = &mesh.fanOutlines[fan.firstOutline];
+        const int outlineVertexCount = static_cast<int>(fan.count) + (fan.closed ? 0 : 1);
+        glm::vec3 outline[ScreenTriangle::maxEdges];
+        int outlineSize = 0;
+        bool valid = inFront(fan.center);
+        if (!fan.closed) {
+            outline[outlineSize++] = screenPositions[fan.center];
+        }
+        for (int i = 0; i < outlineVertexCount; ++i) {
+            valid = valid && inFront(outlineVertices[i]);
+            outline[outlineSize++] = screenPositions[outlineVertices[i]];
+        }
+        if (!valid) {
+            continue;
+        }
+
+        // Two-sided like the triangles, so every triangle of the fan must face the same way
+        const glm::vec3& center = screenPositions[fan.center];
+        const float firstArea = signedArea(center, outline[fan.closed ? 0 : 1], outline[fan.closed ? 1 : 2]);
+        for (uint32_t i = 0; i < fan.count; ++i) {
+            const float area = signedArea(center, screenPositions[outlineVertices[i]], screenPositions[outlineVertices[(i + 1) % outlineVertexCount]]);
+            valid = valid && std::abs(area) >= 1e-6f && (area > 0.0f) == (firstArea > 0.0f);
+        }
+        if (!valid) {
+            continue;
+        }
+        if (firstArea < 0.0f) {
+            std::reverse(outline, outline + outlineSize);
+        }
+        glm::vec3 plane[3] = { center, screenPositions[outlineVertices[0]], screenPositions[outlineVertices[1]] };
+        if (firstArea < 0.0f) {
+            std::swap(plane[1], plane[2]);
+        }
+
+        ScreenTriangle triangle;
+        if (!setupRegion(outline, outlineSize, plane, triangle)) {
+            continue;
+        }
+        triangles.push_back(triangle);
+
+        // Convex when no outline vertex lies outside an edge, the region is then the whole fan
+        bool convex = true;
+        for (int edge = 0; edge < outlineSize && convex; ++edge) {
+            for (int corner = 0; corner < outlineSize; ++corner) {
+                convex = convex && signedArea(outline[edge], outline[(edge + 1) % outlineSize], outline[corner]) >= 0.0f;
+            }
+        }
+        if (convex) {
+            for (uint32_t i = 0; i < fan.count; ++i) {
+                covered[mesh.fanTriangles[fan.firstTriangle + i]] = true;
+            }
+        }
+    }
+
+    const size_t triangleCount = mesh.indices.size() / 3;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (covered[t]) {
+            continue;
+        }
+        const uint32_t* corners = &mesh.indices[t * 3];
+        glm::vec3 outline[ScreenTriangle::maxEdges];
+        glm::vec3 plane[3];
+        int outlineSize = 0;
+
+        if (inFront(corners[0]) && inFront(corners[1]) && inFront(corners[2])) {
+            // Faces are not culled unless a material asks for it, so occluders are two-sided
+            const float area = signedArea(screenPositions[corners[0]], screenPositions[corners[1]], screenPositions[corners[2]]);
+            if (std::abs(area) < 1e-6f) {
+                continue;
+            }
+            for (int k = 0; k < 3; ++k) {
+                plane[k] = outline[k] = screenPositions[corners[area < 0.0f ? (3 - k) % 3 : k]];
+            }
+            outlineSize = 3;
+        }
+        else {
+            // Clip against the near plane, w >= nearPlane, leaving a triangle or a quad
+            glm::vec4 polygon[4];
+            int polygonSize = 0;
+            for (int corner = 0; corner < 3; ++corner) {
+                const glm::vec4& a = clipPositions[corners[corner]];
+                const glm::vec4& b = clipPositions[corners[(corner + 1) % 3]];
+                const float distanceA = a.w - nearPlane;
+                const float distanceB = b.w - nearPlane;
+                if (distanceA >= 0.0f) {
+                    polygon[polygonSize++] = a;
+                }
+                if ((distanceA >= 0.0f) != (distanceB >= 0.0f)) {
+                    polygon[polygonSize++] = a + (b - a) * (distanceA / (distanceA - distanceB));
+                }
+            }
+            if (polygonSize < 3) {
+                continue;
+            }
+
+            float area = 0.0f;
+            for (int corner = 0; corner < polygonSize; ++corner) {
+                const float inverseW = 1.0f / polygon[corner].w;
+                outline[corner] = glm::vec3((polygon[corner].x * inverseW * 0.5f + 0.5f) * width,
+                    (polygon[corner].y * inverseW * 0.5f + 0.5f) * height, inverseW);
+            }
+            outlineSize = polygonSize;
+            for (int corner = 1; corner + 1 < outlineSize; ++corner) {
+                area += signedArea(outline[0], outline[corner], outline[corner + 1]);
+            }
+            if (std::abs(area) < 1e-6f) {
+                continue;
+            }
+            if (area < 0.0f) {
+                std::reverse(outline, outline + outlineSize);
+            }
+            // The larger of the fan triangles spans the plane most precisely
+            const int fan = outlineSize == 4 && signedArea(outline[0], outline[2], outline[3]) > signedArea(outline[0], outline[1], outline[2]) ? 2 : 1;
+            plane[0] = outline[0];
+            plane[1] = outline[fan];
+            plane[2] = outline[fan + 1];
+        }
+
+        ScreenTriangle triangle;
+        if (setupRegion(outline, outlineSize, plane, triangle)) {
+            triangles.push_back(triangle);
+        }
+    }
+}
+
+bool OcclusionCuller::setupRegion(const glm::vec3* outline, int size, const glm::vec3* plane, ScreenTriangle& triangle) {
+    triangle.minX = triangle.minY = FLT_MAX;
+    triangle.maxX = triangle.maxY = -FLT_MAX;
+    triangle.depthMin = FLT_MAX;
+    for (int corner = 0; corner < size; ++corner) {
+        triangle.minX = std::min(triangle.minX, outline[corner].x);
+        triangle.maxX = std::max(triangle.maxX, outline[corner].x);
+        triangle.minY = std::min(triangle.minY, outline[corner].y);
+        triangle.maxY = std::max(triangle.maxY, outline[corner].y);
+        triangle.depthMin = std::min(triangle.depthMin, outline[corner].z);
+    }
+
+    const glm::vec3& p0 = plane[0];
+    const glm::vec3& p1 = plane[1];
+    const glm::vec3& p2 = plane[2];
+    const float area = signedArea(p0, p1, p2);
+    if (area < 1e-6f) {
+        return false;
+    }
+    const float inverseArea = 1.0f / area;
+    triangle.depthA = ((p1.z - p0.z) * (p2.y - p0.y) - (p2.z - p0.z) * (p1.y - p0.y)) * inverseArea;
+    triangle.depthB = ((p2.z - p0.z) * (p1.x - p0.x) - (p1.z - p0.z) * (p2.x - p0.x)) * inverseArea;
+    triangle.depthC = p0.z - triangle.depthA * p0.x - triangle.depthB * p0.y;
+
+    // Inside every edge from a to b: -e.y * x + e.x * y + (e.y * a.x - e.x * a.y) >= 0. A pixel row
+    // from y to y + 1 is covered from the left bound at whichever end lies further right, and so on.
+    triangle.leftCount = 0;
+    triangle.rightCount = 0;
+    for (int edge = 0; edge < size; ++edge) {
+        const glm::vec3& a = outline[edge];
+        const glm::vec3& b = outline[(edge + 1) % size];
+        const float ex = b.x - a.x;
+        const float ey = b.y - a.y;
+        if (std::abs(ey) < 1e-6f) {
+            // Horizontal edges bound the rows instead
+            if (ex > 0.0f) {
+                triangle.minY = std::max(triangle.minY, std::max(a.y, b.y));
+            }
+            else {
+                triangle.maxY = std::min(triangle.maxY, std::min(a.y, b.y));
+            }
+            continue;
+        }
+        const float slope = ex / ey;
+        const float offset = a.x - slope * a.y;
+        if (ey < 0.0f) {
+            triangle.leftSlope[triangle.leftCount] = slope;
+            triangle.leftOffset[triangle.leftCount++] = offset + std::max(slope, 0.0f);
+        }
+        else {
+            triangle.rightSlope[triangle.rightCount] = slope;
+            triangle.rightOffset[triangle.rightCount++] = offset + std::min(slope, 0.0f);
+        }
+    }
+
+    return triangle.leftCount > 0 && triangle.rightCount > 0 && triangle.minY < triangle.maxY &&
+        triangle.maxX >= 0.0f && triangle.minX <= width && triangle.maxY >= 0.0f && triangle.minY <= height;
+}
+
+void OcclusionCuller::rasterizeBand(int firstTileRow, int lastTileRow) {
+    const float bandMinY = static_cast<float>(firstTileRow * tileHeight);
+    const float bandMaxY = static_cast<float>(lastTileRow * tileHeight);
+    for (size_t i = 0; i < occluders.size(); ++i) {
+        for (const ScreenTriangle& triangle : occluderTriangles[i]) {
+            if (triangle.maxY >= bandMinY && triangle.minY <= bandMaxY) {
+                rasterizeTriangle(triangle, firstTileRow, lastTileRow);
+            }
+        }
+    }
+}
+
+void OcclusionCuller::computeSpans(const ScreenTriangle& triangle, int firstRow, int* spanFirst, int* spanLast) const {
+    // A pixel is covered when it lies between the bounds of its row entirely
+    alignas(16) float left[tileHeight];
+    alignas(16) float right[tileHeight];
+#if defined(OCCLUSION_CULLER_SSE)
+    for (int group = 0; group < tileHeight; group += 4) {
+        const __m128 y = _mm_add_ps(_mm_set1_ps(static_cast<float>(firstRow + group)), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+        __m128 leftBound = _mm_set1_ps(-FLT_MAX);
+        __m128 rightBound = _mm_set1_ps(FLT_MAX);
+        for (int edge = 0; edge < triangle.leftCount; ++edge) {
+            leftBound = _mm_max_ps(leftBound, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.leftSlope[edge]), y), _mm_set1_ps(triangle.leftOffset[edge])));
+        }
+        for (int edge = 0; edge < triangle.rightCount; ++edge) {
+            rightBound = _mm_min_ps(rightBound, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.rightSlope[edge]), y), _mm_set1_ps(triangle.rightOffset[edge])));
+        }
+        _mm_store_ps(left + group, leftBound);
+        _mm_store_ps(right + group, rightBound);
+    }
+#else
+    for (int row = 0; row < tileHeight; ++row) {
+        const float y = static_cast<float>(firstRow + row);
+        left[row] = -FLT_MAX;
+        right[row] = FLT_MAX;
+        for (int edge = 0; edge < triangle.leftCount; ++edge) {
+            left[row] = std::max(left[row], triangle.leftSlope[edge] * y + triangle.leftOffset[edge]);
+        }
+        for (int edge = 0; edge < triangle.rightCount; ++edge) {
+            right[row] = std::min(right[row], triangle.rightSlope[edge] * y + triangle.rightOffset[edge]);
+        }
+    }
+#endif
+    for (int row = 0; row < tileHeight; ++row) {
+        spanFirst[row] = static_cast<int>(std::ceil(std::clamp(left[row] + edgeMargin, -1.0f, static_cast<float>(width))));
+        spanLast[row] = static_cast<int>(std::floor(std::clamp(right[row] - edgeMargin, -1.0f, static_cast<float>(width)))) - 1;
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& triangle, int firstTileRow, int lastTileRow) {
+    // Rows and columns of the pixels inside the bounds
+    const int firstRow = std::max(firstTileRow * tileHeight, static_cast<int>(std::ceil(std::max(triangle.minY, 0.0f))));
+    const int lastRow = std::min(lastTileRow * tileHeight, static_cast<int>(std::floor(std::min(triangle.maxY, static_cast<float>(height))))) - 1;
+    const int firstColumn = static_cast<int>(std::ceil(std::max(triangle.minX, 0.0f)));
+    const int lastColumn = static_cast<int>(std::floor(std::min(triangle.maxX, static_cast<float>(width)))) - 1;
+    if (firstRow > lastRow || firstColumn > lastColumn) {
+        return;
+    }
+
+    int spanFirst[tileHeight];
+    int spanLast[tileHeight];
+    uint32_t rowMasks[tileHeight];
+    for (int tileY = firstRow / tileHeight; tileY <= lastRow / tileHeight; ++tileY) {
+        const int tileRow = tileY * tileHeight;
+        computeSpans(triangle, tileRow, spanFirst, spanLast);
+        for (int row = 0; row < tileHeight; ++row) {
+            if (tileRow + row < firstRow || tileRow + row > lastRow) {
+                spanFirst[row] = 1;
+                spanLast[row] = 0;
+            }
+        }
+
+        for (int tileX = firstColumn / tileWidth; tileX <= lastColumn / tileWidth; ++tileX) {
+            uint32_t any = 0;
+            for (int row = 0; row < tileHeight; ++row) {
+                rowMasks[row] = spanMask(spanFirst[row], spanLast[row], tileX);
+                any |= rowMasks[row];
+            }
+            if (!any) {
+                continue;
+            }
+
+            // Smallest 1 / w of the plane over the part of the tile the triangle can cover
+            const float x0 = std::max(static_cast<float>(tileX * tileWidth), triangle.minX);
+            const float x1 = std::min(static_cast<float>((tileX + 1) * tileWidth), triangle.maxX);
+            const float y0 = std::max(static_cast<float>(tileRow), triangle.minY);
+            const float y1 = std::min(static_cast<float>(tileRow + tileHeight), triangle.maxY);
+            const float planeMin = triangle.depthC
+                + std::min(triangle.depthA * x0, triangle.depthA * x1)
+                + std::min(triangle.depthB * y0, triangle.depthB * y1);
+            updateTile(tileY * tilesX + tileX, rowMasks, std::max(planeMin, triangle.depthMin));
+        }
+    }
+}
+
+void OcclusionCuller::updateTile(int tile, const uint32_t* triangleCoverage, float depth) {
+    // Behind everything the tile already hides
+    if (depth <= referenceDepth[tile]) {
+        return;
+    }
+
+    uint32_t* mask = &coverage[static_cast<size_t>(tile) * tileHeight];
+    uint32_t triangleFull = ~0u;
+    uint32_t workingUsed = 0;
+    for (int row = 0; row < tileHeight; ++row) {
+        triangleFull &= triangleCoverage[row];
+        workingUsed |= mask[row];
+    }
+
+    // A triangle covering the whole tile raises the reference directly, the working layer stays as it is
+    if (triangleFull == ~0u) {
+        referenceDepth[tile] = depth;
+        return;
+    }
+
+    workingDepth[tile] = workingUsed ? std::min(workingDepth[tile], depth) : depth;
+    uint32_t full = ~0u;
+    for (int row = 0; row < tileHeight; ++row) {
+        mask[row] |= triangleCoverage[row];
+        full &= mask[row];
+    }
+
+    // Every pixel holds something at least as near as the working depth, fold it into the reference
+    if (full == ~0u) {
+        referenceDepth[tile] = std::max(referenceDepth[tile], workingDepth[tile]);
+        std::fill(mask, mask + tileHeight, 0u);
+    }
+}
+
+bool OcclusionCuller::isVisible(const BoundingBox& box) {
+    ++stats.tested;
+    if (box.isEmpty()) {
+        return true;
+    }
+
+    // Nearest 1 / w and screen rectangle of the corners. A box reaching behind the near plane is kept.
+    float nearest = 0.0f;
+    float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for (int corner = 0; corner < 8; ++corner) {
+        const glm::vec3 position(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z);
+        const glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+        if (clip.w < nearPlane) {
+            return true;
+        }
+        const float inverseW = 1.0f / clip.w;
+        const float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+        const float y = (clip.y * inverseW * 0.5f + 0.5f) * height;
+        nearest = std::max(nearest, inverseW);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+    if (maxX < 0.0f || minX > width || maxY < 0.0f || minY > height) {
+        return true; // Off screen, the frustum test has the final say
+    }
+
+    // Every pixel the rectangle touches
+    const int firstColumn = std::max(0, static_cast<int>(std::floor(minX)));
+    const int lastColumn = std::min(width - 1, std::max(firstColumn, static_cast<int>(std::ceil(maxX)) - 1));
+    const int firstRow = std::max(0, static_cast<int>(std::floor(minY)));
+    const int lastRow = std::min(height - 1, std::max(firstRow, static_cast<int>(std::ceil(maxY)) - 1));
+    const int firstTileX = firstColumn / tileWidth;
+    const int lastTileX = lastColumn / tileWidth;
+
+    for (int tileY = firstRow / tileHeight; tileY <= lastRow / tileHeight; ++tileY) {
+        // Tiles of the row whose reference depth does not already hide the box
+        uint32_t nearTiles = 0;
+        const float* reference = &referenceDepth[static_cast<size_t>(tileY) * tilesX];
+#if defined(OCCLUSION_CULLER_SSE)
+        const __m128 boxDepth = _mm_set1_ps(nearest);
+        for (int tileX = 0; tileX < tilesX; tileX += 4) {
+            nearTiles |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(boxDepth, _mm_loadu_ps(reference + tileX)))) << tileX;
+        }
+#else
+        for (int tileX = 0; tileX < tilesX; ++tileX) {
+            nearTiles |= (nearest >= reference[tileX] ? 1u : 0u) << tileX;
+        }
+#endif
+        nearTiles &= ((1u << (lastTileX + 1)) - 1) & ~((1u << firstTileX) - 1);
+
+        for (int tileX = firstTileX; tileX <= lastTileX; ++tileX) {
+            if (!(nearTiles & (1u << tileX))) {
+                continue;
+            }
+
+            // Pixels outside the working layer only hold the reference depth, which the box is in front of
+            const int tile = tileY * tilesX + tileX;
+            const uint32_t* mask = &coverage[static_cast<size_t>(tile) * tileHeight];
+            const uint32_t rectMask = spanMask(firstColumn, lastColumn, tileX);
+            bool inWorkingLayer = true;
+            for (int row = std::max(firstRow, tileY * tileHeight); row <= std::min(lastRow, tileY * tileHeight + tileHeight - 1); ++row) {
+                if (rectMask & ~mask[row - tileY * tileHeight]) {
+                    inWorkingLayer = false;
+                    break;
+                }
+            }
+            if (!inWorkingLayer || nearest >= workingDepth[tile]) {
+                return true;
+            }
+        }
+    }
+
+    ++stats.occluded;
+    return false;
+}
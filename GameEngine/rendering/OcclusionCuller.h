@@ -0,0 +1,132 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "rendering/BoundingBox.h"
+
+// Model-space triangles rasterized as an occluder, a simplified stand-in for a large mesh
+struct OccluderMesh {
+    // Triangles around a center vertex that share a plane and winding, rasterized together as well.
+    // Triangle i spans the center and outline vertices i and i + 1, wrapping around when closed;
+    // an open fan has one outline vertex more than it has triangles.
+    struct Fan {
+        uint32_t center = 0;
+        uint32_t firstOutline = 0;  // In fanOutlines
+        uint32_t firstTriangle = 0; // In fanTriangles
+        uint32_t count = 0;         // Triangles
+        bool closed = false;        // The outline goes all the way around the center
+    };
+    static constexpr int maxFanEdges = 8;
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    std::vector<Fan> fans;
+    std::vector<uint32_t> fanOutlines;
+    std::vector<uint32_t> fanTriangles;
+    float area = 0.0f; // Summed triangle area
+
+    // Keeps the vertices the triangles use, welding equal positions, and collects the fans.
+    // Indices are taken three at a time.
+    static OccluderMesh build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+};
+
+struct OcclusionStats {
+    size_t occluders = 0;
+    size_t occluderTriangles = 0; // Triangles and fans set up in front of the near plane
+    size_t tested = 0;
+    size_t occluded = 0;          // Draws culled this frame
+    double rasterMs = 0.0;
+    double testMs = 0.0;
+};
+
+// CPU occlusion culling against a low-resolution masked depth buffer (after Hasselgren et al.,
+// Masked Software Occlusion Culling). The buffer is split in tiles of 32x8 pixels. Each tile keeps
+// a coverage bit per pixel and two depth layers: a reference depth behind which the whole tile is
+// hidden, and a working depth for the pixels covered so far. Once the working layer covers the tile
+// it is folded into the reference. Depth is stored as 1 / w, so larger is nearer. The buffer is
+// conservative: a triangle only covers the pixels it covers entirely, and never at a depth nearer
+// than its own, so a box seen through a gap between occluders stays visible however thin the gap.
+// Lone triangles would leave the pixels along their shared edges uncovered, so coplanar fans of
+// triangles around a vertex are rasterized as one region as well, covering the pixels within
+// every edge of their outline. A convex fan stands in for its triangles.
+// Occluders are transformed in parallel, then rasterized on the thread pool in bands of tile rows.
+// Everything runs on the CPU, nothing here touches the GL context.
+class OcclusionCuller {
+public:
+    static constexpr int width = 256;
+    static constexpr int height = 128;
+    static constexpr int tileWidth = 32;
+    static constexpr int tileHeight = 8;
+    static constexpr int tilesX = width / tileWidth;
+    static constexpr int tilesY = height / tileHeight;
+
+    // Meshes picked as occluders at import when they are not authored as such
+    static constexpr float minOccluderArea = 16.0f;
+    static constexpr size_t maxOccluderTriangles = 1024;
+    // Simplified levels may bulge out of the mesh, only levels this close to it stand in for it
+    static constexpr float maxOccluderLodError = 0.01f;
+    // Largest occluders on screen rasterized per frame
+    static constexpr size_t maxOccludersPerFrame = 64;
+
+    OcclusionCuller();
+
+    // Clears the buffer for a frame seen through viewProjection
+    void begin(const glm::mat4& viewProjection, float nearPlane);
+    void addOccluder(const OccluderMesh& mesh, const glm::mat4& transform);
+    // Rasterizes the occluders added since begin
+    void rasterize();
+
+    // False when every pixel the box covers on screen is hidden behind the occluders
+    bool isVisible(const BoundingBox& box);
+
+    const OcclusionStats& getStats() const { return stats; }
+    OcclusionStats& getStats() { return stats; }
+
+    // 1 / w of the reference layer per tile, for debugging views
+    const std::vector<float>& getTileDepths() const { return referenceDepth; }
+
+private:
+    // Convex region in pixels, y up, set up for span rasterization: a triangle, the part of one in
+    // front of the near plane, or the part of a fan within every edge of its outline
+    struct ScreenTriangle {
+        static constexpr int maxEdges = OccluderMesh::maxFanEdges;
+
+        float minX, maxX, minY, maxY; // Rows are also limited by the horizontal edges
+        float depthA, depthB, depthC; // Plane of 1 / w over the screen: a * x + b * y + c
+        float depthMin;               // Smallest 1 / w of the vertices
+        // Pixel row y spans from the largest left bound to the smallest right bound, bound = slope * y + offset.
+        // Each offset already holds the end of the row where the edge lies furthest inside.
+        float leftSlope[maxEdges], leftOffset[maxEdges];
+        float rightSlope[maxEdges], rightOffset[maxEdges];
+        int leftCount, rightCount;
+    };
+
+    struct Occluder {
+        const OccluderMesh* mesh;
+        glm::mat4 transform;
+    };
+
+    void setupTriangles(const Occluder& occluder, std::vector<ScreenTriangle>& triangles) const;
+    // Sets up the convex region inside every edge of a counter-clockwise outline, its depth on the
+    // plane through the counter-clockwise triangle plane
+    static bool setupRegion(const glm::vec3* outline, int size, const glm::vec3* plane, ScreenTriangle& triangle);
+    void rasterizeBand(int firstTileRow, int lastTileRow);
+    void rasterizeTriangle(const ScreenTriangle& triangle, int firstTileRow, int lastTileRow);
+    void computeSpans(const ScreenTriangle& triangle, int firstRow, int* spanFirst, int* spanLast) const;
+    void updateTile(int tile, const uint32_t* triangleCoverage, float depth);
+
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    float nearPlane = 0.1f;
+
+    std::vector<Occluder> occluders;
+    std::vector<std::vector<ScreenTriangle>> occluderTriangles; // Per occluder, in the order added
+
+    // Tiles as structure of arrays, so the tests compare several reference depths at once
+    std::vector<float> referenceDepth;
+    std::vector<float> workingDepth;
+    std::vector<uint32_t> coverage; // tileHeight row masks per tile, bit x for column x
+
+    OcclusionStats stats;
+};
@@ -0,0 +1,429 @@
+#include "RenderQueue.h"
+#include "StaticGeometry.h"
+#include "geometry/AnimatedGeometry.h"
+#include "rendering/GLStateCache.h"
+#include "rendering/BindlessTextures.h"
+#include "rendering/GpuCuller.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr int programBits = 12;
+    constexpr int materialBits = 12;
+    constexpr int textureSetBits = 12;
+    constexpr int vaoBits = 10;
+    constexpr int depthBits = 16;
+
+    uint64_t field(uint64_t value, int bits) {
+        return value & ((uint64_t(1) << bits) - 1);
+    }
+
+    RenderPass passOfKey(uint64_t key) {
+        return static_cast<RenderPass>(key >> (programBits + materialBits + textureSetBits + vaoBits + depthBits));
+    }
+
+    template <typename Geometry>
+    RenderPass passOf(const Geometry& geometry) {
+        const std::shared_ptr<Material>& material = geometry.getMaterial();
+        return material && material->getTechniqueDetails().blending.enabled ? RenderPass::Transparent : RenderPass::Opaque;
+    }
+}
+
+ObjectData::ObjectData(const glm::mat4& transform)
+    : model(transform), previousModel(transform), normalMatrix(packNormalMatrix(transform)) {}
+
+glm::mat3x4 ObjectData::packNormalMatrix(const glm::mat4& transform) {
+    glm::mat3 normal = glm::transpose(glm::inverse(glm::mat3(transform)));
+    return glm::mat3x4(glm::vec4(normal[0], 0.0f), glm::vec4(normal[1], 0.0f), glm::vec4(normal[2], 0.0f));
+}
+
+RenderQueue::RenderQueue()
+    : objectBuffer(GL_SHADER_STORAGE_BUFFER, 1024 * 1024, "object data"),
+    indirectCommands(GL_DRAW_INDIRECT_BUFFER, 64 * 1024, "indirect command"),
+    gpuCuller(std::make_unique<GpuCuller>()) {}
+
+RenderQueue::~RenderQueue() = default;
+
+void RenderQueue::setOcclusionDepth(GLuint depthTexture, int width, int height) {
+    gpuCuller->setDepthSource(depthTexture, width, height);
+}
+
+void RenderQueue::setViewProjection(const glm::mat4& viewProjection) {
+    gpuCuller->setViewProjection(viewProjection);
+}
+
+const GpuCullingStats& RenderQueue::getGpuCullingStats() const {
+    return gpuCuller->getStats();
+}
+
+void RenderQueue::begin(const glm::vec3& viewPosition, const glm::vec3& viewDirection, float farPlane) {
+    this->viewPosition = viewPosition;
+    this->viewDirection = viewDirection;
+    this->farPlane = farPlane > 0.0f ? farPlane : 1.0f;
+
+    items.clear();
+    entries.clear();
+    programIds.clear();
+    materialIds.clear();
+    textureSetIds.clear();
+    vaoIds.clear();
+}
+
+void RenderQueue::add(StaticGeometry& geometry, const ObjectData& object) {
+    if (!geometry.isReady()) {
+        return;
+    }
+
+    const std::shared_ptr<Shader>& shader = geometry.getShader();
+    uint64_t key = makeKey(passOf(geometry), shader ? shader->Program : 0, geometry.getMaterial().get(),
+        geometry.getTextureSetKey(), geometry.getVAO(), object.model, geometry.getAABBMin(), geometry.getAABBMax());
+    push(DrawItem{ object, &geometry, nullptr, nullptr, geometry.getLODLevel() }, key);
+    items.back().object.materialIndex = intern(materialIds, reinterpret_cast<uintptr_t>(geometry.getMaterial().get()));
+}
+
+void RenderQueue::add(AnimatedGeometry& geometry, const glm::mat4& transform, Animator* animator) {
+    if (!geometry.isReady()) {
+        return;
+    }
+
+    const std::shared_ptr<Shader>& shader = geometry.getDrawShader();
+    uint64_t key = makeKey(passOf(geometry), shader ? shader->Program : 0, geometry.getMaterial().get(),
+        geometry.getTextureSetKey(), geometry.getVAO(), transform, geometry.getAABBMin(), geometry.getAABBMax());
+    push(DrawItem{ ObjectData(), nullptr, &geometry, animator, 0 }, key);
+    items.back().object.model = transform;
+}
+
+void RenderQueue::push(const DrawItem& item, uint64_t key) {
+    entries.push_back(SortEntry{ key, static_cast<uint32_t>(items.size()) });
+    items.push_back(item);
+}
+
+uint32_t RenderQueue::intern(std::unordered_map<uint64_t, uint32_t>& ids, uint64_t value) {
+    auto inserted = ids.emplace(value, static_cast<uint32_t>(ids.size()));
+    return inserted.first->second;
+}
+
+uint64_t RenderQueue::makeKey(RenderPass pass, GLuint program, const Material* material, uint64_t textureSet, GLuint vao,
+    const glm::mat4& transform, const glm::vec3& aabbMin, const glm::vec3& aabbMax) {
+    // View depth of the bounds center, quantized over [0, farPlane]
+    glm::vec3 center = glm::vec3(transform * glm::vec4((aabbMin + aabbMax) * 0.5f, 1.0f));
+    float depth = glm::clamp(glm::dot(center - viewPosition, viewDirection) / farPlane, 0.0f, 1.0f);
+    uint64_t quantizedDepth = static_cast<uint64_t>(depth * float((1 << depthBits) - 1));
+
+    uint64_t state = field(intern(programIds, program), programBits);
+    state = (state << materialBits) | field(intern(materialIds, reinterpret_cast<uintptr_t>(material)), materialBits);
+    state = (state << textureSetBits) | field(intern(textureSetIds, textureSet), textureSetBits);
+    state = (state << vaoBits) | field(intern(vaoIds, vao), vaoBits);
+
+    const int stateBits = programBits + materialBits + textureSetBits + vaoBits;
+    uint64_t key = uint64_t(pass) << (stateBits + depthBits);
+    if (pass == RenderPass::Transparent) {
+        uint64_t invertedDepth = ((uint64_t(1) << depthBits) - 1) - quantizedDepth;
+        key |= (invertedDepth << stateBits) | state;
+    }
+    else {
+        key |= (state << depthBits) | quantizedDepth;
+    }
+    return key;
+}
+
+void RenderQueue::radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch) {
+    if (entries.size() < 2) {
+        return;
+    }
+
+    // One histogram per key byte, all filled in a single pass over the entries
+    size_t counts[8][256] = {};
+    for (const SortEntry& entry : entries) {
+        for (int byte = 0; byte < 8; ++byte) {
+            ++counts[byte][(entry.key >> (byte * 8)) & 0xFF];
+        }
+    }
+
+    scratch.resize(entries.size());
+    for (int byte = 0; byte < 8; ++byte) {
+        size_t* count = counts[byte];
+        const uint8_t firstDigit = static_cast<uint8_t>((entries[0].key >> (byte * 8)) & 0xFF);
+        if (count[firstDigit] == entries.size()) {
+            continue; // Every key has the same digit here, the order would not change
+        }
+
+        size_t offset = 0;
+        for (int digit = 0; digit < 256; ++digit) {
+            size_t digitCount = count[digit];
+            count[digit] = offset;
+            offset += digitCount;
+        }
+        for (const SortEntry& entry : entries) {
+            scratch[count[(entry.key >> (byte * 8)) & 0xFF]++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
+
+void RenderQueue::sort() {
+    auto start = Clock::now();
+    radixSort(entries, scratch);
+    stats.sortMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void RenderQueue::submit() {
+    auto start = Clock::now();
+
+    // The skybox and uploads ran since the last submit and bypassed the cache
+    GLStateCache& glState = GLStateCache::instance();
+    glState.invalidate();
+
+    if (storageAlignment == 0) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        storageAlignment = static_cast<size_t>(std::max(alignment, 16));
+        multiDrawSupported = GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_draw_parameters;
+    }
+    objectBuffer.beginFrame();
+    indirectCommands.beginFrame();
+    // Sized from the queue so the frame rarely has to move to a larger buffer halfway
+    objectBuffer.reserve(items.size() * sizeof(ObjectData) * 2);
+    indirectCommands.reserve(items.size() * sizeof(DrawElementsIndirectCommand));
+    stats.draws = 0;
+    stats.instancedDraws = 0;
+    stats.multiDraws = 0;
+    stats.indirectCommands = 0;
+    stats.bindlessTextureSets = 0;
+    stats.instances = 0;
+
+    // Opaque entries sort first, the pass being the top of the key
+    const bool gpuCulling = multiDrawSupported && gpuCuller->isAvailable();
+    const size_t opaqueEnd = static_cast<size_t>(std::find_if(entries.begin(), entries.end(),
+        [](const SortEntry& entry) { return passOfKey(entry.key) != RenderPass::Opaque; }) - entries.begin());
+    culledBatches.clear();
+    if (gpuCulling) {
+        prepareCulledBatches(opaqueEnd);
+    }
+
+    DrawState state;
+    size_t nextCulledBatch = 0;
+    for (size_t i = 0; i < entries.size();) {
+        if (gpuCulling && i == opaqueEnd) {
+            submitDisoccluded(state);
+        }
+        if (nextCulledBatch < culledBatches.size() && culledBatches[nextCulledBatch].first == i) {
+            drawCulledBatch(culledBatches[nextCulledBatch], false, state);
+            i = culledBatches[nextCulledBatch++].end;
+            continue;
+        }
+
+        const DrawItem& item = items[entries[i].item];
+        if (item.staticGeometry) {
+            size_t batched = submitBatch(i, state);
+            if (batched > 0) {
+                i += batched;
+                continue;
+            }
+            // No instanced variant, the matrices go through uniforms
+            item.staticGeometry->submit(item.object, item.lod, state);
+        }
+        else {
+            item.animatedGeometry->submit(item.object.model, item.animator, state);
+        }
+        ++stats.draws;
+        ++i;
+    }
+    if (gpuCulling) {
+        if (opaqueEnd == entries.size()) {
+            submitDisoccluded(state);
+        }
+        gpuCuller->endFrame();
+    }
+    objectBuffer.endFrame();
+    indirectCommands.endFrame();
+
+    // Leave nothing bound that later buffer uploads could modify by accident
+    glState.bindVertexArray(0);
+    glState.activeTexture(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR) {
+        std::cerr << "[RenderQueue] OpenGL error after submitting " << entries.size() << " draws: " << error << std::endl;
+    }
+
+    stats.items = entries.size();
+    stats.programChanges = state.programChanges;
+    stats.materialChanges = state.materialChanges;
+    stats.textureChanges = state.textureChanges;
+    stats.vaoChanges = state.vaoChanges;
+    stats.submitMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+size_t RenderQueue::batchEnd(size_t first) const {
+    const DrawItem& head = items[entries[first].item];
+    if (!head.staticGeometry->supportsInstancing()) {
+        return first;
+    }
+
+    // Same mesh and LOD can always share a call, other meshes only through multi-draw
+    size_t end = first + 1;
+    while (end < entries.size()) {
+        const DrawItem& next = items[entries[end].item];
+        const bool sameMesh = next.staticGeometry == head.staticGeometry && next.lod == head.lod;
+        if (!sameMesh && !(multiDrawSupported && next.staticGeometry && head.staticGeometry->canBatchWith(*next.staticGeometry))) {
+            break;
+        }
+        ++end;
+    }
+    return end;
+}
+
+size_t RenderQueue::submitBatch(size_t first, DrawState& state) {
+    const size_t end = batchEnd(first);
+    if (end == first) {
+        return 0;
+    }
+
+    const DrawItem& head = items[entries[first].item];
+    const size_t count = end - first;
+
+    // One command per run of the same mesh, its instances are consecutive in the object range
+    objectScratch.clear();
+    commandScratch.clear();
+    commandGeometries.clear();
+    const DrawItem* previous = nullptr;
+    for (size_t i = first; i < end; ++i) {
+        const DrawItem& item = items[entries[i].item];
+        if (previous && previous->staticGeometry == item.staticGeometry && previous->lod == item.lod) {
+            ++commandScratch.back().instanceCount;
+        }
+        else {
+            commandScratch.push_back(item.staticGeometry->getDrawCommand(item.lod, 1, static_cast<GLuint>(objectScratch.size())));
+            commandGeometries.push_back(item.staticGeometry);
+        }
+        objectScratch.push_back(item.object);
+        previous = &item;
+    }
+
+    const size_t size = objectScratch.size() * sizeof(ObjectData);
+    const size_t offset = objectBuffer.write(objectScratch.data(), size, storageAlignment);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, objectBindingPoint, objectBuffer.getBuffer(),
+        static_cast<GLintptr>(offset), static_cast<GLsizeiptr>(size));
+    if (head.staticGeometry->usesBindlessTextures()) {
+        bindTextureSets();
+    }
+
+    if (commandScratch.size() == 1) {
+        head.staticGeometry->submitInstanced(static_cast<GLsizei>(count), head.lod, state);
+        ++stats.instancedDraws;
+    }
+    else {
+        const size_t commandOffset = indirectCommands.write(commandScratch.data(),
+            commandScratch.size() * sizeof(DrawElementsIndirectCommand), sizeof(GLuint));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectCommands.getBuffer());
+        head.staticGeometry->submitIndirect(static_cast<GLintptr>(commandOffset), static_cast<GLsizei>(commandScratch.size()), state);
+        ++stats.multiDraws;
+        stats.indirectCommands += commandScratch.size();
+    }
+
+    ++stats.draws;
+    stats.instances += count;
+    return count;
+}
+
+void RenderQueue::prepareCulledBatches(size_t opaqueEnd) {
+    // Every run of opaque static draws goes to the GPU, single draws included, so each has a visibility test
+    gpuCuller->beginFrame(storageAlignment);
+    for (size_t i = 0; i < opaqueEnd;) {
+        const size_t end = items[entries[i].item].staticGeometry ? batchEnd(i) : i;
+        if (end == i) {
+            ++i;
+            continue;
+        }
+
+        CulledBatch batch{ i, end, gpuCuller->getCommandCount(), 0, gpuCuller->beginBatch(), 0 };
+        const DrawItem* previous = nullptr;
+        for (size_t j = i; j < end; ++j) {
+            const DrawItem& item = items[entries[j].item];
+            if (!previous || previous->staticGeometry != item.staticGeometry || previous->lod != item.lod) {
+                gpuCuller->addCommand(item.staticGeometry->getDrawCommand(item.lod, 0, batch.objectCount));
+            }
+            gpuCuller->addObject(item.object, item.staticGeometry->getBounds());
+            ++batch.objectCount;
+            previous = &item;
+        }
+        batch.commandCount = gpuCuller->getCommandCount() - batch.firstCommand;
+        culledBatches.push_back(batch);
+        stats.instances += batch.objectCount;
+        i = end;
+    }
+    gpuCuller->cullLastVisible();
+}
+
+void RenderQueue::drawCulledBatch(const CulledBatch& batch, bool disoccluded, DrawState& state) {
+    const DrawItem& head = items[entries[batch.first].item];
+    const GLintptr commandOffset = gpuCuller->bindBatch(disoccluded ? GpuCuller::Phase::Disoccluded : GpuCuller::Phase::LastVisible,
+        batch.firstCommand, batch.firstObject, batch.objectCount);
+    if (head.staticGeometry->usesBindlessTextures()) {
+        commandGeometries.clear();
+        const DrawItem* previous = nullptr;
+        for (size_t i = batch.first; i < batch.end; ++i) {
+            const DrawItem& item = items[entries[i].item];
+            if (!previous || previous->staticGeometry != item.staticGeometry || previous->lod != item.lod) {
+                commandGeometries.push_back(item.staticGeometry);
+            }
+            previous = &item;
+        }
+        bindTextureSets();
+    }
+
+    head.staticGeometry->submitIndirect(commandOffset, static_cast<GLsizei>(batch.commandCount), state);
+    ++stats.draws;
+    ++stats.multiDraws;
+    stats.indirectCommands += batch.commandCount;
+}
+
+void RenderQueue::submitDisoccluded(DrawState& state) {
+    if (culledBatches.empty()) {
+        return;
+    }
+
+    gpuCuller->cullDisoccluded();
+    // The culling programs and the Hi-Z texture replaced what the last draw left bound
+    state.program = 0;
+    state.texturesBound = false;
+    for (const CulledBatch& batch : culledBatches) {
+        drawCulledBatch(batch, true, state);
+    }
+}
+
+void RenderQueue::bindTextureSets() {
+    // Commands of the same texture set share one entry. Each command draws a single geometry, so
+    // the set read through gl_DrawID stays uniform across the command.
+    drawTextureSets.clear();
+    textureSetKeys.clear();
+    textureHandles.clear();
+    for (const StaticGeometry* geometry : commandGeometries) {
+        const uint64_t key = geometry->getTextureSetKey();
+        auto found = std::find(textureSetKeys.begin(), textureSetKeys.end(), key);
+        if (found == textureSetKeys.end()) {
+            textureSetKeys.push_back(key);
+            textureHandles.resize(textureHandles.size() + BindlessTextures::slotsPerSet);
+            BindlessTextures::fillTextureSet(geometry->getTextures(), textureHandles.data() + textureHandles.size() - BindlessTextures::slotsPerSet);
+            found = textureSetKeys.end() - 1;
+        }
+        drawTextureSets.push_back(static_cast<uint32_t>(found - textureSetKeys.begin()));
+    }
+
+    const size_t setsSize = drawTextureSets.size() * sizeof(uint32_t);
+    const size_t setsOffset = objectBuffer.write(drawTextureSets.data(), setsSize, storageAlignment);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BindlessTextures::drawTextureSetsBindingPoint, objectBuffer.getBuffer(),
+        static_cast<GLintptr>(setsOffset), static_cast<GLsizeiptr>(setsSize));
+
+    const size_t handlesSize = textureHandles.size() * sizeof(uint64_t);
+    const size_t handlesOffset = objectBuffer.write(textureHandles.data(), handlesSize, storageAlignment);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BindlessTextures::materialTexturesBindingPoint, objectBuffer.getBuffer(),
+        static_cast<GLintptr>(handlesOffset), static_cast<GLsizeiptr>(handlesSize));
+
+    stats.bindlessTextureSets += textureSetKeys.size();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "rendering/GpuRingBuffer.h"
+
+class StaticGeometry;
+class AnimatedGeometry;
+class Animator;
+class Material;
+class GpuCuller;
+struct GpuCullingStats;
+
+enum class RenderPass : uint8_t {
+    Opaque = 0,      // Sorted by state, then front to back
+    Transparent = 1  // Sorted back to front, then by state
+};
+
+struct RenderQueueStats {
+    size_t items = 0;
+    size_t draws = 0;          // Draw calls issued, an instanced draw counts once
+    size_t instancedDraws = 0;
+    size_t multiDraws = 0;
+    size_t indirectCommands = 0;
+    size_t bindlessTextureSets = 0; // Texture sets sampled through bindless handles instead of binds
+    size_t instances = 0;      // Items drawn through instanced or multi-draw calls
+    size_t programChanges = 0;
+    size_t materialChanges = 0;
+    size_t textureChanges = 0;
+    size_t vaoChanges = 0;
+    double sortMs = 0.0;
+    double submitMs = 0.0;
+};
+
+// Per-object data of a static draw, laid out as the std430 ObjectData struct of the batched shaders.
+// The normal matrix is cached by the owner and only recomputed when its transform changes.
+struct ObjectData {
+    glm::mat4 model;
+    glm::mat4 previousModel;   // Last frame's model matrix, for motion vectors
+    glm::mat3x4 normalMatrix;  // mat3 with std430 column padding
+    uint32_t materialIndex = 0; // Material id of the draw within the queue's frame
+    uint32_t visibilitySlot = 0; // Where GPU culling keeps the object's visibility between frames, 0 for none
+    uint32_t _padding[2] = {};
+
+    ObjectData() = default;
+    explicit ObjectData(const glm::mat4& transform);
+
+    glm::mat3 getNormalMatrix() const { return glm::mat3(normalMatrix); }
+    static glm::mat3x4 packNormalMatrix(const glm::mat4& transform);
+};
+static_assert(sizeof(ObjectData) == 192, "ObjectData must match the std430 layout of the shaders");
+
+// Layout read by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+// GL state left behind by the previous draw of a queue, so a draw only changes what differs from it.
+// A default constructed state matches nothing and makes the next draw set everything.
+struct DrawState {
+    GLuint program = 0;
+    const Material* material = nullptr;
+    bool materialApplied = false;
+    uint64_t textureSet = 0;
+    bool texturesBound = false;
+    GLuint vao = 0;
+
+    size_t programChanges = 0;
+    size_t materialChanges = 0;
+    size_t textureChanges = 0;
+    size_t vaoChanges = 0;
+};
+
+// Collects the draws of one frame during scene traversal, sorts them by a 64-bit key and submits them
+// in that order. Opaque keys, from the most significant bit:
+//   pass:2 | program:12 | material:12 | texture set:12 | VAO:10 | depth:16
+// Transparent keys put the inverted depth right after the pass so blending stays back to front:
+//   pass:2 | inverted depth:16 | program:12 | material:12 | texture set:12 | VAO:10
+// Programs, materials, texture sets and VAOs are numbered in order of first use each frame, so the
+// fields stay small. Should a frame ever use more than a field can hold, draws only sort less tightly.
+// Sorting leaves draws with the same state next to each other. Runs of static draws, down to a single
+// one, are submitted as one batch, their ObjectData streamed to objectBindingPoint: a single mesh
+// becomes one instanced call, several meshes sharing an arena page become one
+// glMultiDrawElementsIndirect call with a command per mesh, each addressing its objects through
+// its base instance. Only shaders without an instanced variant still take the model and normal
+// matrices as uniforms per draw.
+// With compute shaders and a depth source, the opaque static batches are instead culled by a GpuCuller:
+// their objects visible last frame are drawn in place, the ones that come into view are drawn once the
+// other opaque draws are done, before the transparent pass.
+class RenderQueue {
+public:
+    static constexpr GLuint objectBindingPoint = 2;
+
+    RenderQueue();
+    ~RenderQueue();
+
+    // Clears the previous frame. Depth is measured along viewDirection and normalized by farPlane.
+    void begin(const glm::vec3& viewPosition, const glm::vec3& viewDirection, float farPlane);
+
+    void add(StaticGeometry& geometry, const ObjectData& object);
+    void add(AnimatedGeometry& geometry, const glm::mat4& transform, Animator* animator);
+
+    void sort();
+    void submit();
+
+    // Depth buffer the opaque draws write, the GPU culling tests against it. Without one nothing is culled on the GPU.
+    void setOcclusionDepth(GLuint depthTexture, int width, int height);
+    void setViewProjection(const glm::mat4& viewProjection);
+
+    const glm::vec3& getViewPosition() const { return viewPosition; }
+    size_t size() const { return items.size(); }
+    const RenderQueueStats& getStats() const { return stats; }
+    const GpuCullingStats& getGpuCullingStats() const;
+
+    // LSD radix sort on the 64-bit keys. Skips the byte passes in which every key agrees.
+    struct SortEntry {
+        uint64_t key;
+        uint32_t item;
+    };
+    static void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+private:
+    struct DrawItem {
+        ObjectData object;
+        StaticGeometry* staticGeometry;
+        AnimatedGeometry* animatedGeometry;
+        Animator* animator;
+        int lod; // Captured when added, a geometry can be placed at several distances
+    };
+
+    // Opaque static draws handed to the GPU culling as one multi-draw
+    struct CulledBatch {
+        size_t first;  // Entries
+        size_t end;
+        uint32_t firstCommand;
+        uint32_t commandCount;
+        uint32_t firstObject;
+        uint32_t objectCount;
+    };
+
+    size_t batchEnd(size_t first) const;
+    size_t submitBatch(size_t first, DrawState& state);
+    void prepareCulledBatches(size_t opaqueEnd);
+    void drawCulledBatch(const CulledBatch& batch, bool disoccluded, DrawState& state);
+    void submitDisoccluded(DrawState& state);
+    void bindTextureSets();
+
+    uint64_t makeKey(RenderPass pass, GLuint program, const Material* material, uint64_t textureSet, GLuint vao,
+        const glm::mat4& transform, const glm::vec3& aabbMin, const glm::vec3& aabbMax);
+    void push(const DrawItem& item, uint64_t key);
+    static uint32_t intern(std::unordered_map<uint64_t, uint32_t>& ids, uint64_t value);
+
+    std::vector<DrawItem> items;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+
+    std::unordered_map<uint64_t, uint32_t> programIds;
+    std::unordered_map<uint64_t, uint32_t> materialIds;
+    std::unordered_map<uint64_t, uint32_t> textureSetIds;
+    std::unordered_map<uint64_t, uint32_t> vaoIds;
+
+    GpuRingBuffer objectBuffer;
+    std::vector<ObjectData> objectScratch;
+    GpuRingBuffer indirectCommands;
+    std::vector<DrawElementsIndirectCommand> commandScratch;
+    std::vector<const StaticGeometry*> commandGeometries;
+    std::vector<uint32_t> drawTextureSets;
+    std::vector<uint64_t> textureSetKeys;
+    std::vector<uint64_t> textureHandles;
+    size_t storageAlignment = 0;
+    bool multiDrawSupported = false;
+
+    std::unique_ptr<GpuCuller> gpuCuller;
+    std::vector<CulledBatch> culledBatches;
+
+    glm::vec3 viewPosition = glm::vec3(0.0f);
+    glm::vec3 viewDirection = glm::vec3(0.0f, 0.0f, -1.0f);
+    float farPlane = 1.0f;
+    RenderQueueStats stats;
+};
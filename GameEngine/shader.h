@@ -3,17 +3,52 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <GL/glew.h>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// Uniform resolved once against a program, set without any name lookup afterwards.
+// T is the GLSL type the caller expects; resolving against a uniform of another type fails.
+template <typename T>
+struct Uniform {
+    GLint location = -1;
+    GLint arraySize = 0;
+
+    bool isValid() const { return location >= 0; }
+};
+
+struct UniformBlockInfo {
+    uint64_t hash = 0;
+    GLenum interface = GL_UNIFORM_BLOCK; // GL_UNIFORM_BLOCK or GL_SHADER_STORAGE_BLOCK
+    GLuint index = GL_INVALID_INDEX;
+    GLint binding = 0;
+    GLint dataSize = 0;
+};
+
 class Shader {
 public:
     GLuint Program;
 
+    // FNV-1a over the name. Names are hashed the same way when the program is reflected.
+    static constexpr uint64_t hashName(std::string_view name) {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
     // Constructor: unchanged
-    Shader(const std::string& vertexPath, const std::string& fragmentPath);
+    // Each define is inserted as "#define <define>" after the #version line of both stages
+    Shader(const std::string& vertexPath, const std::string& fragmentPath, const std::vector<std::string>& defines = {});
+
+    // Compute program from a single source, defines inserted the same way. nullptr when it fails to build.
+    static std::unique_ptr<Shader> createCompute(const std::string& computePath, const std::vector<std::string>& defines = {});
 
     // Destructor
     ~Shader();
@@ -23,7 +58,11 @@ public:
     Shader& operator=(const Shader&) = delete;
 
     // Implement move constructor
-    Shader(Shader&& other) noexcept : Program(other.Program) {
+    Shader(Shader&& other) noexcept
+        : Program(other.Program), uniforms(std::move(other.uniforms)), blocks(std::move(other.blocks)),
+        vertexPath(std::move(other.vertexPath)), fragmentPath(std::move(other.fragmentPath)),
+        instancedVariant(std::move(other.instancedVariant)), instancedVariantBuilt(other.instancedVariantBuilt),
+        packedVertexVariant(std::move(other.packedVertexVariant)) {
         other.Program = 0; // Transfer ownership and prevent deletion by moved-from object
     }
 
@@ -34,12 +73,48 @@ public:
                 glDeleteProgram(Program);
             }
             Program = other.Program;
+            uniforms = std::move(other.uniforms);
+            blocks = std::move(other.blocks);
+            vertexPath = std::move(other.vertexPath);
+            fragmentPath = std::move(other.fragmentPath);
+            instancedVariant = std::move(other.instancedVariant);
+            instancedVariantBuilt = other.instancedVariantBuilt;
+            packedVertexVariant = std::move(other.packedVertexVariant);
             other.Program = 0; // Transfer ownership and prevent deletion by moved-from object
         }
         return *this;
     }
 
     void use() const;
+
+    // Resolves a uniform from the table built at link time. Arrays resolve by their bare name or by
+    // element ("bones" or "bones[3]"). An invalid handle is returned for missing or mistyped uniforms.
+    template <typename T>
+    Uniform<T> getUniform(std::string_view name) const;
+
+    void set(Uniform<int> uniform, int value) const;
+    void set(Uniform<float> uniform, float value) const;
+    void set(Uniform<glm::vec2> uniform, const glm::vec2& value) const;
+    void set(Uniform<glm::vec3> uniform, const glm::vec3& value) const;
+    void set(Uniform<glm::vec4> uniform, const glm::vec4& value) const;
+    void set(Uniform<glm::mat3> uniform, const glm::mat3& value) const;
+    void set(Uniform<glm::mat4> uniform, const glm::mat4& value) const;
+    void set(Uniform<glm::mat4x3> uniform, const glm::mat4x3& value) const;
+    // Sets count consecutive elements of an array starting at the handle, clamped to the array size
+    void setArray(Uniform<glm::mat4x3> uniform, const glm::mat4x3* values, GLsizei count) const;
+
+    // The same sources compiled with INSTANCED defined, built on first use. nullptr when the shader
+    // has no instanced path (no ObjectBuffer block). With ARB_bindless_texture BINDLESS is
+    // defined too; shaders that support it then read their textures from the MaterialTextures block.
+    std::shared_ptr<Shader> getInstancedVariant() const;
+    // The same sources compiled with PACKED_VERTICES defined, built on first use, for meshes in the
+    // packed vertex layout. That layout has no bitangent stream, the shader rebuilds it instead.
+    std::shared_ptr<Shader> getPackedVertexVariant() const;
+
+    // Active uniform and shader storage blocks, or nullptr
+    const UniformBlockInfo* findUniformBlock(std::string_view name) const;
+
+    // The name-based setters look the name up in the reflected table, never in the driver
     void setMat4x3(const std::string& name, const glm::mat4x3& mat) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
     void setMat3(const std::string& name, const glm::mat3& mat) const;
@@ -53,5 +128,53 @@ public:
     bool isProgramLinkedSuccessfully() const;
 
 private:
+    Shader() : Program(0) {}
+
+    struct UniformInfo {
+        uint64_t hash;
+        GLint location;
+        GLenum type;
+        GLint arraySize;
+    };
+
     void checkCompileErrors(GLuint shader, std::string type);
+    void reflect();
+    const UniformInfo* findUniform(uint64_t hash) const;
+    GLint locationOf(std::string_view name) const;
+    static bool typeMatches(GLenum expected, GLenum actual);
+
+    std::vector<UniformInfo> uniforms; // Sorted by hash
+    std::vector<UniformBlockInfo> blocks;
+    std::string vertexPath;
+    std::string fragmentPath;
+    mutable std::shared_ptr<Shader> instancedVariant;
+    mutable bool instancedVariantBuilt = false;
+    mutable std::shared_ptr<Shader> packedVertexVariant;
 };
+
+template <typename T> struct UniformType;
+template <> struct UniformType<int> { static constexpr GLenum value = GL_INT; };
+template <> struct UniformType<float> { static constexpr GLenum value = GL_FLOAT; };
+template <> struct UniformType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template <> struct UniformType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template <> struct UniformType<glm::mat3> { static constexpr GLenum value = GL_FLOAT_MAT3; };
+template <> struct UniformType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+template <> struct UniformType<glm::mat4x3> { static constexpr GLenum value = GL_FLOAT_MAT4x3; };
+
+template <typename T>
+Uniform<T> Shader::getUniform(std::string_view name) const {
+    Uniform<T> uniform;
+    const UniformInfo* info = findUniform(hashName(name));
+    if (!info) {
+        return uniform;
+    }
+    if (!typeMatches(UniformType<T>::value, info->type)) {
+        std::cerr << "[Shader] Uniform " << name << " has GL type 0x" << std::hex << info->type << std::dec
+            << ", not the type it was requested as" << std::endl;
+        return uniform;
+    }
+    uniform.location = info->location;
+    uniform.arraySize = info->arraySize;
+    return uniform;
+}
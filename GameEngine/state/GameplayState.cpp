@@ -7,56 +7,59 @@ void GameplayState::enter() {
     // Create the scene root node
     sceneRoot = std::make_unique<Node>("SceneRoot");
 
-    // Load static geometry
-    std::string staticModelPath = FileSystemUtils::getAssetFilePath("models/tutorial.fbx");
-    std::string staticMaterialPath = FileSystemUtils::getAssetFilePath("materials/tutorial.txt");
-    auto staticRenderables = ModelLoader::loadModel(staticModelPath, staticMaterialPath);
-
-    // Load animated geometry
-    std::string animatedModelPath = FileSystemUtils::getAssetFilePath("models/masterchief_no_lods.fbx");
-    std::string animatedMaterialPath = FileSystemUtils::getAssetFilePath("materials/masterchief_no_lods.txt");
-    auto animatedRenderables = ModelLoader::loadModel(animatedModelPath, animatedMaterialPath);
+    // Stream the models in the background, nodes join the scene graph as their GPU resources are created
+    AsyncModelLoader& modelLoader = AsyncModelLoader::instance();
 
-    // Add static renderables to the scene graph
-    const glm::vec3 staticNodeScale(0.025f, 0.025f, 0.025f);
-    const glm::vec3 staticNodeRotationAxis(1.0f, 0.0f, 0.0f);
-    const float staticNodeRotationAngle = glm::radians(-90.0f);
+    // Load static geometry
+    ModelLoadRequest staticRequest;
+    staticRequest.modelPath = FileSystemUtils::getAssetFilePath("models/tutorial.fbx");
+    staticRequest.materialPath = FileSystemUtils::getAssetFilePath("materials/tutorial.txt");
+    staticRequest.vertexFormat = VertexFormat::Packed;
+    staticRequest.retention = GeometryRetention::CollisionOnly;
+    staticRequest.onNodeReady = [this](std::unique_ptr<RenderableNode> renderable, const ModelHandle&) {
+        // Add static renderables to the scene graph
+        const glm::vec3 staticNodeScale(0.025f, 0.025f, 0.025f);
+        const glm::vec3 staticNodeRotationAxis(1.0f, 0.0f, 0.0f);
+        const float staticNodeRotationAngle = glm::radians(-90.0f);
 
-    for (auto& renderable : staticRenderables) {
         renderable->setScale(staticNodeScale);
         renderable->setRotation(glm::angleAxis(staticNodeRotationAngle, staticNodeRotationAxis));
         sceneRoot->addChild(std::move(renderable));
-    }
+    };
+    modelHandles.push_back(modelLoader.loadModel(std::move(staticRequest)));
 
-    // Add animated renderables to the scene graph
-    const glm::vec3 animatedNodeScale(0.025f, 0.025f, 0.025f);
-    const glm::vec3 animatedNodeRotationAxis(1.0f, 0.0f, 0.0f);
-    const float animatedNodeRotationAngle = glm::radians(-90.0f);
+    // Load animated geometry
+    ModelLoadRequest animatedRequest;
+    animatedRequest.modelPath = FileSystemUtils::getAssetFilePath("models/masterchief_no_lods.fbx");
+    animatedRequest.materialPath = FileSystemUtils::getAssetFilePath("materials/masterchief_no_lods.txt");
+    animatedRequest.animationPath = FileSystemUtils::getAssetFilePath("models/combat_sword_idle.fbx");
+    animatedRequest.vertexFormat = VertexFormat::Packed;
+    animatedRequest.retention = GeometryRetention::None;
+    animatedRequest.lodManager = std::make_shared<LODManager>(std::vector<float>{ 15.0f, 30.0f, 60.0f });
+#if BENCHMARK_MODEL_IMPORT
+    ModelLoader::benchmarkImport(animatedRequest.modelPath);
+#endif
+    animatedRequest.onNodeReady = [this](std::unique_ptr<RenderableNode> renderable, const ModelHandle& handle) {
+        // Add animated renderables to the scene graph
+        const glm::vec3 animatedNodeScale(0.025f, 0.025f, 0.025f);
+        const glm::vec3 animatedNodeRotationAxis(1.0f, 0.0f, 0.0f);
+        const float animatedNodeRotationAngle = glm::radians(-90.0f);
 
-    for (auto& renderable : animatedRenderables) {
         renderable->setScale(animatedNodeScale);
         renderable->setRotation(glm::angleAxis(animatedNodeRotationAngle, animatedNodeRotationAxis));
 
-        // Load the animation file based on the mesh name
-        std::string animationPath = FileSystemUtils::getAssetFilePath("models/combat_sword_idle.fbx");
-
-        // Check if the animation file exists
-        if (std::filesystem::exists(animationPath)) {
-            // Load the animation
-            auto animation = std::make_shared<Animation>(animationPath, ModelLoader::getBoneInfoMap());
-
+        // The animation was loaded on the worker against this model's skeleton
+        if (handle.getAnimation()) {
             // Create an Animator instance using the shared_ptr directly
-            auto animator = std::make_shared<Animator>(animation);
+            auto animator = std::make_shared<Animator>(handle.getAnimation());
 
             // Set the Animator in the renderable node
             renderable->setAnimator(std::move(animator));
         }
-        else {
-            std::cout << "Animation file not found for mesh: " << "masterchief" << std::endl;
-        }
 
         sceneRoot->addChild(std::move(renderable));
-    }
+    };
+    modelHandles.push_back(modelLoader.loadModel(std::move(animatedRequest)));
 
     auto audioManager = GameStateManager::instance().getAudioManager();
     if (audioManager) {
@@ -76,6 +79,14 @@ void GameplayState::enter() {
 
 void GameplayState::exit() {
     std::cout << "Exiting Gameplay State" << std::endl;
+
+    // Streaming callbacks refer to this state's scene graph
+    for (auto& handle : modelHandles) {
+        handle->cancel();
+    }
+    AsyncModelLoader::instance().update();
+    modelHandles.clear();
+
     // Cleanup gameplay resources, save game state if necessary
 }
 
@@ -101,6 +112,9 @@ void GameplayState::update(float deltaTime) {
         audioManager->updateListenerPosition(irrCameraPos, irrCameraFront, irrCameraUp);
     }
 
+    // Hand finished model loads to the scene graph without stalling the frame
+    AsyncModelLoader::instance().update();
+
     // Update the scene graph
     sceneRoot->update(deltaTime);
 }
@@ -125,6 +139,62 @@ void GameplayState::render() {
     ImGui::SetNextWindowSize(ImVec2(0.0f, 0.0f)); // Auto resize window size
     ImGui::Begin("Performance", NULL, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove);
     ImGui::Text("Average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+    if (AsyncModelLoader::instance().getPendingCount() > 0) {
+        ImGui::Text("Loading models... (%zu pending)", AsyncModelLoader::instance().getPendingCount());
+    }
+    TextureCacheStats textureStats = TextureManager::instance().getStats();
+    ImGui::Text("Textures: %zu resident, %.1f MB (%llu hits, %llu misses)", textureStats.liveTextures, textureStats.residentBytes / (1024.0 * 1024.0),
+        static_cast<unsigned long long>(textureStats.hits), static_cast<unsigned long long>(textureStats.misses));
+    const GeometryMemoryStats& geometryStats = GeometryMemory::instance().getStats();
+    ImGui::Text("CPU geometry: %.1f MB retained, %.1f MB released (%zu meshes)", geometryStats.retainedBytes / (1024.0 * 1024.0),
+        geometryStats.releasedBytes / (1024.0 * 1024.0), geometryStats.geometries);
+    MeshArenaStats arenaStats = MeshBufferArena::instance().getStats();
+    if (arenaStats.pages > 0) {
+        ImGui::Text("GPU geometry: %.1f / %.1f MB in %zu pages, %zu meshes (%.0f%% fragmented, %zu pages released)",
+            (arenaStats.vertexUsedBytes + arenaStats.indexUsedBytes) / (1024.0 * 1024.0),
+            (arenaStats.vertexCapacityBytes + arenaStats.indexCapacityBytes) / (1024.0 * 1024.0), arenaStats.pages,
+            arenaStats.allocations, arenaStats.fragmentation * 100.0f, arenaStats.pagesReleased);
+    }
+    if (std::shared_ptr<Renderer> renderer = GameStateManager::instance().getRenderer()) {
+        const RenderQueueStats& queueStats = renderer->getRenderQueueStats();
+        ImGui::Text("Draws: %zu for %zu items (%zu programs, %zu materials, %zu texture sets, %zu VAOs)", queueStats.draws, queueStats.items,
+            queueStats.programChanges, queueStats.materialChanges, queueStats.textureChanges, queueStats.vaoChanges);
+        if (queueStats.instancedDraws > 0 || queueStats.multiDraws > 0) {
+            ImGui::Text("Batching: %zu items in %zu instanced draws and %zu multi-draws (%zu commands)", queueStats.instances,
+                queueStats.instancedDraws, queueStats.multiDraws, queueStats.indirectCommands);
+        }
+        if (queueStats.bindlessTextureSets > 0) {
+            ImGui::Text("Bindless: %zu texture sets sampled without binds", queueStats.bindlessTextureSets);
+        }
+        ImGui::Text("Render queue: sort %.3f ms, submit %.3f ms", queueStats.sortMs, queueStats.submitMs);
+        const CullingStats& cullStats = renderer->getCullingStats();
+        ImGui::Text("Culling: %zu visible, %zu culled (%zu nodes tested, %zu rejected, %zu inside), %.3f ms", cullStats.objectsVisible,
+            cullStats.objectsCulled, cullStats.nodesTested, cullStats.nodesCulled, cullStats.nodesInside, cullStats.cullMs);
+        const OcclusionStats& occlusionStats = renderer->getOcclusionStats();
+        ImGui::Text("Occlusion: %zu of %zu culled, %zu occluders (%zu triangles), raster %.3f ms, test %.3f ms", occlusionStats.occluded,
+            occlusionStats.tested, occlusionStats.occluders, occlusionStats.occluderTriangles, occlusionStats.rasterMs, occlusionStats.testMs);
+        const GpuCullingStats& gpuStats = renderer->getGpuCullingStats();
+        if (gpuStats.objects > 0) {
+            ImGui::Text("GPU culling: %zu objects, %zu commands, drawn %zu + %zu disoccluded, %zu occluded, %zu outside, %d Hi-Z levels",
+                gpuStats.objects, gpuStats.commands, gpuStats.drawnLastVisible, gpuStats.drawnDisoccluded, gpuStats.occluded,
+                gpuStats.outsideFrustum, gpuStats.hiZLevels);
+        }
+        const SceneIndex& sceneIndex = renderer->getSceneIndex();
+        DynamicBVHStats bvhStats = sceneIndex.getStats();
+        ImGui::Text("Scene BVH: %zu nodes, height %d, %zu refit this frame (%zu reinsertions, %zu rotations)", bvhStats.proxies,
+            bvhStats.height, sceneIndex.getUpdatedCount(), bvhStats.reinsertions, bvhStats.rotations);
+        const BonePaletteStats& paletteStats = BonePalette::instance().getStats();
+        if (paletteStats.palettes > 0) {
+            ImGui::Text("Skinning: %zu palettes, %zu bones, %.1f KB streamed", paletteStats.palettes, paletteStats.bones, paletteStats.bytes / 1024.0);
+        }
+        const GLStateStats& glStats = GLStateCache::instance().getStats();
+        ImGui::Text("GL state: %zu calls issued, %zu redundant skipped", glStats.issued, glStats.skipped);
+    }
+    const GpuUploadStats& uploadStats = GpuUploadQueue::instance().getStats();
+    if (uploadStats.queueDepth > 0 || uploadStats.uploadsLastFrame > 0) {
+        ImGui::Text("Uploads: %zu queued, %.1f KB pending", uploadStats.queueDepth, uploadStats.pendingBytes / 1024.0);
+        ImGui::Text("Upload time %.2f ms (peak %.2f ms), %.1f KB this frame", uploadStats.msLastFrame, uploadStats.peakMs, uploadStats.bytesLastFrame / 1024.0);
+    }
     ImVec2 perfWindowSize = ImGui::GetWindowSize(); // Get the window size for the Performance window
     ImGui::End();
 
@@ -10,6 +10,7 @@
 #include "GameStateManager.h"
 #include "FileSystemUtils.h"
 #include "ModelLoader.h"
+#include "geometry/AsyncModelLoader.h"
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
@@ -25,6 +26,7 @@ public:
 
 private:
     std::unique_ptr<Node> sceneRoot;
+    std::vector<std::shared_ptr<ModelHandle>> modelHandles;
 };
 
 #endif // GAMEPLAY_STATE_H
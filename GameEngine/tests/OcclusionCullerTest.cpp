@@ -0,0 +1,150 @@
+// Headless checks of the CPU occlusion culler, built apart from the engine:
+//   g++ -std=c++17 -O2 -I. -I<glm> tests/OcclusionCullerTest.cpp rendering/OcclusionCuller.cpp utilities/ThreadPool.cpp -pthread
+// Returns non-zero when a check fails.
+#include "rendering/OcclusionCuller.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char* name) {
+        std::printf("%s %s\n", condition ? "pass" : "FAIL", name);
+        if (!condition) {
+            ++failures;
+        }
+    }
+
+    const float nearPlane = 0.1f;
+    const glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, nearPlane, 100.0f);
+
+    // World x and y on the plane z = -distance that project to pixel x and y of the culler's buffer
+    float worldX(float pixel, float distance) {
+        return (pixel / OcclusionCuller::width * 2.0f - 1.0f) * distance / projection[0][0];
+    }
+
+    float worldY(float pixel, float distance) {
+        return (pixel / OcclusionCuller::height * 2.0f - 1.0f) * distance / projection[1][1];
+    }
+
+    // Facing the camera at z = -distance, split in columns x rows quads of two triangles each
+    OccluderMesh makeWall(float minX, float maxX, float minY, float maxY, float distance, int columns = 1, int rows = 1) {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+        for (int y = 0; y <= rows; ++y) {
+            for (int x = 0; x <= columns; ++x) {
+                positions.emplace_back(minX + (maxX - minX) * x / columns, minY + (maxY - minY) * y / rows, -distance);
+            }
+        }
+        for (int y = 0; y < rows; ++y) {
+            for (int x = 0; x < columns; ++x) {
+                const uint32_t corner = static_cast<uint32_t>(y * (columns + 1) + x);
+                const uint32_t above = corner + static_cast<uint32_t>(columns + 1);
+                indices.insert(indices.end(), { corner, corner + 1, above + 1, corner, above + 1, above });
+            }
+        }
+        return OccluderMesh::build(positions, indices);
+    }
+
+    // Thin box whose nearer face covers the pixel rectangle at distance, the farther one slightly less
+    BoundingBox pixelBox(float minPixelX, float maxPixelX, float minPixelY, float maxPixelY, float distance) {
+        return BoundingBox(glm::vec3(worldX(minPixelX, distance), worldY(minPixelY, distance), -distance * 1.01f),
+            glm::vec3(worldX(maxPixelX, distance), worldY(maxPixelY, distance), -distance));
+    }
+
+    void testThinGap() {
+        // Two walls 0.8 pixels apart, a box seen through the gap between them
+        const float distance = 10.0f;
+        OccluderMesh left = makeWall(worldX(0.0f, distance), worldX(128.6f, distance), worldY(0.0f, distance), worldY(128.0f, distance), distance);
+        OccluderMesh right = makeWall(worldX(129.4f, distance), worldX(256.0f, distance), worldY(0.0f, distance), worldY(128.0f, distance), distance);
+
+        OcclusionCuller culler;
+        culler.begin(projection, nearPlane);
+        culler.addOccluder(left, glm::mat4(1.0f));
+        culler.addOccluder(right, glm::mat4(1.0f));
+        culler.rasterize();
+
+        check(culler.isVisible(pixelBox(128.7f, 129.3f, 60.0f, 70.0f, 20.0f)), "box behind a gap of less than a pixel is visible");
+        check(!culler.isVisible(pixelBox(100.0f, 110.0f, 60.0f, 70.0f, 20.0f)), "box behind the left wall is occluded");
+    }
+
+    void testMeshEdges() {
+        // Internal edges of a tessellated wall leave no gaps in it
+        const float distance = 10.0f;
+        OccluderMesh wall = makeWall(worldX(40.0f, distance), worldX(216.0f, distance), worldY(20.0f, distance), worldY(108.0f, distance), distance, 4, 3);
+
+        OcclusionCuller culler;
+        culler.begin(projection, nearPlane);
+        culler.addOccluder(wall, glm::mat4(1.0f));
+        culler.rasterize();
+
+        check(!culler.isVisible(pixelBox(60.0f, 196.0f, 30.0f, 98.0f, 20.0f)), "box behind a tessellated wall is occluded");
+        check(culler.isVisible(pixelBox(60.0f, 196.0f, 30.0f, 98.0f, 5.0f)), "box in front of the wall is visible");
+        check(culler.isVisible(pixelBox(200.0f, 230.0f, 30.0f, 98.0f, 20.0f)), "box reaching past the wall is visible");
+    }
+
+    void testRandomWalls() {
+        // Boxes reported occluded must lie behind the wall entirely
+        const glm::mat4 viewProjection = projection;
+        std::mt19937 random(3);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        size_t occluded = 0;
+        size_t falseOcclusions = 0;
+        for (int scene = 0; scene < 200; ++scene) {
+            const float z = -5.0f - 20.0f * (unit(random) + 1.0f);
+            const float x = unit(random) * 10.0f;
+            const float y = unit(random) * 5.0f;
+            const float halfWidth = 1.0f + 4.0f * (unit(random) + 1.0f);
+            const float halfHeight = 1.0f + 3.0f * (unit(random) + 1.0f);
+            OccluderMesh wall = makeWall(x - halfWidth, x + halfWidth, y - halfHeight, y + halfHeight, -z, 3, 2);
+
+            OcclusionCuller culler;
+            culler.begin(viewProjection, nearPlane);
+            culler.addOccluder(wall, glm::mat4(1.0f));
+            culler.rasterize();
+
+            for (int i = 0; i < 200; ++i) {
+                const glm::vec3 center(unit(random) * 20.0f, unit(random) * 10.0f, -2.0f - 30.0f * (unit(random) + 1.0f));
+                const glm::vec3 extent(0.2f + unit(random) + 1.0f, 0.2f + unit(random) + 1.0f, 0.2f + unit(random) + 1.0f);
+                const BoundingBox box(center - extent, center + extent);
+                // Boxes reaching off screen are left to the frustum test
+                bool onScreen = true;
+                for (int corner = 0; corner < 8; ++corner) {
+                    const glm::vec3 position(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z);
+                    const glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+                    if (clip.w < nearPlane || std::abs(clip.x) > clip.w || std::abs(clip.y) > clip.w) {
+                        onScreen = false;
+                    }
+                }
+                if (!onScreen || culler.isVisible(box)) {
+                    continue;
+                }
+                ++occluded;
+
+                // Hidden when every corner lies behind the wall plane and projects onto the wall
+                bool hidden = true;
+                for (int corner = 0; corner < 8; ++corner) {
+                    const glm::vec3 position(corner & 1 ? box.max.x : box.min.x, corner & 2 ? box.max.y : box.min.y, corner & 4 ? box.max.z : box.min.z);
+                    const float scale = z / position.z;
+                    if (position.z > z || std::abs(position.x * scale - x) > halfWidth || std::abs(position.y * scale - y) > halfHeight) {
+                        hidden = false;
+                    }
+                }
+                if (!hidden) {
+                    ++falseOcclusions;
+                }
+            }
+        }
+        std::printf("     %zu random boxes occluded\n", occluded);
+        check(occluded > 0 && falseOcclusions == 0, "random boxes are only occluded when hidden");
+    }
+}
+
+int main() {
+    testThinGap();
+    testMeshEdges();
+    testRandomWalls();
+    return failures == 0 ? 0 : 1;
+}
@@ -1,77 +1,165 @@
 #include "TextureLoader.h"
+#include "rendering/GpuUploadQueue.h"
+#include <algorithm>
 
-std::map<std::string, GLuint> TextureLoader::cubemapCache = {};
+std::map<std::string, DecodedImage> TextureLoader::stagedImages = {};
+std::mutex TextureLoader::stagedImagesMutex;
 
-// Load a single 2D texture
-Texture TextureLoader::loadTexture(const std::string& path) {
-    Texture texture;
-    glGenTextures(1, &texture.id);
-    glBindTexture(GL_TEXTURE_2D, texture.id);
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+DecodedImage TextureLoader::decodeImage(const std::string& path) {
+    DecodedImage image;
+    unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
     if (data) {
-        GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(data);
+        image.pixels = std::shared_ptr<unsigned char>(data, stbi_image_free);
+    }
+    return image;
+}
+
+void TextureLoader::stageImage(const std::string& path, DecodedImage image) {
+    if (!image.isValid()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(stagedImagesMutex);
+    stagedImages[path] = std::move(image);
+}
+
+void TextureLoader::releaseStagedImages(const std::vector<std::string>& paths) {
+    std::lock_guard<std::mutex> lock(stagedImagesMutex);
+    for (const auto& path : paths) {
+        stagedImages.erase(path);
+    }
+}
+
+DecodedImage TextureLoader::acquireImage(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(stagedImagesMutex);
+        auto it = stagedImages.find(path);
+        if (it != stagedImages.end()) {
+            return it->second;
+        }
+    }
+    return decodeImage(path);
+}
+
+namespace {
+    // Number of levels in a full mip chain for the given size
+    GLsizei getMipLevelCount(int width, int height) {
+        GLsizei levels = 1;
+        int size = std::max(width, height);
+        while (size > 1) {
+            size >>= 1;
+            ++levels;
+        }
+        return levels;
     }
-    else {
+
+    void applySampling(GLenum target, const TextureSampling& sampling) {
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, sampling.minFilter);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, sampling.magFilter);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, sampling.wrapS);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, sampling.wrapT);
+        if (target == GL_TEXTURE_CUBE_MAP) {
+            glTexParameteri(target, GL_TEXTURE_WRAP_R, sampling.wrapR);
+        }
+    }
+
+    // Approximate VRAM use of a texture with a full mip chain
+    size_t estimateResidentBytes(int width, int height, int channels, int layers) {
+        size_t baseLevel = static_cast<size_t>(width) * height * (channels == 4 ? 4 : 3) * layers;
+        return baseLevel + baseLevel / 3;
+    }
+}
+
+// Load a single 2D texture
+Texture TextureLoader::loadTexture(const std::string& path, const TextureSampling& sampling) {
+    return TextureManager::instance().getTexture(path, sampling);
+}
+
+Texture TextureLoader::createCubemap(const std::vector<std::string>& paths, const TextureSampling& sampling) {
+    return TextureManager::instance().getCubemap(paths, sampling);
+}
+
+std::shared_ptr<TextureResource> TextureLoader::createTexture(const std::string& path, const TextureSampling& sampling) {
+    DecodedImage image = acquireImage(path);
+    if (!image.isValid()) {
         std::cerr << "Texture failed to load at path: " << path << std::endl;
-        return {}; // Return empty texture (check if texture.id == 0 in client code)
+        return nullptr;
     }
-    texture.path = path;
-    return texture;
+
+    auto resource = std::make_shared<TextureResource>();
+    resource->target = GL_TEXTURE_2D;
+    resource->residentBytes = estimateResidentBytes(image.width, image.height, image.channels, 1);
+    resource->uploadTicket = std::make_shared<UploadTicket>();
+
+    glGenTextures(1, &resource->id);
+    glBindTexture(GL_TEXTURE_2D, resource->id);
+    applySampling(GL_TEXTURE_2D, sampling);
+
+    // Allocate immutable storage now; the pixels are streamed in by the upload queue
+    GLenum format = (image.channels == 4) ? GL_RGBA : GL_RGB;
+    GLenum internalFormat = (image.channels == 4) ? GL_RGBA8 : GL_RGB8;
+    glTexStorage2D(GL_TEXTURE_2D, getMipLevelCount(image.width, image.height), internalFormat, image.width, image.height);
+
+    GpuUploadQueue::instance().uploadTexture(resource->id, GL_TEXTURE_2D, GL_TEXTURE_2D, image.width, image.height,
+        format, image.pixels.get(), resource->uploadTicket, image.pixels, true);
+
+    return resource;
 }
 
-Texture TextureLoader::createCubemap(const std::vector<std::string>& paths) {
+std::shared_ptr<TextureResource> TextureLoader::createCubemapTexture(const std::vector<std::string>& paths, const TextureSampling& sampling) {
     if (paths.size() != 6) {
         std::cerr << "Cubemap must have exactly six faces" << std::endl;
-        return {}; // Return an empty texture
+        return nullptr;
     }
 
-    // Create a unique key for the cubemap cache based on the paths
-    std::ostringstream oss;
+    std::vector<DecodedImage> faces;
     for (const auto& path : paths) {
-        oss << path << ";";
+        faces.push_back(acquireImage(path));
     }
-    std::string key = oss.str();
-
-    // Check if the cubemap is already loaded
-    auto it = cubemapCache.find(key);
-    if (it != cubemapCache.end()) {
-        // Found in cache, return existing cubemap texture
-        Texture cachedTexture;
-        cachedTexture.id = it->second;
-        cachedTexture.type = "environment";
-        return cachedTexture;
+
+    const DecodedImage& firstFace = faces[0];
+    if (!firstFace.isValid()) {
+        std::cerr << "Failed to load cubemap face: " << paths[0] << std::endl;
+        return nullptr;
     }
 
-    Texture cubemapTexture;
-    glGenTextures(1, &cubemapTexture.id);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture.id);
+    auto resource = std::make_shared<TextureResource>();
+    resource->target = GL_TEXTURE_CUBE_MAP;
+    resource->residentBytes = estimateResidentBytes(firstFace.width, firstFace.height, firstFace.channels, 6);
+    resource->uploadTicket = std::make_shared<UploadTicket>();
+
+    glGenTextures(1, &resource->id);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, resource->id);
+    applySampling(GL_TEXTURE_CUBE_MAP, sampling);
+
+    // Immutable storage shared by all faces, so every face must match the first one
+    GLenum format = (firstFace.channels == 4) ? GL_RGBA : GL_RGB;
+    GLenum internalFormat = (firstFace.channels == 4) ? GL_RGBA8 : GL_RGB8;
+    glTexStorage2D(GL_TEXTURE_CUBE_MAP, getMipLevelCount(firstFace.width, firstFace.height), internalFormat, firstFace.width, firstFace.height);
 
+    std::vector<int> validFaces;
     for (int i = 0; i < 6; i++) {
-        GLenum face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(paths[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            GLenum format = (nrChannels == 4) ? GL_RGBA : GL_RGB;
-            glTexImage2D(face, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
+        const DecodedImage& image = faces[i];
+        if (!image.isValid()) {
+            std::cerr << "Failed to load cubemap face: " << paths[i] << std::endl;
+        }
+        else if (image.width != firstFace.width || image.height != firstFace.height || image.channels != firstFace.channels) {
+            std::cerr << "Cubemap face does not match the size or format of the first face: " << paths[i] << std::endl;
         }
         else {
-            std::cerr << "Failed to load cubemap face: " << paths[i] << std::endl;
+            validFaces.push_back(i);
         }
     }
 
-    glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+    for (int i : validFaces) {
+        GLenum face = GL_TEXTURE_CUBE_MAP_POSITIVE_X + i;
+        const DecodedImage& image = faces[i];
+
+        // Mipmaps are built once the last face is in
+        GpuUploadQueue::instance().uploadTexture(resource->id, GL_TEXTURE_CUBE_MAP, face, image.width, image.height,
+            format, image.pixels.get(), resource->uploadTicket, image.pixels, i == validFaces.back());
+    }
 
-    return cubemapTexture;
+    return resource;
 }
 
 GLenum TextureLoader::getGLCubemapFace(const std::string& faceName) {
@@ -1,50 +1,132 @@
 #include "TextureManager.h"
-#include <GL/glew.h>
-#include "stb_image.h"
-#include <iostream>
-#include <memory>
-
-std::unique_ptr<Texture> TextureManager::loadTexture(const std::string& path) {
-    auto texture = std::make_unique<Texture>();
-    glGenTextures(1, &(texture->id));
-
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format;
-        if (nrChannels == 1)
-            format = GL_RED;
-        else if (nrChannels == 3)
-            format = GL_RGB;
-        else if (nrChannels == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, texture->id);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        // Anisotropic filtering
-        if (glewIsSupported("GL_EXT_texture_filter_anisotropic")) {
-            GLfloat maxAnisotropy;
-            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
-            glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY_EXT, maxAnisotropy);
-        }
+#include "TextureLoader.h"
+#include "rendering/GpuUploadQueue.h"
+#include "FileSystemUtils.h"
+#include <algorithm>
+#include <sstream>
+
+size_t TextureManager::residentBytes = 0;
 
-        stbi_image_free(data);
+TextureResource::~TextureResource() {
+    // Anything still queued for this texture must not land in a recycled texture name
+    if (uploadTicket) {
+        uploadTicket->cancel();
+    }
+    if (bindlessHandle != 0) {
+        glMakeTextureHandleNonResidentARB(bindlessHandle);
+    }
+    if (id != 0) {
+        glDeleteTextures(1, &id);
+    }
+    TextureManager::onTextureReleased(residentBytes);
+}
+
+bool TextureResource::isUploaded() const {
+    return !uploadTicket || uploadTicket->isComplete();
+}
+
+TextureManager& TextureManager::instance() {
+    static TextureManager instance;
+    return instance;
+}
+
+std::string TextureManager::makeKey(const std::string& normalizedPaths, const TextureSampling& sampling) {
+    std::ostringstream key;
+    key << normalizedPaths << '|' << std::hex << sampling.minFilter << ':' << sampling.magFilter << ':'
+        << sampling.wrapS << ':' << sampling.wrapT << ':' << sampling.wrapR;
+    return key.str();
+}
+
+std::shared_ptr<TextureResource> TextureManager::find(const std::string& key) {
+    auto it = textures.find(key);
+    if (it == textures.end()) {
+        return nullptr;
+    }
+
+    std::shared_ptr<TextureResource> resource = it->second.lock();
+    if (!resource) {
+        textures.erase(it);
+    }
+    return resource;
+}
+
+Texture TextureManager::getTexture(const std::string& path, const TextureSampling& sampling) {
+    std::string key = makeKey(FileSystemUtils::normalizeAssetPath(path), sampling);
+
+    Texture texture;
+    texture.path = path;
+
+    std::shared_ptr<TextureResource> resource = find(key);
+    if (resource) {
+        ++hits;
     }
     else {
-        std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-        return nullptr; // Return nullptr if loading fails
+        ++misses;
+        resource = TextureLoader::createTexture(path, sampling);
+        if (!resource) {
+            return {}; // Return empty texture (check if texture.id == 0 in client code)
+        }
+        residentBytes += resource->residentBytes;
+        textures[key] = resource;
     }
 
-    texture->path = path;
-    // Set other texture properties as needed
+    texture.id = resource->id;
+    texture.resource = std::move(resource);
+    return texture;
+}
+
+Texture TextureManager::getCubemap(const std::vector<std::string>& facePaths, const TextureSampling& sampling) {
+    // Faces are part of the identity, in order
+    std::string joinedPaths;
+    for (const auto& path : facePaths) {
+        joinedPaths += FileSystemUtils::normalizeAssetPath(path) + ";";
+    }
+    std::string key = makeKey(joinedPaths, sampling);
+
+    Texture texture;
+    texture.type = "environment";
+
+    std::shared_ptr<TextureResource> resource = find(key);
+    if (resource) {
+        ++hits;
+    }
+    else {
+        ++misses;
+        resource = TextureLoader::createCubemapTexture(facePaths, sampling);
+        if (!resource) {
+            return {};
+        }
+        residentBytes += resource->residentBytes;
+        textures[key] = resource;
+    }
 
+    texture.id = resource->id;
+    texture.resource = std::move(resource);
     return texture;
 }
+
+void TextureManager::onTextureReleased(size_t bytes) {
+    residentBytes -= std::min(residentBytes, bytes);
+}
+
+void TextureManager::pruneExpired() {
+    for (auto it = textures.begin(); it != textures.end();) {
+        if (it->second.expired()) {
+            it = textures.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+TextureCacheStats TextureManager::getStats() {
+    pruneExpired();
+
+    TextureCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.liveTextures = textures.size();
+    stats.residentBytes = residentBytes;
+    return stats;
+}
@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool instance;
+    return instance;
+}
+
+ThreadPool::ThreadPool() {
+    // Leave one core for the render thread
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    unsigned int workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+
+    workers.reserve(workerCount);
+    for (unsigned int i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+
+    for (std::thread& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.push(std::move(task));
+    }
+    queueCondition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    // State shared with helper tasks that may still be queued after this call returns
+    struct Batch {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> finished{ 0 };
+        size_t count = 0;
+        std::function<void(size_t)> body;
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+
+    auto batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->body = body;
+
+    auto drain = [](const std::shared_ptr<Batch>& batch) {
+        size_t index;
+        while ((index = batch->next.fetch_add(1)) < batch->count) {
+            try {
+                batch->body(index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                if (!batch->error) {
+                    batch->error = std::current_exception();
+                }
+            }
+
+            if (batch->finished.fetch_add(1) + 1 == batch->count) {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                batch->done.notify_all();
+            }
+        }
+    };
+
+    size_t helperCount = std::min(workers.size(), count - 1);
+    for (size_t i = 0; i < helperCount; ++i) {
+        enqueue([batch, drain]() { drain(batch); });
+    }
+
+    drain(batch);
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->done.wait(lock, [&batch]() { return batch->finished.load() == batch->count; });
+
+    if (batch->error) {
+        std::rethrow_exception(batch->error);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+
+// Shared pool of worker threads for CPU-only work (mesh processing, asset decoding).
+// Nothing submitted here may touch the OpenGL context.
+class ThreadPool {
+public:
+    static ThreadPool& instance();
+
+    ~ThreadPool();
+
+    size_t getWorkerCount() const { return workers.size(); }
+
+    template <typename F>
+    auto submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+        using Result = std::invoke_result_t<std::decay_t<F>>;
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    // Runs body(i) for every i in [0, count). The calling thread takes part in the work,
+    // so this is safe to call from inside a pool task. The first exception thrown by a body
+    // is rethrown here once all iterations have finished.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+private:
+    ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+};
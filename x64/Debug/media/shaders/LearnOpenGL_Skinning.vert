@@ -21,17 +21,21 @@ layout (std140, binding = 0) uniform Uniforms {
 layout(location = 0) in vec3 pos;
 layout(location = 1) in vec3 norm;
 layout(location = 2) in vec2 tex;
-layout(location = 3) in vec3 tangent;
+layout(location = 3) in vec4 tangent; // w: bitangent handedness in the packed layout
+#ifndef PACKED_VERTICES
 layout(location = 4) in vec3 bitangent;
+#endif
 layout(location = 5) in ivec4 boneIDs;
 layout(location = 6) in vec4 weights;
 
 uniform mat4 model;
 
-const int MAX_BONES = 40;
 const int MAX_BONE_INFLUENCE = 4;
 
-uniform mat4x3 finalBonesMatrices[MAX_BONES];
+// Top three rows of every bone's affine matrix, streamed per draw (see BonePalette)
+layout(std430, binding = 1) readonly buffer BonePalette {
+    mat3x4 bones[];
+};
 
 out vec2 Texcoord;
 out vec3 ViewDirection;
@@ -40,16 +44,22 @@ out vec3 FragPos;
 
 void main()
 {
-    mat4x3 boneMatrix = mat4x3(0.0); // Initialize to zero matrix
+    mat3x4 boneMatrix = mat3x4(0.0); // Initialize to zero matrix
     for (int i = 0; i < MAX_BONE_INFLUENCE; i++) {
-        if (boneIDs[i] >= 0 && boneIDs[i] < MAX_BONES) // Check valid bone ID
-            boneMatrix += finalBonesMatrices[boneIDs[i]] * weights[i];
+        if (boneIDs[i] >= 0 && boneIDs[i] < bones.length()) // Check valid bone ID
+            boneMatrix += bones[boneIDs[i]] * weights[i];
     }
 
-    vec4 worldPosition = model * vec4(boneMatrix * vec4(pos, 1.0), 1.0);
-    vec3 worldNormal = normalize(mat3(model) * (mat3(boneMatrix) * norm));
-    vec3 worldTangent = normalize(mat3(model) * (mat3(boneMatrix) * tangent));
-    vec3 worldBitangent = normalize(mat3(model) * (mat3(boneMatrix) * bitangent));
+    // Row-vector products apply the packed rows: vec4 * mat3x4 dots the vector with each row
+    vec4 worldPosition = model * vec4(vec4(pos, 1.0) * boneMatrix, 1.0);
+    vec3 worldNormal = normalize(mat3(model) * (vec4(norm, 0.0) * boneMatrix));
+#ifdef PACKED_VERTICES
+    vec3 localBitangent = cross(norm, tangent.xyz) * tangent.w;
+#else
+    vec3 localBitangent = bitangent;
+#endif
+    vec3 worldTangent = normalize(mat3(model) * (vec4(tangent.xyz, 0.0) * boneMatrix));
+    vec3 worldBitangent = normalize(mat3(model) * (vec4(localBitangent, 0.0) * boneMatrix));
 
     vec4 viewPosition = view * worldPosition;
     gl_Position = projection * viewPosition;
@@ -1,10 +1,34 @@
 #version 430 core
 
+#ifdef INSTANCED
+// Lets multi-draw commands address their own range of the object buffer
+#extension GL_ARB_shader_draw_parameters : enable
+#endif
+
 layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
+#ifdef INSTANCED
+// Per-object data of a batched draw, packed by the render queue (ObjectData)
+struct ObjectData {
+    mat4 model;
+    mat4 previousModel;
+    mat3 normalMatrix;
+    uint materialIndex;
+};
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+#ifdef GL_ARB_shader_draw_parameters
+#define INSTANCE_INDEX (gl_BaseInstanceARB + gl_InstanceID)
+#else
+#define INSTANCE_INDEX gl_InstanceID
+#endif
+#define model objects[INSTANCE_INDEX].model
+#else
 uniform mat4 model;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
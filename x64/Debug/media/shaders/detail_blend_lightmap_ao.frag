@@ -1,11 +1,25 @@
-#version 420 core
+#version 430 core
+
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
 
 in vec2 TexCoords;
 in vec2 LightMapTexCoords;
 
 out vec4 FragColor;
 
+#ifdef BINDLESS
+// Bindless handles of every texture set in the batch, one per texture slot (see BindlessTextures)
+layout(std430, binding = 4) readonly buffer MaterialTextures {
+    uvec2 materialTextures[];
+};
+flat in uint TextureSet;
+#define MATERIAL_TEXTURE(slot) sampler2D(materialTextures[TextureSet * 6u + (slot)])
+#else
 uniform sampler2D textures[4]; // 0: Base, 1: Lightmap, 2: DetailDirt, 3: DetailGrass
+#define MATERIAL_TEXTURE(slot) textures[slot]
+#endif
 uniform float TilingFactor1; // Tiling factor for the first detail texture
 uniform float TilingFactor2; // Tiling factor for the second detail texture
 uniform float lightmapInfluence = 0.8f; // Control this via your application
@@ -14,18 +28,18 @@ uniform float brightness = 2.2f; // Brightness factor, adjust as needed
 
 void main() {
     // Sample the base color and mask value from the base texture
-    vec4 baseColor = texture(textures[0], TexCoords);
+    vec4 baseColor = texture(MATERIAL_TEXTURE(0), TexCoords);
     float maskValue = baseColor.a; // Use alpha channel for the mask
 
     // Sample the detail textures with tiling
-    vec4 dirtColor = texture(textures[2], TexCoords * TilingFactor1);
-    vec4 grassColor = texture(textures[3], TexCoords * TilingFactor2);
+    vec4 dirtColor = texture(MATERIAL_TEXTURE(2), TexCoords * TilingFactor1);
+    vec4 grassColor = texture(MATERIAL_TEXTURE(3), TexCoords * TilingFactor2);
 
     // Blend between the dirt and grass detail textures based on the mask value
     vec4 blendedDetail = mix(grassColor, dirtColor, maskValue);
 
     // Sample the lightmap texture and apply gamma correction
-    vec4 lightmapColor = texture(textures[1], LightMapTexCoords);
+    vec4 lightmapColor = texture(MATERIAL_TEXTURE(1), LightMapTexCoords);
     vec3 gammaCorrectedLightmap = pow(lightmapColor.rgb, vec3(gamma));
 
     // Blend the lightmap color using the influence factor
@@ -1,5 +1,10 @@
 #version 430 core
 
+#ifdef INSTANCED
+// Lets multi-draw commands address their own range of the object buffer
+#extension GL_ARB_shader_draw_parameters : enable
+#endif
+
 layout (std140, binding = 0) uniform Uniforms {
     mat4 view;
     mat4 projection;
@@ -29,14 +34,35 @@ out vec3 ReflectDir;
 out vec3 Normal;
 out vec3 WorldPos;
 
+#ifdef INSTANCED
+// Per-object data of a batched draw, packed by the render queue (ObjectData)
+struct ObjectData {
+    mat4 model;
+    mat4 previousModel;
+    mat3 normalMatrix;
+    uint materialIndex;
+};
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+#ifdef GL_ARB_shader_draw_parameters
+#define INSTANCE_INDEX (gl_BaseInstanceARB + gl_InstanceID)
+#else
+#define INSTANCE_INDEX gl_InstanceID
+#endif
+#define model objects[INSTANCE_INDEX].model
+#define normalMatrix objects[INSTANCE_INDEX].normalMatrix
+#else
 uniform mat4 model;
+uniform mat3 normalMatrix; // Cached per object, see RenderableNode
+#endif
 
 void main() {
     TexCoords = aTexCoords;
     LightMapTexCoords = aLightMapTexCoords;
     
     WorldPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = normalMatrix * aNormal;
 
     vec3 worldNormal = normalize(mat3(model) * aNormal);
     vec3 worldViewDir = normalize(WorldPos - cameraPositionWorld);
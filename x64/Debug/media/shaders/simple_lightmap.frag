@@ -1,5 +1,9 @@
 #version 430 core
 
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+
 layout (std140, binding = 0) uniform Uniforms {
     mat4 view;
     mat4 projection;
@@ -24,11 +28,21 @@ in vec2 LightMapTexCoords;
 out vec4 FragColor;
 
 // Assuming you have 4 textures: base, lightmap, detail1, detail2
+#ifdef BINDLESS
+// Bindless handles of every texture set in the batch, one per texture slot (see BindlessTextures)
+layout(std430, binding = 4) readonly buffer MaterialTextures {
+    uvec2 materialTextures[];
+};
+flat in uint TextureSet;
+#define MATERIAL_TEXTURE(slot) sampler2D(materialTextures[TextureSet * 6u + (slot)])
+#else
 uniform sampler2D textures[2]; // An array of textures
+#define MATERIAL_TEXTURE(slot) textures[slot]
+#endif
 
 void main() {
-    vec4 baseColor = texture(textures[0], TexCoords); // Base texture
-    vec4 lightmapColor = texture(textures[1], LightMapTexCoords); // Lightmap texture
+    vec4 baseColor = texture(MATERIAL_TEXTURE(0), TexCoords); // Base texture
+    vec4 lightmapColor = texture(MATERIAL_TEXTURE(1), LightMapTexCoords); // Lightmap texture
 
     // Extract the ambient occlusion value from the alpha channel
     float ao = lightmapColor.a;
@@ -1,5 +1,9 @@
 #version 430 core
 
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+
 layout (std140, binding = 0) uniform Uniforms {
     mat4 view;
     mat4 projection;
@@ -25,15 +29,26 @@ in vec3 WorldNormal;
 
 out vec4 FragColor;
 
+#ifdef BINDLESS
+// Bindless handles of every texture set in the batch, one per texture slot (see BindlessTextures)
+layout(std430, binding = 4) readonly buffer MaterialTextures {
+    uvec2 materialTextures[];
+};
+flat in uint TextureSet;
+#define MATERIAL_TEXTURE(slot) sampler2D(materialTextures[TextureSet * 6u + (slot)])
+#define environmentMap samplerCube(materialTextures[TextureSet * 6u + 5u])
+#else
 uniform sampler2D textures[2]; // An array of textures (diffuse, lightmap)
 uniform samplerCube environmentMap;
+#define MATERIAL_TEXTURE(slot) textures[slot]
+#endif
 uniform float roughness;
 
 void main() {
-    vec4 diffuseColor = texture(textures[0], TexCoords);
+    vec4 diffuseColor = texture(MATERIAL_TEXTURE(0), TexCoords);
     float specularMask = diffuseColor.a;
     
-    vec4 lightmapColor = texture(textures[1], LightMapTexCoords);
+    vec4 lightmapColor = texture(MATERIAL_TEXTURE(1), LightMapTexCoords);
 	
 	// Multiply the diffuse color with the lightmap color
 	vec3 lightmappedDiffuse = diffuseColor.rgb * lightmapColor.rgb;
@@ -1,5 +1,10 @@
 #version 430 core
 
+#ifdef INSTANCED
+// Lets multi-draw commands address their own range of the object buffer
+#extension GL_ARB_shader_draw_parameters : enable
+#endif
+
 layout (std140, binding = 0) uniform Uniforms {
     mat4 view;
     mat4 projection;
@@ -28,14 +33,51 @@ out vec2 LightMapTexCoords;
 out vec3 WorldPos;
 out vec3 WorldNormal;
 
+#ifdef INSTANCED
+// Per-object data of a batched draw, packed by the render queue (ObjectData)
+struct ObjectData {
+    mat4 model;
+    mat4 previousModel;
+    mat3 normalMatrix;
+    uint materialIndex;
+};
+layout(std430, binding = 2) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+#ifdef GL_ARB_shader_draw_parameters
+#define INSTANCE_INDEX (gl_BaseInstanceARB + gl_InstanceID)
+#else
+#define INSTANCE_INDEX gl_InstanceID
+#endif
+#define model objects[INSTANCE_INDEX].model
+#define normalMatrix objects[INSTANCE_INDEX].normalMatrix
+#else
 uniform mat4 model;
+uniform mat3 normalMatrix; // Cached per object, see RenderableNode
+#endif
+
+#ifdef BINDLESS
+// Texture set of each draw of a multi-draw in the MaterialTextures block of the fragment shader
+layout(std430, binding = 3) readonly buffer DrawTextureSets {
+    uint drawTextureSets[];
+};
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_INDEX gl_DrawIDARB
+#else
+#define DRAW_INDEX 0
+#endif
+flat out uint TextureSet;
+#endif
 
 void main() {
+#ifdef BINDLESS
+    TextureSet = drawTextureSets[DRAW_INDEX];
+#endif
     TexCoords = aTexCoords;
     LightMapTexCoords = aLightMapTexCoords;
     
     WorldPos = vec3(model * vec4(aPos, 1.0));
-    WorldNormal = mat3(transpose(inverse(model))) * aNormal;
+    WorldNormal = normalMatrix * aNormal;
     
     gl_Position = projection * view * vec4(WorldPos, 1.0);
 }
\ No newline at end of file